@@ -0,0 +1,378 @@
+#include "AABBTree.h"
+
+#include <algorithm>
+
+static inline float SurfaceArea(const glm::vec3& min, const glm::vec3& max)
+{
+	glm::vec3 d = max - min;
+	return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static inline bool Overlap(const AABBTreeNode& a, const AABBTreeNode& b)
+{
+	return
+		a.min.x <= b.max.x && b.min.x <= a.max.x &&
+		a.min.y <= b.max.y && b.min.y <= a.max.y &&
+		a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+DynamicAABBTree::DynamicAABBTree(float margin) : margin(margin) {}
+
+int DynamicAABBTree::AllocateNode()
+{
+	int node;
+	if (freeList != AABB_TREE_NULL_NODE)
+	{
+		node = freeList;
+		freeList = nodes[node].parent;
+	}
+	else
+	{
+		node = (int)nodes.size();
+		nodes.push_back(AABBTreeNode());
+	}
+
+	nodes[node].body = nullptr;
+	nodes[node].parent = AABB_TREE_NULL_NODE;
+	nodes[node].child1 = AABB_TREE_NULL_NODE;
+	nodes[node].child2 = AABB_TREE_NULL_NODE;
+	nodes[node].height = 0;
+
+	return node;
+}
+
+void DynamicAABBTree::FreeNode(int node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	nodes[node].body = nullptr;
+	freeList = node;
+}
+
+int DynamicAABBTree::AddProxy(const AABB& bounds, RigidBody* body)
+{
+	int leaf = AllocateNode();
+	nodes[leaf].min = GetMin(bounds) - glm::vec3(margin);
+	nodes[leaf].max = GetMax(bounds) + glm::vec3(margin);
+	nodes[leaf].body = body;
+
+	InsertLeaf(leaf);
+	numLeaves++;
+
+	return leaf;
+}
+
+void DynamicAABBTree::RemoveProxy(int proxy)
+{
+	if (proxy < 0 || proxy >= nodes.size() || nodes[proxy].height != 0) return;
+
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	numLeaves--;
+}
+
+void DynamicAABBTree::MoveProxy(int proxy, const AABB& bounds)
+{
+	glm::vec3 min = GetMin(bounds);
+	glm::vec3 max = GetMax(bounds);
+
+	AABBTreeNode& leaf = nodes[proxy];
+	if (glm::all(glm::greaterThanEqual(min, leaf.min)) && glm::all(glm::lessThanEqual(max, leaf.max)))
+		return; // Still inside its fat bounds
+
+	RemoveLeaf(proxy);
+
+	nodes[proxy].min = min - glm::vec3(margin);
+	nodes[proxy].max = max + glm::vec3(margin);
+
+	InsertLeaf(proxy);
+}
+
+void DynamicAABBTree::Refit(int node)
+{
+	AABBTreeNode& n = nodes[node];
+	const AABBTreeNode& child1 = nodes[n.child1];
+	const AABBTreeNode& child2 = nodes[n.child2];
+
+	n.min = glm::min(child1.min, child2.min);
+	n.max = glm::max(child1.max, child2.max);
+	n.height = 1 + std::max(child1.height, child2.height);
+}
+
+void DynamicAABBTree::InsertLeaf(int leaf)
+{
+	if (root == AABB_TREE_NULL_NODE)
+	{
+		root = leaf;
+		nodes[root].parent = AABB_TREE_NULL_NODE;
+		return;
+	}
+
+	glm::vec3 leafMin = nodes[leaf].min;
+	glm::vec3 leafMax = nodes[leaf].max;
+
+	// Descend to the sibling that increases the surface area of the tree the least
+	int index = root;
+	while (!nodes[index].IsLeaf())
+	{
+		const AABBTreeNode& node = nodes[index];
+		int child1 = node.child1;
+		int child2 = node.child2;
+
+		float area = SurfaceArea(node.min, node.max);
+		float combinedArea = SurfaceArea(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down
+		float inheritanceCost = 2.f * (combinedArea - area);
+
+		float cost1 = SurfaceArea(glm::min(nodes[child1].min, leafMin), glm::max(nodes[child1].max, leafMax)) + inheritanceCost;
+		if (!nodes[child1].IsLeaf())
+			cost1 -= SurfaceArea(nodes[child1].min, nodes[child1].max);
+
+		float cost2 = SurfaceArea(glm::min(nodes[child2].min, leafMin), glm::max(nodes[child2].max, leafMax)) + inheritanceCost;
+		if (!nodes[child2].IsLeaf())
+			cost2 -= SurfaceArea(nodes[child2].min, nodes[child2].max);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? child1 : child2;
+	}
+
+	int sibling = index;
+
+	// New parent for the sibling and the leaf (may reallocate the nodes)
+	int oldParent = nodes[sibling].parent;
+	int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent != AABB_TREE_NULL_NODE)
+	{
+		if (nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	}
+	else root = newParent;
+
+	// Walk back up fixing the bounds and the balance
+	index = newParent;
+	while (index != AABB_TREE_NULL_NODE)
+	{
+		index = Balance(index);
+		Refit(index);
+		index = nodes[index].parent;
+	}
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = AABB_TREE_NULL_NODE;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	FreeNode(parent);
+
+	if (grandParent == AABB_TREE_NULL_NODE)
+	{
+		root = sibling;
+		nodes[sibling].parent = AABB_TREE_NULL_NODE;
+		return;
+	}
+
+	// The sibling takes the place of the parent
+	if (nodes[grandParent].child1 == parent)
+		nodes[grandParent].child1 = sibling;
+	else
+		nodes[grandParent].child2 = sibling;
+	nodes[sibling].parent = grandParent;
+
+	int index = grandParent;
+	while (index != AABB_TREE_NULL_NODE)
+	{
+		index = Balance(index);
+		Refit(index);
+		index = nodes[index].parent;
+	}
+}
+
+// Rotates the taller child up if the node is unbalanced. Returns the node at the old position.
+int DynamicAABBTree::Balance(int iA)
+{
+	AABBTreeNode& A = nodes[iA];
+	if (A.IsLeaf() || A.height < 2)
+		return iA;
+
+	int iB = A.child1;
+	int iC = A.child2;
+	AABBTreeNode& B = nodes[iB];
+	AABBTreeNode& C = nodes[iC];
+
+	int balance = C.height - B.height;
+
+	if (balance > 1)
+	{
+		// Rotate C up
+		int iF = C.child1;
+		int iG = C.child2;
+		AABBTreeNode& F = nodes[iF];
+		AABBTreeNode& G = nodes[iG];
+
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if (C.parent != AABB_TREE_NULL_NODE)
+		{
+			if (nodes[C.parent].child1 == iA)
+				nodes[C.parent].child1 = iC;
+			else
+				nodes[C.parent].child2 = iC;
+		}
+		else root = iC;
+
+		// The shorter grandchild goes down to A
+		if (F.height > G.height)
+		{
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+		}
+		else
+		{
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+		}
+
+		Refit(iA);
+		Refit(iC);
+		return iC;
+	}
+
+	if (balance < -1)
+	{
+		// Rotate B up
+		int iD = B.child1;
+		int iE = B.child2;
+		AABBTreeNode& D = nodes[iD];
+		AABBTreeNode& E = nodes[iE];
+
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if (B.parent != AABB_TREE_NULL_NODE)
+		{
+			if (nodes[B.parent].child1 == iA)
+				nodes[B.parent].child1 = iB;
+			else
+				nodes[B.parent].child2 = iB;
+		}
+		else root = iB;
+
+		if (D.height > E.height)
+		{
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+		}
+		else
+		{
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+		}
+
+		Refit(iA);
+		Refit(iB);
+		return iB;
+	}
+
+	return iA;
+}
+
+void DynamicAABBTree::FindPairs(std::vector<BroadphasePair>& outPairs)
+{
+	outPairs.clear();
+	if (root == AABB_TREE_NULL_NODE) return;
+
+	// Query the tree with every leaf; a pair is reported by the leaf with the lower index
+	for (int leaf = 0; leaf < nodes.size(); ++leaf)
+	{
+		if (nodes[leaf].height != 0) continue;
+
+		const AABBTreeNode& query = nodes[leaf];
+
+		stack.clear();
+		stack.push_back(root);
+
+		while (!stack.empty())
+		{
+			int index = stack.back();
+			stack.pop_back();
+
+			const AABBTreeNode& node = nodes[index];
+			if (!Overlap(node, query)) continue;
+
+			if (node.IsLeaf())
+			{
+				if (index > leaf)
+					outPairs.push_back(BroadphasePair(query.body, node.body));
+			}
+			else
+			{
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+}
+
+void DynamicAABBTree::Query(const AABB& bounds, std::vector<RigidBody*>& outBodies)
+{
+	outBodies.clear();
+	if (root == AABB_TREE_NULL_NODE) return;
+
+	AABBTreeNode query;
+	query.min = GetMin(bounds);
+	query.max = GetMax(bounds);
+
+	stack.clear();
+	stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		int index = stack.back();
+		stack.pop_back();
+
+		const AABBTreeNode& node = nodes[index];
+		if (!Overlap(node, query)) continue;
+
+		if (node.IsLeaf())
+			outBodies.push_back(node.body);
+		else
+		{
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+int DynamicAABBTree::GetHeight() const
+{
+	return root == AABB_TREE_NULL_NODE ? 0 : nodes[root].height;
+}
\ No newline at end of file
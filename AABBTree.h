@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Broadphase.h"
+
+#define AABB_TREE_MARGIN 0.1f // Fattening of the leaf bounds, so slow bodies do not touch the tree every frame
+#define AABB_TREE_NULL_NODE -1
+
+struct AABBTreeNode
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	RigidBody* body; // Only in leaves
+
+	int parent; // Next free node while the node is not in use
+	int child1;
+	int child2;
+	int height; // 0 for leaves, -1 for free nodes
+
+	inline bool IsLeaf() const { return child1 == AABB_TREE_NULL_NODE; }
+};
+
+// Dynamic bounding volume tree. Leaves store fattened bounds and are reinserted only when the
+// body leaves them; the insertion picks the sibling with the least surface area increase and
+// the tree is kept balanced with rotations. The proxies are the indices of the leaf nodes.
+class DynamicAABBTree : public Broadphase
+{
+protected:
+	std::vector<AABBTreeNode> nodes;
+	int root = AABB_TREE_NULL_NODE;
+	int freeList = AABB_TREE_NULL_NODE;
+	int numLeaves = 0;
+	float margin;
+
+	std::vector<int> stack; // Reused by the queries
+
+	int AllocateNode();
+	void FreeNode(int node);
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+
+	int Balance(int node);
+
+	void Refit(int node); // Updates the bounds and height of the node from its children
+
+public:
+	DynamicAABBTree(float margin = AABB_TREE_MARGIN);
+
+	int AddProxy(const AABB& bounds, RigidBody* body) override;
+
+	void RemoveProxy(int proxy) override;
+
+	void MoveProxy(int proxy, const AABB& bounds) override;
+
+	void FindPairs(std::vector<BroadphasePair>& outPairs) override;
+
+	void Query(const AABB& bounds, std::vector<RigidBody*>& outBodies) override;
+
+	inline int GetNumProxies() const override { return numLeaves; }
+
+	inline int GetType() const override { return AABB_TREE_BROADPHASE; }
+
+	int GetHeight() const;
+};
\ No newline at end of file
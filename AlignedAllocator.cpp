@@ -0,0 +1,27 @@
+#include "AlignedAllocator.h"
+
+#include <cstdlib>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+void* AlignedMalloc(size_t size, size_t alignment)
+{
+#ifdef _MSC_VER
+	return _aligned_malloc(size, alignment);
+#else
+	void* pointer = nullptr;
+	if (posix_memalign(&pointer, alignment, size) != 0) return nullptr;
+	return pointer;
+#endif
+}
+
+void AlignedFree(void* pointer)
+{
+#ifdef _MSC_VER
+	_aligned_free(pointer);
+#else
+	free(pointer);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+void* AlignedMalloc(size_t size, size_t alignment);
+void AlignedFree(void* pointer);
+
+// Allocator for arrays that are read with aligned loads, or whose elements must not straddle
+// cache lines
+template <typename T, size_t Alignment>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	template <typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() = default;
+	template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t n)
+	{
+		void* pointer = AlignedMalloc(n * sizeof(T), Alignment);
+		if (pointer == nullptr) throw std::bad_alloc();
+		return static_cast<T*>(pointer);
+	}
+
+	void deallocate(T* pointer, size_t) { AlignedFree(pointer); }
+
+	template <typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
\ No newline at end of file
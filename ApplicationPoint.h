@@ -18,9 +18,22 @@ public:
 
 	virtual inline glm::vec3 GetPosition() const { return glm::vec3(0.f); }
 
+	// Position to render between the last two fixed steps (0 = previous, 1 = current)
+	virtual inline glm::vec3 GetInterpolatedPosition(float interpolation) const { return GetPosition(); }
+
 	virtual inline void AddForce(const glm::vec3& newForce) {}
 
 	virtual inline glm::vec3 GetVelocity() const { return glm::vec3(0.f); }
+
+	// Inverse of the mass that resists a push at the point along the unit direction, 0 if nothing
+	// can move it
+	virtual inline float GetInverseMass(const glm::vec3& direction) const { return 0.f; }
+
+	virtual inline void ApplyImpulse(const glm::vec3& impulse) {}
+
+	// Moves the point as an impulse changes its velocity, the displacement is the position impulse
+	// times the inverse mass
+	virtual inline void ApplyPositionImpulse(const glm::vec3& positionImpulse) {}
 };
 
 inline ApplicationPoint* ToApplicationPoint(PhysicsObject* object)
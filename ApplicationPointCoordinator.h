@@ -5,12 +5,12 @@
 class ApplicationPointCoordinator : public Coordinator
 {
 public:
-	void coordinate(Model* model, PhysicsObject* physics) const override
+	void coordinate(Model* model, PhysicsObject* physics, float interpolation = 1.f) const override
 	{
 		ApplicationPoint* appPoint = ToApplicationPoint(physics);
 		if (!appPoint) return;
 
-		model->position = appPoint->GetPosition();
+		model->position = appPoint->GetInterpolatedPosition(interpolation);
 	}
 };
 
@@ -0,0 +1,20 @@
+#include "Broadphase.h"
+#include "SweepAndPrune.h"
+#include "AABBTree.h"
+
+#include <iostream>
+
+Broadphase* CreateBroadphase(int type)
+{
+	switch (type)
+	{
+	case SWEEP_AND_PRUNE_BROADPHASE:
+		return new SweepAndPrune();
+
+	case AABB_TREE_BROADPHASE:
+		return new DynamicAABBTree();
+	}
+
+	std::cout << "Unknown broadphase type " << type << "." << std::endl;
+	return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "SimpleGeometry.h"
+#include "RigidBody.h"
+
+#include <vector>
+
+enum
+{
+	SWEEP_AND_PRUNE_BROADPHASE,
+	AABB_TREE_BROADPHASE
+};
+
+// Pair of bodies whose bounds overlap, to be tested by the narrowphase
+struct BroadphasePair
+{
+	RigidBody* body1;
+	RigidBody* body2;
+
+	inline BroadphasePair(RigidBody* body1, RigidBody* body2) : body1(body1), body2(body2) {}
+};
+
+struct BroadphaseStats
+{
+	int numProxies = 0;
+	int numPairs = 0;
+	float updateTime = 0.f; // ms spent updating the bounds of the proxies
+	float findPairsTime = 0.f; // ms spent finding the overlapping pairs
+};
+
+// Keeps the bounds of every collidable body and finds the pairs that may be in contact.
+// A proxy identifies a body inside the broadphase until it is removed.
+class Broadphase
+{
+public:
+	virtual ~Broadphase() {}
+
+	virtual int AddProxy(const AABB& bounds, RigidBody* body) = 0;
+
+	virtual void RemoveProxy(int proxy) = 0;
+
+	virtual void MoveProxy(int proxy, const AABB& bounds) = 0;
+
+	// Clears outPairs and fills it with every pair of overlapping proxies (each pair once)
+	virtual void FindPairs(std::vector<BroadphasePair>& outPairs) = 0;
+
+	// Clears outBodies and fills it with the bodies whose bounds overlap the given ones
+	virtual void Query(const AABB& bounds, std::vector<RigidBody*>& outBodies) = 0;
+
+	virtual int GetNumProxies() const = 0;
+
+	virtual int GetType() const = 0;
+};
+
+Broadphase* CreateBroadphase(int type);
\ No newline at end of file
@@ -1,17 +1,34 @@
 #include "Cloth.h"
+#include "SpringColoring.h"
 
-Cloth::Cloth() : PhysicsObject(CLOTH) {}
+#include <iostream>
+#include <algorithm>
+#include <cfloat>
 
-Cloth::Cloth(int width, int height, float spacing, float mass) : width(width), height(height), spacing(spacing), PhysicsObject(CLOTH)
+#define MIN_SELF_COLLISION_DISTANCE_SQ 1E-12f // Coincident particles have no direction to be pushed
+
+Cloth::Cloth() : PhysicsObject(CLOTH)
+{
+	springColorOffsets.push_back(0);
+}
+
+Cloth::Cloth(int width, int height, float spacing, float mass) : width(width), height(height), spacing(spacing), thickness(spacing), obstacleThickness(DEFAULT_OBSTACLE_THICKNESS * spacing), PhysicsObject(CLOTH)
 {
 	float particleMass = mass / (float)(width * height);
 
+	// The pool keeps pointers to the particles, so the vector must not reallocate
+	particles.reserve(width * height);
+	particlePool.Reserve(width * height);
+	startPositions.reserve(width * height);
+	weights.reserve(width * height);
+
 	for (int y = 0; y < height; ++y)
 	{
 		for (int x = 0; x < width; ++x)
 		{
 			particles.emplace_back(particleMass);
 			particles.back().SetPosition(glm::vec3(x * spacing, y * spacing, 0.f));
+			particlePool.Add(&particles.back());
 		}
 	}
 
@@ -21,40 +38,516 @@ Cloth::Cloth(int width, int height, float spacing, float mass) : width(width), h
 	{
 		for (int x = 0; x < width; ++x)
 		{
+			int i = GetParticleIndex(x, y);
+
 			if (x < width - 1)
-				springs.emplace_back(&GetParticle(x, y), &GetParticle(x+1, y), k, spacing);
+				AddSpring(i, GetParticleIndex(x + 1, y), spacing, STRETCH_CONSTRAINT);
 
 			if (y < height - 1)
-				springs.emplace_back(&GetParticle(x, y), &GetParticle(x, y+1), k, spacing);
+				AddSpring(i, GetParticleIndex(x, y + 1), spacing, STRETCH_CONSTRAINT);
 
 			if (x < width - 1 && y < height - 1)
-				springs.emplace_back(&GetParticle(x, y), &GetParticle(x+1, y+1), k, spacing * sqrt(2.f));
+				AddSpring(i, GetParticleIndex(x + 1, y + 1), spacing * sqrt(2.f), SHEAR_CONSTRAINT);
 
 			if (x < width - 1 && 0 < y)
-				springs.emplace_back(&GetParticle(x, y), &GetParticle(x + 1, y - 1), k, spacing * sqrt(2.f));
+				AddSpring(i, GetParticleIndex(x + 1, y - 1), spacing * sqrt(2.f), SHEAR_CONSTRAINT);
 
 			if (x < width - 2)
-				springs.emplace_back(&GetParticle(x, y), &GetParticle(x + 2, y), k, spacing * 2);
+				AddSpring(i, GetParticleIndex(x + 2, y), spacing * 2, BENDING_CONSTRAINT);
 
 			if(y < height - 2)
-				springs.emplace_back(&GetParticle(x, y), &GetParticle(x, y + 2), k, spacing * 2);
+				AddSpring(i, GetParticleIndex(x, y + 2), spacing * 2, BENDING_CONSTRAINT);
+		}
+	}
+
+	SortSpringsByColor();
+	BuildParticleSprings();
+
+	triangleTorn.assign(2 * (width - 1) * (height - 1), 0);
+}
+
+void Cloth::AddSpring(int p1, int p2, float restingLength, int type)
+{
+	static const float compliances[NUM_CLOTH_CONSTRAINT_TYPES] = {
+		DEFAULT_STRETCH_COMPLIANCE,
+		DEFAULT_SHEAR_COMPLIANCE,
+		DEFAULT_BENDING_COMPLIANCE
+	};
+
+	springs.Add(p1, p2, k, restingLength);
+	constraints.Add(p1, p2, restingLength, compliances[type], type);
+	springSumsDirty = true;
+}
+
+void Cloth::SortSpringsByColor()
+{
+	SpringColoring coloring;
+	coloring.Build(springs.Size(), [this](int i, const void*& target1, const void*& target2) {
+		target1 = &particles[springs.particle1[i]];
+		target2 = &particles[springs.particle2[i]];
+	});
+
+	ClothSprings sorted;
+	sorted.Reserve(springs.Size());
+	ClothConstraints sortedConstraints;
+	sortedConstraints.Reserve(constraints.Size());
+	springColorOffsets.clear();
+
+	for (int color = 0; color < coloring.GetNumColors(); ++color)
+	{
+		springColorOffsets.push_back(sorted.Size());
+
+		for (int i : coloring.GetColor(color))
+		{
+			sorted.Add(springs.particle1[i], springs.particle2[i], springs.constants[i], springs.restingLengths[i], springs.dampings[i]);
+			sortedConstraints.Add(constraints.particle1[i], constraints.particle2[i], constraints.restingLengths[i], constraints.compliances[i], constraints.types[i]);
 		}
 	}
+	springColorOffsets.push_back(sorted.Size());
+
+	springs = sorted;
+	constraints = sortedConstraints;
+}
+
+void Cloth::BuildParticleSprings()
+{
+	particleSprings.assign(particlePool.Size(), std::vector<int>());
+
+	for (int i = 0; i < springs.Size(); ++i)
+	{
+		particleSprings[springs.particle1[i]].push_back(i);
+		particleSprings[springs.particle2[i]].push_back(i);
+	}
+}
+
+int Cloth::FindSpring(int particle1, int particle2) const
+{
+	for (int spring : particleSprings[particle1])
+	{
+		if (springs.particle1[spring] == particle2 || springs.particle2[spring] == particle2)
+			return spring;
+	}
+
+	return -1;
+}
+
+void Cloth::MoveSpring(int from, int to)
+{
+	springs.Move(from, to);
+	constraints.Move(from, to);
+	implicitSolver.MoveSpring(from, to);
+
+	for (int particle : { springs.particle1[to], springs.particle2[to] })
+	{
+		std::vector<int>& adjacent = particleSprings[particle];
+		*std::find(adjacent.begin(), adjacent.end(), from) = to;
+	}
 }
 
-void Cloth::Update(float deltaTime)
+void Cloth::RemoveSpring(int spring)
 {
-	for (auto& spring : springs)
-		spring.applyForce();
+	// The sums of the stable time step lose the spring, the bound is found again
+	if (!springSumsDirty)
+	{
+		for (int particle : { springs.particle1[spring], springs.particle2[spring] })
+		{
+			springStiffness[particle] = std::max(springStiffness[particle] - springs.constants[spring], 0.f);
+			springDamping[particle] = std::max(springDamping[particle] - springs.dampings[spring], 0.f);
+		}
+	}
+	stableTimeStepDirty = true;
 
-	for (auto& particle : particles)
-		particle.Update(deltaTime);
+	for (int particle : { springs.particle1[spring], springs.particle2[spring] })
+	{
+		std::vector<int>& adjacent = particleSprings[particle];
+		std::vector<int>::iterator it = std::find(adjacent.begin(), adjacent.end(), spring);
+		*it = adjacent.back();
+		adjacent.pop_back();
+	}
+
+	// The last spring of the color fills the hole, which moves to the end of the color. Then the
+	// first spring of the next color is the hole, and so on until the end of the array.
+	int color = (int)(std::upper_bound(springColorOffsets.begin(), springColorOffsets.end(), spring) - springColorOffsets.begin()) - 1;
+	int hole = spring;
+
+	for (int c = color; c < GetNumSpringColors(); ++c)
+	{
+		int last = springColorOffsets[c + 1] - 1;
+		if (last != hole)
+			MoveSpring(last, hole);
+
+		hole = last;
+		springColorOffsets[c + 1]--;
+	}
+
+	springs.PopBack();
+	constraints.PopBack();
+	implicitSolver.RemoveLastSpring();
+}
+
+bool Cloth::BreakSpring(int particle1, int particle2)
+{
+	int spring = FindSpring(particle1, particle2);
+	if (spring == -1) return false;
+
+	int type = constraints.types[spring];
+	particle1 = springs.particle1[spring];
+	particle2 = springs.particle2[spring];
+
+	RemoveSpring(spring);
+	TearTriangles(particle1, particle2, type);
+
+	if (type == STRETCH_CONSTRAINT)
+	{
+		// The bending springs over the tear would keep it closed
+		int offset = particle2 - particle1;
+
+		int bending = FindSpring(particle1, particle2 + offset);
+		if (bending != -1 && constraints.types[bending] == BENDING_CONSTRAINT)
+			RemoveSpring(bending);
+
+		bending = FindSpring(particle2, particle1 - offset);
+		if (bending != -1 && constraints.types[bending] == BENDING_CONSTRAINT)
+			RemoveSpring(bending);
+	}
+
+	return true;
+}
+
+void Cloth::TearTriangles(int particle1, int particle2, int type)
+{
+	int x1 = particle1 % width, y1 = particle1 / width;
+	int x2 = particle2 % width, y2 = particle2 / width;
+	int x = std::min(x1, x2), y = std::min(y1, y2);
+
+	switch (type)
+	{
+	case STRETCH_CONSTRAINT:
+		// A side of the first triangle of its quad and of the second of the previous one
+		if (y1 == y2)
+		{
+			if (y < height - 1) TearTriangle(x, y, 0);
+			if (y > 0) TearTriangle(x, y - 1, 1);
+		}
+		else
+		{
+			if (x < width - 1) TearTriangle(x, y, 0);
+			if (x > 0) TearTriangle(x - 1, y, 1);
+		}
+		break;
+
+	case SHEAR_CONSTRAINT:
+		TearTriangle(x, y, 0);
+		TearTriangle(x, y, 1);
+		break;
+	}
+}
+
+void Cloth::TearTriangle(int x, int y, int triangle)
+{
+	int index = 2 * (x + y * (width - 1)) + triangle;
+	if (triangleTorn[index]) return;
+
+	triangleTorn[index] = 1;
+	tornTriangles.push_back(index);
+}
+
+void Cloth::Tear()
+{
+	// The springs are broken after the scan, since removing them moves the others
+	float maxStretch = 1.f + tearStrain;
+	brokenSprings.clear();
+
+	for (int i = 0; i < springs.Size(); ++i)
+	{
+		float maxLength = springs.restingLengths[i] * maxStretch;
+		glm::vec3 d = particlePool.positions[springs.particle2[i]] - particlePool.positions[springs.particle1[i]];
+
+		if (glm::dot(d, d) > maxLength * maxLength)
+			brokenSprings.emplace_back(springs.particle1[i], springs.particle2[i]);
+	}
+
+	for (int i = 0; i < brokenSprings.size(); ++i)
+		BreakSpring(brokenSprings[i].first, brokenSprings[i].second);
+}
+
+void Cloth::SetTearStrain(float strain)
+{
+	if (strain < 0.f)
+	{
+		std::cout << "The tear strain of the cloth can not be negative." << std::endl;
+		return;
+	}
+
+	tearStrain = strain;
+}
+
+void Cloth::Update(float deltaTime, int substeps)
+{
+	if (substeps > 1)
+		externalForces = particlePool.forces;
+
+	float substepDeltaTime = deltaTime / substeps;
+	for (int substep = 0; substep < substeps; ++substep)
+	{
+		if (substep > 0)
+			particlePool.forces = externalForces;
+
+		if (solver == SPRING_CLOTH_SOLVER)
+			ApplySpringForces();
+
+		Integrate(substepDeltaTime);
+	}
+}
+
+float Cloth::GetStableTimeStep() const
+{
+	if (solver != SPRING_CLOTH_SOLVER) return FLT_MAX;
+
+	if (!stableTimeStepDirty && !springSumsDirty && stableTimeStepMassVersion == particlePool.massVersion)
+		return stableTimeStep;
+
+	// Bound of the highest frequency (Gershgorin): each particle contributes w^2 = 2 k / m and
+	// c = 2 d / m, with k and d the sums of the constants and dampings of its springs
+	if (springSumsDirty)
+	{
+		springStiffness.assign(particlePool.Size(), 0.f);
+		springDamping.assign(particlePool.Size(), 0.f);
+		for (int i = 0; i < springs.Size(); ++i)
+		{
+			springStiffness[springs.particle1[i]] += springs.constants[i];
+			springStiffness[springs.particle2[i]] += springs.constants[i];
+			springDamping[springs.particle1[i]] += springs.dampings[i];
+			springDamping[springs.particle2[i]] += springs.dampings[i];
+		}
+		springSumsDirty = false;
+	}
+
+	float maxFrequency = 0.f;
+	for (int i = 0; i < particlePool.Size(); ++i)
+	{
+		if (particlePool.fixed[i]) continue;
+
+		float inverseMass = 2.f * particlePool.inverseMasses[i];
+		maxFrequency = std::max(maxFrequency, sqrtf(springStiffness[i] * inverseMass) + springDamping[i] * inverseMass);
+	}
+
+	stableTimeStep = maxFrequency > 0.f ? 2.f / maxFrequency : FLT_MAX;
+	stableTimeStepDirty = false;
+	stableTimeStepMassVersion = particlePool.massVersion;
+	return stableTimeStep;
+}
+
+void Cloth::InvalidateStableTimeStep()
+{
+	springSumsDirty = true;
+	stableTimeStepDirty = true;
+}
+
+void Cloth::ApplySpringForces()
+{
+	ApplyClothSpringForces(springs, particlePool, 0, springs.Size());
+}
+
+void Cloth::ApplySpringForces(int color, int begin, int end)
+{
+	int offset = springColorOffsets[color];
+	ApplyClothSpringForces(springs, particlePool, offset + begin, offset + end);
+}
+
+void Cloth::Integrate(float deltaTime)
+{
+	switch (solver)
+	{
+	case XPBD_CLOTH_SOLVER:
+		SolveConstraints(deltaTime);
+		break;
+
+	case IMPLICIT_CLOTH_SOLVER:
+		implicitSolver.Integrate(springs, particlePool, deltaTime);
+		break;
+
+	default:
+		particlePool.Integrate(deltaTime);
+	}
+
+	++step;
+
+	if (selfCollision)
+		SolveSelfCollisions();
+
+	if (tearStrain > 0.f)
+		Tear();
+}
+
+const SpatialHash& Cloth::GetParticleHash()
+{
+	if (hashStep != step)
+	{
+		particleHash.Build(particlePool.positions, thickness);
+		hashStep = step;
+	}
+
+	return particleHash;
+}
+
+void Cloth::SolveSelfCollisions()
+{
+	GetParticleHash();
+
+	ParticlePool& pool = particlePool;
+	glm::vec3* position = pool.positions.data();
+	glm::vec3* velocity = pool.velocities.data();
+
+	for (int i = 0; i < pool.Size(); ++i)
+	{
+		int xi = i % width;
+		int yi = i / width;
+
+		particleHash.ForEachNear(position[i], thickness, [&](int j) {
+			if (j <= i) return;
+
+			// Close neighbours in the rest shape only keep their rest distance
+			int dx = j % width - xi;
+			int dy = j / width - yi;
+			float minDistance = std::min(thickness, spacing * sqrtf((float)(dx * dx + dy * dy)));
+
+			glm::vec3 difference = position[j] - position[i];
+			float distanceSq = glm::length2(difference);
+			if (distanceSq >= minDistance * minDistance || distanceSq < MIN_SELF_COLLISION_DISTANCE_SQ) return;
+
+			float weightI = (pool.fixed[i] || !pool.awake[i]) ? 0.f : pool.inverseMasses[i];
+			float weightJ = (pool.fixed[j] || !pool.awake[j]) ? 0.f : pool.inverseMasses[j];
+			float weightSum = weightI + weightJ;
+			if (weightSum == 0.f) return;
+
+			float distance = sqrtf(distanceSq);
+			glm::vec3 normal = difference / distance;
+
+			// Push the particles apart, and remove the relative velocity that closes the gap
+			float correction = (minDistance - distance) / weightSum;
+			position[i] -= normal * (correction * weightI);
+			position[j] += normal * (correction * weightJ);
+
+			float normalVelocity = glm::dot(velocity[j] - velocity[i], normal);
+			if (normalVelocity < 0.f)
+			{
+				float impulse = -normalVelocity / weightSum;
+				velocity[i] -= normal * (impulse * weightI);
+				velocity[j] += normal * (impulse * weightJ);
+			}
+		});
+	}
+}
+
+void Cloth::SetSelfCollision(bool enabled, float newThickness)
+{
+	selfCollision = enabled;
+	thickness = newThickness > 0.f ? newThickness : spacing;
+	hashStep = -1;
+}
+
+void Cloth::SetObstacleCollision(bool enabled, float newThickness)
+{
+	obstacleCollision = enabled;
+	obstacleThickness = newThickness > 0.f ? newThickness : DEFAULT_OBSTACLE_THICKNESS * spacing;
+}
+
+void Cloth::SetFriction(float newFriction)
+{
+	if (newFriction < 0.f)
+	{
+		std::cout << "The friction of the cloth can not be negative." << std::endl;
+		return;
+	}
+
+	friction = newFriction;
+}
+
+void Cloth::SolveConstraints(float deltaTime)
+{
+	ParticlePool& pool = particlePool;
+	int numParticles = pool.Size();
+
+	startPositions.resize(numParticles);
+	weights.resize(numParticles);
+
+	// Prediction with the external forces, as in ParticlePool::Integrate
+	for (int i = 0; i < numParticles; ++i)
+	{
+		float active = (pool.fixed[i] | !pool.awake[i]) ? 0.f : 1.f;
+		weights[i] = active * pool.inverseMasses[i];
+		startPositions[i] = pool.positions[i];
+
+		glm::vec3 acceleration = (pool.forces[i] - pool.dampings[i] * pool.velocities[i]) * pool.inverseMasses[i];
+		pool.velocities[i] += (active * deltaTime) * acceleration;
+		pool.positions[i] += (active * deltaTime) * pool.velocities[i];
+
+		pool.forces[i] = glm::vec3(0.f);
+	}
+
+	constraints.ResetMultipliers();
+
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		SolveClothDistanceConstraints(constraints, pool, weights, deltaTime, 0, constraints.Size());
+		SolveClothPins(constraints, pool, weights, deltaTime);
+	}
+
+	// The velocities follow the corrected positions
+	float inverseDeltaTime = 1.f / deltaTime;
+	for (int i = 0; i < numParticles; ++i)
+		if (weights[i] != 0.f)
+			pool.velocities[i] = (pool.positions[i] - startPositions[i]) * inverseDeltaTime;
+}
+
+bool Cloth::SetSolver(int newSolver)
+{
+	if (newSolver != SPRING_CLOTH_SOLVER && newSolver != XPBD_CLOTH_SOLVER && newSolver != IMPLICIT_CLOTH_SOLVER)
+	{
+		std::cout << "The cloth solver " << newSolver << " is not valid." << std::endl;
+		return false;
+	}
+
+	solver = newSolver;
+	stableTimeStepDirty = true;
+	return true;
+}
+
+void Cloth::SetSolverIterations(int newIterations)
+{
+	iterations = newIterations > 1 ? newIterations : 1;
+}
+
+void Cloth::SetCompliance(int constraintType, float compliance)
+{
+	for (int i = 0; i < constraints.Size(); ++i)
+		if (constraints.types[i] == constraintType)
+			constraints.compliances[i] = compliance;
+}
+
+int Cloth::AddPin(int x, int y, float compliance)
+{
+	int index = GetParticleIndex(x, y);
+	return constraints.AddPin(index, particlePool.positions[index], compliance);
+}
+
+void Cloth::SetPinPosition(int pin, const glm::vec3& position)
+{
+	constraints.pinPositions[pin] = position;
+	SetAwake(true);
+}
+
+void Cloth::ClearPins()
+{
+	constraints.ClearPins();
+	SetAwake(true);
 }
 
 void Cloth::ApplyAcceleration(const glm::vec3& acceleration)
 {
-	for (auto& particle : particles)
-		particle.AddForce(acceleration * particle.GetMass());
+	for (int i = 0; i < particlePool.Size(); ++i)
+		particlePool.forces[i] += acceleration * particlePool.masses[i];
 }
 
 void Cloth::ApplyForceAtParticle(int x, int y, const glm::vec3& force)
@@ -71,8 +564,8 @@ int Cloth::GetNumberOfParticles() const
 glm::vec3 Cloth::GetPosition() const
 {
 	glm::vec3 centerOfMass(0.f);
-	for (const auto& particle : particles)
-		centerOfMass += particle.GetPosition();
+	for (const glm::vec3& position : particlePool.positions)
+		centerOfMass += position;
 	return centerOfMass / (float)GetNumberOfParticles();
 }
 
@@ -81,37 +574,71 @@ void Cloth::SetPosition(const glm::vec3& position)
 	glm::vec3 centerOfMass = GetPosition();
 
 	glm::vec3 translation = position - centerOfMass;
-	for (auto& particle : particles)
-	{
-		glm::vec3 newPosition = particle.GetPosition() + translation;
-		particle.SetPosition(newPosition);
-	}
+	for (glm::vec3& particlePosition : particlePool.positions)
+		particlePosition += translation;
+	for (glm::vec3& particlePosition : particlePool.previousPositions)
+		particlePosition += translation;
+
+	hashStep = -1;
+
+	SetAwake(true);
 }
 
 glm::vec3 Cloth::GetVelocity() const
 {
 	glm::vec3 velocity(0.f);
-	for (const auto& particle : particles)
-		velocity += particle.GetVelocity();
+	for (const glm::vec3& particleVelocity : particlePool.velocities)
+		velocity += particleVelocity;
 	return velocity / (float)GetNumberOfParticles();
 }
 
+float Cloth::GetMass() const
+{
+	float mass = 0.f;
+	for (int i = 0; i < particlePool.Size(); ++i)
+		if (!particlePool.fixed[i])
+			mass += particlePool.masses[i];
+	return mass;
+}
+
+float Cloth::GetKineticEnergy() const
+{
+	float energy = 0.f;
+	for (int i = 0; i < particlePool.Size(); ++i)
+		if (!particlePool.fixed[i])
+			energy += 0.5f * particlePool.masses[i] * glm::length2(particlePool.velocities[i]);
+	return energy;
+}
+
+void Cloth::SetAwake(bool newAwake)
+{
+	awake = newAwake;
+	restingFrames = 0;
+	particlePool.SetAwake(newAwake);
+}
+
 bool Cloth::HasParticle(const Particle* particle) const
 {
-	for (const Particle& p : particles) {
-		if (&p == particle) return true;
-	}
-	return false;
+	return particle != nullptr && particle->GetPool() == &particlePool;
 }
 
 Particle* Cloth::GetParticleAt(glm::vec3 position)
 {
-	float minDistance = glm::length(particles[0].GetPosition() - position);
+	const std::vector<glm::vec3>& positions = particlePool.positions;
+
+	// The hash is shared with the self collisions, so it is only rebuilt once per step
+	GetParticleHash();
+	int nearest = particleHash.FindNearest(positions, position, particleHash.GetCellSize());
+	if (nearest != -1)
+		return particlePool.views[nearest];
+
+	// Far from the cloth, every particle is checked
+	float minDistance = glm::length2(positions[0] - position);
 	int index = 0;
 
-	for (int i = 1; i < particles.size(); ++i)
+	for (int i = 1; i < positions.size(); ++i)
 	{
-		float distance = glm::length(particles[i].GetPosition() - position);
+		float distance = glm::length2(positions[i] - position);
 		if (distance < minDistance)
 		{
 			minDistance = distance;
@@ -121,7 +648,7 @@ Particle* Cloth::GetParticleAt(glm::vec3 position)
 
 	//if (minDistance > 0.5f * spacing) return 0;
 
-	return &particles[index];
+	return particlePool.views[index];
 }
 
 void SetClothModel(Model& model, const Cloth& cloth)
@@ -145,9 +672,13 @@ void SetClothModel(Model& model, const Cloth& cloth)
 		mesh->vertices[numVerticesFace1 + x + y * width].normal = glm::vec3(0.f);
 	}
 
-	// Calculate the normals
+	UpdateClothMeshIndices(*mesh, cloth);
+
+	// Calculate the normals, the torn triangles are collapsed into a vertex
 	for (int i = 0; i < mesh->GetNumTriangles(); ++i)
 	{
+		if (mesh->indices[i * 3 + 0] == mesh->indices[i * 3 + 1]) continue;
+
 		Triangle t = mesh->GetTriangle(i);
 		glm::vec3 normal = -glm::normalize(glm::cross(t.b - t.a, t.c - t.a));
 
@@ -159,7 +690,9 @@ void SetClothModel(Model& model, const Cloth& cloth)
 	// Normalize the normals
 	for (int i = 0; i < mesh->GetNumVertices(); ++i)
 	{
-		mesh->vertices[i].normal = glm::normalize(mesh->vertices[i].normal);
+		// The vertices left without triangles keep a zero normal
+		if (mesh->vertices[i].normal != glm::vec3(0.f))
+			mesh->vertices[i].normal = glm::normalize(mesh->vertices[i].normal);
 	}
 
 	// apply the changes
@@ -168,6 +701,41 @@ void SetClothModel(Model& model, const Cloth& cloth)
 	model.SetContent(mesh);
 }
 
+int UpdateClothMeshIndices(Mesh& mesh, const Cloth& cloth)
+{
+	// Each quad of CreateClothMesh has 12 indices: the 2 triangles of the front and then the 2 of
+	// the back. A torn triangle collapses into its first vertex, so nothing is drawn for it.
+	const std::vector<int>& torn = cloth.GetTornTriangles();
+	int first = (int)mesh.indices.size();
+	int last = -1;
+	int removed = 0;
+
+	for (int i = (int)torn.size() - 1; i >= 0; --i)
+	{
+		int quad = torn[i] / 2;
+		int triangle = torn[i] % 2;
+
+		int front = quad * 12 + triangle * 3;
+		if (mesh.indices[front] == mesh.indices[front + 1] && mesh.indices[front] == mesh.indices[front + 2])
+			break; // The earlier ones were collapsed by a previous call
+
+		for (int face : { front, front + 6 })
+		{
+			mesh.indices[face + 1] = mesh.indices[face];
+			mesh.indices[face + 2] = mesh.indices[face];
+		}
+
+		first = std::min(first, front);
+		last = std::max(last, front + 8);
+		++removed;
+	}
+
+	if (removed > 0)
+		mesh.UpdateIndices(first, last - first + 1);
+
+	return removed;
+}
+
 Cloth* ToCloth(PhysicsObject* object)
 {
 	if (object->GetType() == CLOTH)
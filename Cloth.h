@@ -2,10 +2,28 @@
 
 #include "PhysicsObject.h"
 #include "Particle.h"
-#include "Spring.h"
+#include "ClothSprings.h"
+#include "ClothConstraints.h"
+#include "ImplicitSpringSolver.h"
+#include "SpatialHash.h"
 
 #include <vector>
 
+enum
+{
+	SPRING_CLOTH_SOLVER, // Forces of the springs integrated explicitly
+	XPBD_CLOTH_SOLVER, // Position based constraints, stable with large steps
+	IMPLICIT_CLOTH_SOLVER // Springs integrated with backward Euler, stable with large steps
+};
+
+#define DEFAULT_XPBD_ITERATIONS 10
+#define DEFAULT_STRETCH_COMPLIANCE 0.f
+#define DEFAULT_SHEAR_COMPLIANCE 1E-4f
+#define DEFAULT_BENDING_COMPLIANCE 1E-3f // Same stiffness as the springs
+
+#define DEFAULT_OBSTACLE_THICKNESS 0.1f // Fraction of the spacing kept between the particles and the obstacles
+#define DEFAULT_CLOTH_FRICTION 0.4f
+
 class Cloth : public PhysicsObject
 {
 protected:
@@ -13,14 +31,121 @@ protected:
 	float spacing;
 	float k = 1000;
 
+	// The cloth sleeps as a whole, moving or pushing any of its particles wakes it up
+	bool awake = true;
+	int restingFrames = 0;
+
+	int solver = SPRING_CLOTH_SOLVER;
+	int iterations = DEFAULT_XPBD_ITERATIONS;
+
+	// Scratch of the XPBD step
+	std::vector<glm::vec3> startPositions;
+	std::vector<float> weights;
+
+	std::vector<glm::vec3> externalForces; // Kept for every substep
+
+	// Cache of GetStableTimeStep: the sums of the constants and dampings of the springs of each
+	// particle follow the springs, the bound is rebuilt when they or the masses change
+	mutable std::vector<float> springStiffness;
+	mutable std::vector<float> springDamping;
+	mutable bool springSumsDirty = true;
+	mutable float stableTimeStep = 0.f;
+	mutable bool stableTimeStepDirty = true;
+	mutable unsigned int stableTimeStepMassVersion = 0; // massVersion of the pool it was found with
+
+	// Self collision: the particles keep at least the thickness between them (or their distance in
+	// the rest shape, if it is smaller). The hash is also used to find the particle at a point.
+	bool selfCollision = false;
+	float thickness = 0.f;
+	SpatialHash particleHash;
+	int step = 0;
+	int hashStep = -1; // Step in which the hash was built
+
+	// Collision with the rigid bodies, the static planes and the static scene of the physics system
+	bool obstacleCollision = true;
+	float obstacleThickness = 0.f;
+	float friction = DEFAULT_CLOTH_FRICTION;
+
+	// Tearing: the springs stretched beyond (1 + tearStrain) times their rest length break. The
+	// triangles of CreateClothMesh that lose a side are recorded, so the mesh can drop them.
+	float tearStrain = 0.f; // 0 never tears
+	std::vector<std::vector<int>> particleSprings; // Indices of the springs of each particle
+	std::vector<std::pair<int, int>> brokenSprings; // Scratch of the tearing
+	std::vector<unsigned char> triangleTorn;
+	std::vector<int> tornTriangles;
+
+	void SolveSelfCollisions();
+
+	void Tear();
+
 public:
+	ParticlePool particlePool; // Storage of the particles state, the particles are views over it
 	std::vector<Particle> particles;
-	std::vector<Spring> springs;
+	ClothSprings springs; // Sorted by color, only removed by tearing
+	std::vector<int> springColorOffsets; // Springs of color c are [springColorOffsets[c], springColorOffsets[c + 1])
+	ClothConstraints constraints; // Same pairs and order as the springs, used by the XPBD solver
+	ImplicitSpringSolver implicitSolver; // Keeps the matrix of the springs between steps
 
 	Cloth();
 	Cloth(int width, int height, float spacing, float mass = 1.f);
 
-	void Update(float deltaTime);
+	void Update(float deltaTime, int substeps = 1); // The external forces act during every substep
+
+	// Largest step the explicit springs can take (2 / (w + c) for the highest frequency), infinite
+	// with the other solvers
+	float GetStableTimeStep() const;
+	void InvalidateStableTimeStep(); // After changing the constants or dampings of the springs by hand
+
+	void ApplySpringForces();
+
+	void ApplySpringForces(int color, int begin, int end); // Springs [begin, end) of the given color
+
+	inline int GetNumSpringColors() const { return (int)springColorOffsets.size() - 1; }
+	inline int GetNumSprings(int color) const { return springColorOffsets[color + 1] - springColorOffsets[color]; }
+
+	void Integrate(float deltaTime); // Also solves the constraints or the springs with the XPBD and implicit solvers
+
+	// SPRING_CLOTH_SOLVER, XPBD_CLOTH_SOLVER or IMPLICIT_CLOTH_SOLVER
+	bool SetSolver(int solver);
+	inline int GetSolver() const { return solver; }
+
+	void SetSolverIterations(int iterations); // Of the XPBD solver
+	inline int GetSolverIterations() const { return iterations; }
+
+	void SetCompliance(int constraintType, float compliance); // Of every constraint of the type
+
+	void SetSelfCollision(bool enabled, float thickness = 0.f); // A thickness of 0 uses the spacing
+	inline bool IsSelfCollisionEnabled() const { return selfCollision; }
+	inline float GetThickness() const { return thickness; }
+
+	void SetObstacleCollision(bool enabled, float thickness = 0.f); // A thickness of 0 uses the default fraction of the spacing
+	inline bool IsObstacleCollisionEnabled() const { return obstacleCollision; }
+	inline float GetObstacleThickness() const { return obstacleThickness; }
+	void SetFriction(float friction); // Coulomb coefficient against the obstacles
+	inline float GetFriction() const { return friction; }
+
+	void SetTearStrain(float strain); // 0 disables tearing
+	inline float GetTearStrain() const { return tearStrain; }
+
+	// Breaks the spring between two particles (pool indices) and the bending springs across it.
+	// Returns false if they are not joined.
+	bool BreakSpring(int particle1, int particle2);
+
+	int FindSpring(int particle1, int particle2) const; // -1 if they are not joined
+
+	inline const std::vector<int>& GetParticleSprings(int particle) const { return particleSprings[particle]; }
+
+	// Triangles of CreateClothMesh (2 per quad, in the same order) that lost a side, in the order
+	// they were torn
+	inline const std::vector<int>& GetTornTriangles() const { return tornTriangles; }
+
+	// Hash over the particles with cells of the thickness, rebuilt at most once per step
+	const SpatialHash& GetParticleHash();
+
+	// Pins only hold the particles with the XPBD solver
+	int AddPin(int x, int y, float compliance = 0.f); // At the current position of the particle
+	void SetPinPosition(int pin, const glm::vec3& position);
+	void ClearPins();
 
 	void ApplyAcceleration(const glm::vec3& acceleration);
 
@@ -34,7 +159,18 @@ public:
 
 	glm::vec3 GetVelocity() const;
 
+	float GetMass() const; // Mass of the particles that are not fixed
+	float GetKineticEnergy() const;
+
+	inline bool IsAwake() const { return awake; }
+	void SetAwake(bool awake);
+
+	inline int GetRestingFrames() const { return restingFrames; }
+	inline void SetRestingFrames(int frames) { restingFrames = frames; }
+
 	
+	inline int GetParticleIndex(int x, int y) const { return y * width + x; } // Index in the particle pool
+
 	inline Particle& GetParticle(int x, int y)
 	{
 		return particles[y * width + x];
@@ -51,7 +187,24 @@ public:
 
 	bool HasParticle(const Particle* particle) const;
 
-	Particle* GetParticleAt(glm::vec3 position);
+	Particle* GetParticleAt(glm::vec3 position); // Nearest particle, O(1) on average through the hash
+
+protected:
+	void AddSpring(int p1, int p2, float restingLength, int type); // And the matching XPBD constraint
+
+	void SortSpringsByColor();
+
+	void BuildParticleSprings();
+
+	// Removing a spring moves the last one of each following color into the hole, so the colors
+	// stay contiguous and valid with a move per color
+	void RemoveSpring(int spring);
+	void MoveSpring(int from, int to);
+
+	void TearTriangles(int particle1, int particle2, int type); // The ones beside the spring
+	void TearTriangle(int x, int y, int triangle);
+
+	void SolveConstraints(float deltaTime);
 };
 
 // Seria mas adecuado ponerlo en otro archivo
@@ -59,4 +212,8 @@ public:
 
 void SetClothModel(Model& model, const Cloth& cloth);
 
+// Collapses the triangles torn since the last call and uploads the changed indices. Returns the
+// number of triangles removed from the mesh.
+int UpdateClothMeshIndices(Mesh& mesh, const Cloth& cloth);
+
 Cloth* ToCloth(PhysicsObject* object);
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "ClothCollision.h"
+#include "Collider.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <glm/gtx/norm.hpp>
+
+#define CLOTH_CONTACT_EPSILON 1E-6f
+#define CLOTH_COLLISION_BLOCK 8 // Side of the blocks of particles that query a mesh together
+
+void ClothContacts::Reset(int size)
+{
+	distances.assign(size, FLT_MAX);
+	normals.resize(size);
+	velocities.resize(size);
+	bodies.assign(size, nullptr);
+}
+
+// Closest point by Voronoi regions (Ericson 2005), much cheaper than going through the plane and
+// the edges of the triangle as ClosestPoint does
+static glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 ap = p - a;
+
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+	if (d1 <= 0.f && d2 <= 0.f) return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+	if (d3 >= 0.f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+		return a + ab * (d1 / (d1 - d3));
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+	if (d6 >= 0.f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+		return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	float denominator = 1.f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+static inline bool IsActive(const ParticlePool& pool, int i)
+{
+	return !pool.fixed[i] && pool.awake[i];
+}
+
+bool FindClothContacts(Cloth& cloth, const RigidBody& body, ClothContacts& contacts)
+{
+	const Collider& collider = body.GetCollider();
+	if (collider.type == NO_COLLIDER) return false;
+
+	const SpatialHash& hash = cloth.GetParticleHash();
+	const ParticlePool& pool = cloth.particlePool;
+	float thickness = cloth.GetObstacleThickness();
+
+	AABB bounds = body.GetBounds();
+	glm::vec3 margin(thickness);
+
+	glm::vec3 center = body.GetPosition();
+	glm::vec3 velocity = body.GetVelocity();
+	glm::vec3 angularVelocity = body.GetAngularVelocity();
+	RigidBody* source = const_cast<RigidBody*>(&body);
+	bool touching = false;
+
+	if (collider.type == SPHERE_COLLIDER)
+	{
+		float radius = collider.size.x;
+
+		hash.ForEachInBox(GetMin(bounds) - margin, GetMax(bounds) + margin, [&](int i) {
+			if (!IsActive(pool, i)) return;
+
+			glm::vec3 offset = pool.positions[i] - center;
+			float length = glm::length(offset);
+			float distance = length - radius;
+			if (distance >= thickness || length < CLOTH_CONTACT_EPSILON) return;
+
+			glm::vec3 normal = offset / length;
+			contacts.Add(i, distance, normal, velocity + glm::cross(angularVelocity, normal * radius), source);
+			touching = true;
+		});
+	}
+	else if (collider.type == BOX_COLLIDER)
+	{
+		const glm::mat3& rotation = body.GetRotationMatrix();
+		glm::mat3 inverseRotation = glm::transpose(rotation);
+		glm::vec3 halfExtents = collider.size;
+
+		hash.ForEachInBox(GetMin(bounds) - margin, GetMax(bounds) + margin, [&](int i) {
+			if (!IsActive(pool, i)) return;
+
+			glm::vec3 local = inverseRotation * (pool.positions[i] - center);
+			glm::vec3 clamped = glm::clamp(local, -halfExtents, halfExtents);
+			glm::vec3 outside = local - clamped;
+
+			float distance;
+			glm::vec3 localNormal;
+			glm::vec3 surface;
+
+			if (glm::length2(outside) > CLOTH_CONTACT_EPSILON * CLOTH_CONTACT_EPSILON)
+			{
+				distance = glm::length(outside);
+				if (distance >= thickness) return;
+
+				localNormal = outside / distance;
+				surface = clamped;
+			}
+			else
+			{
+				// Inside: out through the nearest face
+				glm::vec3 depths = halfExtents - glm::abs(local);
+				int axis = depths.x < depths.y ? (depths.x < depths.z ? 0 : 2) : (depths.y < depths.z ? 1 : 2);
+
+				distance = -depths[axis];
+				localNormal = glm::vec3(0.f);
+				localNormal[axis] = local[axis] < 0.f ? -1.f : 1.f;
+				surface = local;
+				surface[axis] = localNormal[axis] * halfExtents[axis];
+			}
+
+			glm::vec3 arm = rotation * surface;
+			contacts.Add(i, distance, rotation * localNormal, velocity + glm::cross(angularVelocity, arm), source);
+			touching = true;
+		});
+	}
+
+	return touching;
+}
+
+// Triangles of the mesh whose local bounds overlap the box
+static void QueryTriangles(const Mesh& mesh, const glm::vec3& min, const glm::vec3& max, std::vector<int>& outTriangles)
+{
+	outTriangles.clear();
+
+	if (mesh.accelerator == 0)
+	{
+		for (int i = 0; i < mesh.GetNumTriangles(); ++i)
+			outTriangles.push_back(i);
+	}
+	else
+	{
+		TraverseBVH(*mesh.accelerator,
+			[&](const BVHNode& node) {
+				return
+					node.max.x >= min.x && max.x >= node.min.x &&
+					node.max.y >= min.y && max.y >= node.min.y &&
+					node.max.z >= min.z && max.z >= node.min.z;
+			},
+			[&](const BVHTriangle& t) {
+				outTriangles.push_back(t.index);
+				return false;
+			}
+		);
+	}
+
+	// A leaf holds a few triangles, so they are also tested against the box
+	outTriangles.erase(
+		std::remove_if(outTriangles.begin(), outTriangles.end(), [&](int t) {
+			Triangle triangle = mesh.GetTriangle(t);
+			glm::vec3 triangleMin = glm::min(glm::min(triangle.a, triangle.b), triangle.c);
+			glm::vec3 triangleMax = glm::max(glm::max(triangle.a, triangle.b), triangle.c);
+			return
+				triangleMax.x < min.x || max.x < triangleMin.x ||
+				triangleMax.y < min.y || max.y < triangleMin.y ||
+				triangleMax.z < min.z || max.z < triangleMin.z;
+		}),
+		outTriangles.end()
+	);
+}
+
+void FindClothContacts(Cloth& cloth, const Model& model, ClothContacts& contacts)
+{
+	const Mesh* mesh = model.GetMesh();
+	if (mesh == 0 || mesh->GetNumTriangles() == 0) return;
+
+	const ParticlePool& pool = cloth.particlePool;
+	int width = cloth.GetWidth();
+	int height = cloth.GetHeight();
+
+	float thickness = cloth.GetObstacleThickness();
+	float maxDepth = std::max(cloth.GetSpacing(), thickness);
+
+	glm::mat4 world = model.GetWorldMatrix();
+	glm::mat4 inverseWorld = glm::inverse(world);
+
+	std::vector<int> triangles;
+
+	// Neighbouring particles of the grid stay close, so each block of them queries the mesh once
+	for (int y0 = 0; y0 < height; y0 += CLOTH_COLLISION_BLOCK)
+	for (int x0 = 0; x0 < width; x0 += CLOTH_COLLISION_BLOCK)
+	{
+		int x1 = std::min(x0 + CLOTH_COLLISION_BLOCK, width);
+		int y1 = std::min(y0 + CLOTH_COLLISION_BLOCK, height);
+
+		glm::vec3 blockMin(FLT_MAX);
+		glm::vec3 blockMax(-FLT_MAX);
+		bool active = false;
+
+		for (int y = y0; y < y1; ++y)
+		for (int x = x0; x < x1; ++x)
+		{
+			int i = y * width + x;
+			if (!IsActive(pool, i)) continue;
+
+			blockMin = glm::min(blockMin, pool.positions[i]);
+			blockMax = glm::max(blockMax, pool.positions[i]);
+			active = true;
+		}
+
+		if (!active) continue;
+
+		blockMin -= glm::vec3(maxDepth);
+		blockMax += glm::vec3(maxDepth);
+
+		// Bounds of the block in the space of the mesh
+		glm::vec3 localMin(FLT_MAX);
+		glm::vec3 localMax(-FLT_MAX);
+
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			glm::vec3 point(
+				corner & 1 ? blockMax.x : blockMin.x,
+				corner & 2 ? blockMax.y : blockMin.y,
+				corner & 4 ? blockMax.z : blockMin.z
+			);
+			glm::vec3 local = glm::vec3(inverseWorld * glm::vec4(point, 1.f));
+			localMin = glm::min(localMin, local);
+			localMax = glm::max(localMax, local);
+		}
+
+		QueryTriangles(*mesh, localMin, localMax, triangles);
+
+		for (int t : triangles)
+		{
+			Triangle local = mesh->GetTriangle(t);
+			glm::vec3 a = glm::vec3(world * glm::vec4(local.a, 1.f));
+			glm::vec3 b = glm::vec3(world * glm::vec4(local.b, 1.f));
+			glm::vec3 c = glm::vec3(world * glm::vec4(local.c, 1.f));
+
+			glm::vec3 faceNormal = glm::cross(b - a, c - a);
+			float area = glm::length(faceNormal);
+			if (area < CLOTH_CONTACT_EPSILON) continue;
+			faceNormal /= area;
+
+			for (int y = y0; y < y1; ++y)
+			for (int x = x0; x < x1; ++x)
+			{
+				int i = y * width + x;
+				if (!IsActive(pool, i)) continue;
+
+				// Most particles are rejected by the distance to the plane of the triangle
+				const glm::vec3& position = pool.positions[i];
+				float distance = glm::dot(position - a, faceNormal);
+				if (distance >= thickness || distance <= -maxDepth) continue;
+
+				glm::vec3 offset = position - ClosestPointOnTriangle(position, a, b, c);
+				float length = glm::length(offset);
+
+				if (distance >= 0.f)
+				{
+					if (length < thickness)
+						contacts.Add(i, length, length > CLOTH_CONTACT_EPSILON ? offset / length : faceNormal, glm::vec3(0.f), nullptr);
+				}
+				else if (length < maxDepth)
+					contacts.Add(i, -length, faceNormal, glm::vec3(0.f), nullptr);
+			}
+		}
+	}
+}
+
+void FindClothContacts(Cloth& cloth, const Plane& plane, ClothContacts& contacts)
+{
+	const ParticlePool& pool = cloth.particlePool;
+	float thickness = cloth.GetObstacleThickness();
+
+	for (int i = 0; i < pool.Size(); ++i)
+	{
+		if (!IsActive(pool, i)) continue;
+
+		float distance = glm::dot(pool.positions[i], plane.normal) - plane.distance;
+		if (distance < thickness)
+			contacts.Add(i, distance, plane.normal, glm::vec3(0.f), nullptr);
+	}
+}
+
+int SolveClothContacts(Cloth& cloth, const ClothContacts& contacts)
+{
+	ParticlePool& pool = cloth.particlePool;
+	float thickness = cloth.GetObstacleThickness();
+	float friction = cloth.GetFriction();
+	int numContacts = 0;
+
+	for (int i = 0; i < pool.Size(); ++i)
+	{
+		if (contacts.distances[i] == FLT_MAX) continue;
+		numContacts++;
+
+		const glm::vec3& normal = contacts.normals[i];
+		pool.positions[i] += normal * (thickness - contacts.distances[i]);
+
+		// Only the velocity relative to the obstacle is changed
+		glm::vec3 relative = pool.velocities[i] - contacts.velocities[i];
+		float normalVelocity = glm::dot(relative, normal);
+		if (normalVelocity >= 0.f) continue;
+
+		glm::vec3 tangent = relative - normal * normalVelocity;
+		float tangentSpeed = glm::length(tangent);
+
+		// The tangential velocity loses up to friction times the normal velocity that was removed
+		if (tangentSpeed > CLOTH_CONTACT_EPSILON)
+			tangent *= std::max(0.f, 1.f - friction * -normalVelocity / tangentSpeed);
+
+		pool.velocities[i] = contacts.velocities[i] + tangent;
+	}
+
+	return numContacts;
+}
\ No newline at end of file
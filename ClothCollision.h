@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Cloth.h"
+#include "RigidBody.h"
+#include "Model.h"
+
+#include <vector>
+
+// Deepest contact of each particle of a cloth against the obstacles. Every obstacle is tested
+// against all the particles at once and the contacts are solved when every obstacle has been
+// tested.
+struct ClothContacts
+{
+	std::vector<float> distances; // Signed distance to the surface, FLT_MAX without contact
+	std::vector<glm::vec3> normals; // Out of the obstacle
+	std::vector<glm::vec3> velocities; // Of the surface of the obstacle at the contact
+	std::vector<RigidBody*> bodies; // nullptr for the static obstacles
+
+	void Reset(int size);
+
+	inline void Add(int particle, float distance, const glm::vec3& normal, const glm::vec3& velocity, RigidBody* body)
+	{
+		if (distance >= distances[particle]) return;
+
+		distances[particle] = distance;
+		normals[particle] = normal;
+		velocities[particle] = velocity;
+		bodies[particle] = body;
+	}
+};
+
+// The particles closer than the obstacle thickness of the cloth are added to the contacts. The
+// ones near a body are found through the hash of the cloth. Fixed and sleeping particles are
+// skipped. Returns true if any particle is within the thickness of the body, even if a deeper
+// contact with another obstacle replaced it.
+bool FindClothContacts(Cloth& cloth, const RigidBody& body, ClothContacts& contacts);
+
+// Blocks of neighbouring particles of the grid find the triangles near them through the
+// accelerator of the mesh. Meshes are thin shells, so a particle only counts as inside up to a
+// spacing behind a triangle.
+void FindClothContacts(Cloth& cloth, const Model& model, ClothContacts& contacts);
+
+void FindClothContacts(Cloth& cloth, const Plane& plane, ClothContacts& contacts);
+
+// Projects the particles out of the obstacles and removes their approaching velocity, with
+// Coulomb friction on the tangential one. The obstacles are not pushed back. Returns the number
+// of particles in contact.
+int SolveClothContacts(Cloth& cloth, const ClothContacts& contacts);
\ No newline at end of file
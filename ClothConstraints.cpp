@@ -0,0 +1,136 @@
+#include "ClothConstraints.h"
+
+#define MIN_CONSTRAINT_LENGTH 1E-6f // Same threshold as the springs
+
+void ClothConstraints::Add(int p1, int p2, float restingLength, float compliance, int type)
+{
+	particle1.push_back(p1);
+	particle2.push_back(p2);
+	restingLengths.push_back(restingLength);
+	compliances.push_back(compliance);
+	lambdas.push_back(0.f);
+	types.push_back((unsigned char)type);
+}
+
+void ClothConstraints::Move(int from, int to)
+{
+	particle1[to] = particle1[from];
+	particle2[to] = particle2[from];
+	restingLengths[to] = restingLengths[from];
+	compliances[to] = compliances[from];
+	lambdas[to] = lambdas[from];
+	types[to] = types[from];
+}
+
+void ClothConstraints::PopBack()
+{
+	particle1.pop_back();
+	particle2.pop_back();
+	restingLengths.pop_back();
+	compliances.pop_back();
+	lambdas.pop_back();
+	types.pop_back();
+}
+
+int ClothConstraints::AddPin(int particle, const glm::vec3& position, float compliance)
+{
+	pinParticles.push_back(particle);
+	pinPositions.push_back(position);
+	pinCompliances.push_back(compliance);
+	pinLambdas.push_back(0.f);
+	return GetNumPins() - 1;
+}
+
+void ClothConstraints::ClearPins()
+{
+	pinParticles.clear();
+	pinPositions.clear();
+	pinCompliances.clear();
+	pinLambdas.clear();
+}
+
+void ClothConstraints::Reserve(int capacity)
+{
+	particle1.reserve(capacity);
+	particle2.reserve(capacity);
+	restingLengths.reserve(capacity);
+	compliances.reserve(capacity);
+	lambdas.reserve(capacity);
+	types.reserve(capacity);
+}
+
+void ClothConstraints::Clear()
+{
+	particle1.clear();
+	particle2.clear();
+	restingLengths.clear();
+	compliances.clear();
+	lambdas.clear();
+	types.clear();
+
+	ClearPins();
+}
+
+void ClothConstraints::ResetMultipliers()
+{
+	for (float& lambda : lambdas)
+		lambda = 0.f;
+	for (float& lambda : pinLambdas)
+		lambda = 0.f;
+}
+
+void SolveClothDistanceConstraints(ClothConstraints& constraints, ParticlePool& pool, const std::vector<float>& weights, float deltaTime, int begin, int end)
+{
+	glm::vec3* position = pool.positions.data();
+	float inverseDeltaTimeSq = 1.f / (deltaTime * deltaTime);
+
+	for (int i = begin; i < end; ++i)
+	{
+		int a = constraints.particle1[i];
+		int b = constraints.particle2[i];
+
+		float weightSum = weights[a] + weights[b];
+		if (weightSum == 0.f) continue;
+
+		glm::vec3 difference = position[b] - position[a];
+		float length = glm::length(difference);
+		if (length < MIN_CONSTRAINT_LENGTH) continue;
+
+		// C = |xb - xa| - restingLength, with gradient n for b and -n for a
+		float C = length - constraints.restingLengths[i];
+		float alpha = constraints.compliances[i] * inverseDeltaTimeSq;
+
+		float deltaLambda = (-C - alpha * constraints.lambdas[i]) / (weightSum + alpha);
+		constraints.lambdas[i] += deltaLambda;
+
+		glm::vec3 correction = difference * (deltaLambda / length);
+		position[a] -= weights[a] * correction;
+		position[b] += weights[b] * correction;
+	}
+}
+
+void SolveClothPins(ClothConstraints& constraints, ParticlePool& pool, const std::vector<float>& weights, float deltaTime)
+{
+	glm::vec3* position = pool.positions.data();
+	float inverseDeltaTimeSq = 1.f / (deltaTime * deltaTime);
+
+	for (int i = 0; i < constraints.GetNumPins(); ++i)
+	{
+		int particle = constraints.pinParticles[i];
+
+		float weight = weights[particle];
+		if (weight == 0.f) continue;
+
+		// C = |x - pinPosition|, which is minimized rather than driven to a resting length
+		glm::vec3 difference = position[particle] - constraints.pinPositions[i];
+		float length = glm::length(difference);
+		if (length < MIN_CONSTRAINT_LENGTH) continue;
+
+		float alpha = constraints.pinCompliances[i] * inverseDeltaTimeSq;
+
+		float deltaLambda = (-length - alpha * constraints.pinLambdas[i]) / (weight + alpha);
+		constraints.pinLambdas[i] += deltaLambda;
+
+		position[particle] += difference * (weight * deltaLambda / length);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ParticlePool.h"
+
+#include <vector>
+
+enum
+{
+	STRETCH_CONSTRAINT, // Horizontal and vertical neighbours
+	SHEAR_CONSTRAINT, // Diagonal neighbours
+	BENDING_CONSTRAINT, // Neighbours two particles away
+	NUM_CLOTH_CONSTRAINT_TYPES
+};
+
+// Constraints of a cloth for the position based solver (XPBD). The compliance is the inverse of
+// the stiffness (0 is rigid) and the multipliers accumulate the corrections of the current step.
+// The endpoints are indices of the particle pool of the cloth, as in ClothSprings.
+struct ClothConstraints
+{
+	// Distance constraints between pairs of particles
+	std::vector<int> particle1;
+	std::vector<int> particle2;
+	std::vector<float> restingLengths;
+	std::vector<float> compliances;
+	std::vector<float> lambdas;
+	std::vector<unsigned char> types;
+
+	// Pins: particles held at a world position
+	std::vector<int> pinParticles;
+	std::vector<glm::vec3> pinPositions;
+	std::vector<float> pinCompliances;
+	std::vector<float> pinLambdas;
+
+	void Add(int p1, int p2, float restingLength, float compliance, int type);
+
+	void Move(int from, int to); // Overwrites the distance constraint to with the constraint from
+
+	void PopBack(); // Removes the last distance constraint
+
+	int AddPin(int particle, const glm::vec3& position, float compliance); // Returns the index of the pin
+
+	void ClearPins();
+
+	void Reserve(int capacity);
+
+	void Clear();
+
+	void ResetMultipliers();
+
+	inline int Size() const { return (int)particle1.size(); }
+	inline int GetNumPins() const { return (int)pinParticles.size(); }
+};
+
+// One Gauss-Seidel pass over the distance constraints [begin, end). The weights are the inverse
+// masses of the particles, 0 for the ones that must not move.
+void SolveClothDistanceConstraints(ClothConstraints& constraints, ParticlePool& pool, const std::vector<float>& weights, float deltaTime, int begin, int end);
+
+// One pass over all the pins
+void SolveClothPins(ClothConstraints& constraints, ParticlePool& pool, const std::vector<float>& weights, float deltaTime);
\ No newline at end of file
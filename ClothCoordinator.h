@@ -5,7 +5,7 @@
 class ClothCoordinator : public Coordinator
 {
 public:
-	void coordinate(Model* model, PhysicsObject* object) const
+	void coordinate(Model* model, PhysicsObject* object, float interpolation = 1.f) const
 	{
 		Cloth* cloth = ToCloth(object);
 		if (!cloth) return;
@@ -22,16 +22,22 @@ public:
 		for (int y = 0; y < height; ++y)
 		for (int x = 0; x < width; ++x)
 		{
-			mesh->vertices[x + y * width].position = cloth->GetParticle(x, y).GetPosition();
+			glm::vec3 position = cloth->particlePool.GetInterpolatedPosition(cloth->GetParticleIndex(x, y), interpolation);
+
+			mesh->vertices[x + y * width].position = position;
 			mesh->vertices[x + y * width].normal = glm::vec3(0.f);
 
-			mesh->vertices[numVerticesFace1 + x + y * width].position = cloth->GetParticle(x, y).GetPosition();
+			mesh->vertices[numVerticesFace1 + x + y * width].position = position;
 			mesh->vertices[numVerticesFace1 + x + y * width].normal = glm::vec3(0.f);
 		}
 
-		// Calculate the normals
+		UpdateClothMeshIndices(*mesh, *cloth);
+
+		// Calculate the normals, the torn triangles are collapsed into a vertex
 		for (int i = 0; i < mesh->GetNumTriangles(); ++i)
 		{
+			if (mesh->indices[i * 3 + 0] == mesh->indices[i * 3 + 1]) continue;
+
 			Triangle t = mesh->GetTriangle(i);
 			glm::vec3 normal = -glm::normalize(glm::cross(t.b - t.a, t.c - t.a));
 
@@ -43,7 +49,9 @@ public:
 		// Normalize the normals
 		for (int i = 0; i < mesh->GetNumVertices(); ++i)
 		{
-			mesh->vertices[i].normal = glm::normalize(mesh->vertices[i].normal);
+			// The vertices left without triangles keep a zero normal
+			if (mesh->vertices[i].normal != glm::vec3(0.f))
+				mesh->vertices[i].normal = glm::normalize(mesh->vertices[i].normal);
 		}
 
 		// apply the changes
@@ -51,5 +59,4 @@ public:
 
 		model->SetContent(mesh);
 	}
-};
-
+};
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "ClothSprings.h"
+
+#if defined(__AVX2__)
+#define CLOTH_SPRINGS_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLOTH_SPRINGS_SSE
+#include <emmintrin.h>
+#endif
+
+#define MIN_SPRING_LENGTH 1E-6f // Same threshold as Spring::applyForce
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "The kernels read glm::vec3 arrays as packed floats");
+
+void ClothSprings::Add(int p1, int p2, float k, float restingLength, float damping)
+{
+	particle1.push_back(p1);
+	particle2.push_back(p2);
+	constants.push_back(k);
+	restingLengths.push_back(restingLength);
+	dampings.push_back(damping);
+}
+
+void ClothSprings::Move(int from, int to)
+{
+	particle1[to] = particle1[from];
+	particle2[to] = particle2[from];
+	constants[to] = constants[from];
+	restingLengths[to] = restingLengths[from];
+	dampings[to] = dampings[from];
+}
+
+void ClothSprings::PopBack()
+{
+	particle1.pop_back();
+	particle2.pop_back();
+	constants.pop_back();
+	restingLengths.pop_back();
+	dampings.pop_back();
+}
+
+void ClothSprings::Reserve(int capacity)
+{
+	particle1.reserve(capacity);
+	particle2.reserve(capacity);
+	constants.reserve(capacity);
+	restingLengths.reserve(capacity);
+	dampings.reserve(capacity);
+}
+
+void ClothSprings::Clear()
+{
+	particle1.clear();
+	particle2.clear();
+	constants.clear();
+	restingLengths.clear();
+	dampings.clear();
+}
+
+static inline void ApplyClothSpringForce(const ClothSprings& springs, ParticlePool& pool, int i)
+{
+	int a = springs.particle1[i];
+	int b = springs.particle2[i];
+
+	glm::vec3 relativePosition = pool.positions[b] - pool.positions[a];
+	glm::vec3 relativeVelocity = pool.velocities[b] - pool.velocities[a];
+
+	float length = glm::length(relativePosition);
+	if (length < MIN_SPRING_LENGTH) return;
+
+	float scale = springs.constants[i] * (length - springs.restingLengths[i]) / length;
+	glm::vec3 force = scale * relativePosition + springs.dampings[i] * relativeVelocity;
+
+	pool.forces[a] += force;
+	pool.forces[b] -= force;
+}
+
+#ifdef CLOTH_SPRINGS_AVX2
+
+// Computes 8 springs per iteration gathering straight from the pool arrays. The forces are
+// scattered one lane at a time, so springs of the same batch may share particles.
+static void ApplyClothSpringForcesAVX2(const ClothSprings& springs, ParticlePool& pool, int& i, int end)
+{
+	const float* position = &pool.positions[0].x;
+	const float* velocity = &pool.velocities[0].x;
+	glm::vec3* force = pool.forces.data();
+
+	const __m256i three = _mm256_set1_epi32(3);
+	const __m256 minLength = _mm256_set1_ps(MIN_SPRING_LENGTH);
+
+	alignas(32) float fx[8], fy[8], fz[8];
+
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(springs.particle1.data() + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(springs.particle2.data() + i));
+		__m256i offsetA = _mm256_mullo_epi32(a, three);
+		__m256i offsetB = _mm256_mullo_epi32(b, three);
+
+		__m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(position + 0, offsetB, 4), _mm256_i32gather_ps(position + 0, offsetA, 4));
+		__m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(position + 1, offsetB, 4), _mm256_i32gather_ps(position + 1, offsetA, 4));
+		__m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(position + 2, offsetB, 4), _mm256_i32gather_ps(position + 2, offsetA, 4));
+
+		__m256 dvx = _mm256_sub_ps(_mm256_i32gather_ps(velocity + 0, offsetB, 4), _mm256_i32gather_ps(velocity + 0, offsetA, 4));
+		__m256 dvy = _mm256_sub_ps(_mm256_i32gather_ps(velocity + 1, offsetB, 4), _mm256_i32gather_ps(velocity + 1, offsetA, 4));
+		__m256 dvz = _mm256_sub_ps(_mm256_i32gather_ps(velocity + 2, offsetB, 4), _mm256_i32gather_ps(velocity + 2, offsetA, 4));
+
+		__m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		__m256 length = _mm256_sqrt_ps(lengthSq);
+		__m256 valid = _mm256_cmp_ps(length, minLength, _CMP_GE_OQ);
+
+		__m256 k = _mm256_loadu_ps(springs.constants.data() + i);
+		__m256 restingLength = _mm256_loadu_ps(springs.restingLengths.data() + i);
+		__m256 damping = _mm256_loadu_ps(springs.dampings.data() + i);
+
+		__m256 scale = _mm256_div_ps(_mm256_mul_ps(k, _mm256_sub_ps(length, restingLength)), _mm256_max_ps(length, minLength));
+
+		_mm256_store_ps(fx, _mm256_and_ps(valid, _mm256_add_ps(_mm256_mul_ps(scale, dx), _mm256_mul_ps(damping, dvx))));
+		_mm256_store_ps(fy, _mm256_and_ps(valid, _mm256_add_ps(_mm256_mul_ps(scale, dy), _mm256_mul_ps(damping, dvy))));
+		_mm256_store_ps(fz, _mm256_and_ps(valid, _mm256_add_ps(_mm256_mul_ps(scale, dz), _mm256_mul_ps(damping, dvz))));
+
+		for (int lane = 0; lane < 8; ++lane)
+		{
+			glm::vec3 f(fx[lane], fy[lane], fz[lane]);
+			force[springs.particle1[i + lane]] += f;
+			force[springs.particle2[i + lane]] -= f;
+		}
+	}
+}
+
+#endif // CLOTH_SPRINGS_AVX2
+
+#ifdef CLOTH_SPRINGS_SSE
+
+// Same as the AVX2 kernel with 4 springs per iteration. SSE has no gather, so the lanes are
+// loaded one by one.
+static void ApplyClothSpringForcesSSE(const ClothSprings& springs, ParticlePool& pool, int& i, int end)
+{
+	const glm::vec3* position = pool.positions.data();
+	const glm::vec3* velocity = pool.velocities.data();
+	glm::vec3* force = pool.forces.data();
+
+	const __m128 minLength = _mm_set1_ps(MIN_SPRING_LENGTH);
+
+	alignas(16) float fx[4], fy[4], fz[4];
+
+	for (; i + 4 <= end; i += 4)
+	{
+		const int* a = springs.particle1.data() + i;
+		const int* b = springs.particle2.data() + i;
+
+		__m128 dx = _mm_set_ps(position[b[3]].x - position[a[3]].x, position[b[2]].x - position[a[2]].x, position[b[1]].x - position[a[1]].x, position[b[0]].x - position[a[0]].x);
+		__m128 dy = _mm_set_ps(position[b[3]].y - position[a[3]].y, position[b[2]].y - position[a[2]].y, position[b[1]].y - position[a[1]].y, position[b[0]].y - position[a[0]].y);
+		__m128 dz = _mm_set_ps(position[b[3]].z - position[a[3]].z, position[b[2]].z - position[a[2]].z, position[b[1]].z - position[a[1]].z, position[b[0]].z - position[a[0]].z);
+
+		__m128 dvx = _mm_set_ps(velocity[b[3]].x - velocity[a[3]].x, velocity[b[2]].x - velocity[a[2]].x, velocity[b[1]].x - velocity[a[1]].x, velocity[b[0]].x - velocity[a[0]].x);
+		__m128 dvy = _mm_set_ps(velocity[b[3]].y - velocity[a[3]].y, velocity[b[2]].y - velocity[a[2]].y, velocity[b[1]].y - velocity[a[1]].y, velocity[b[0]].y - velocity[a[0]].y);
+		__m128 dvz = _mm_set_ps(velocity[b[3]].z - velocity[a[3]].z, velocity[b[2]].z - velocity[a[2]].z, velocity[b[1]].z - velocity[a[1]].z, velocity[b[0]].z - velocity[a[0]].z);
+
+		__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 length = _mm_sqrt_ps(lengthSq);
+		__m128 valid = _mm_cmpge_ps(length, minLength);
+
+		__m128 k = _mm_loadu_ps(springs.constants.data() + i);
+		__m128 restingLength = _mm_loadu_ps(springs.restingLengths.data() + i);
+		__m128 damping = _mm_loadu_ps(springs.dampings.data() + i);
+
+		__m128 scale = _mm_div_ps(_mm_mul_ps(k, _mm_sub_ps(length, restingLength)), _mm_max_ps(length, minLength));
+
+		_mm_store_ps(fx, _mm_and_ps(valid, _mm_add_ps(_mm_mul_ps(scale, dx), _mm_mul_ps(damping, dvx))));
+		_mm_store_ps(fy, _mm_and_ps(valid, _mm_add_ps(_mm_mul_ps(scale, dy), _mm_mul_ps(damping, dvy))));
+		_mm_store_ps(fz, _mm_and_ps(valid, _mm_add_ps(_mm_mul_ps(scale, dz), _mm_mul_ps(damping, dvz))));
+
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			glm::vec3 f(fx[lane], fy[lane], fz[lane]);
+			force[a[lane]] += f;
+			force[b[lane]] -= f;
+		}
+	}
+}
+
+#endif // CLOTH_SPRINGS_SSE
+
+void ApplyClothSpringForces(const ClothSprings& springs, ParticlePool& pool, int begin, int end)
+{
+	int i = begin;
+
+#if defined(CLOTH_SPRINGS_AVX2)
+	ApplyClothSpringForcesAVX2(springs, pool, i, end);
+#elif defined(CLOTH_SPRINGS_SSE)
+	ApplyClothSpringForcesSSE(springs, pool, i, end);
+#endif
+
+	// Remaining springs (or all of them without SIMD support)
+	for (; i < end; ++i)
+		ApplyClothSpringForce(springs, pool, i);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ParticlePool.h"
+
+#include <vector>
+
+// Springs of a cloth stored as flat arrays. The endpoints are indices of the particle pool of
+// the cloth, so the forces are computed straight from the position and velocity arrays.
+struct ClothSprings
+{
+	std::vector<int> particle1;
+	std::vector<int> particle2;
+	std::vector<float> restingLengths;
+	std::vector<float> constants;
+	std::vector<float> dampings;
+
+	void Add(int p1, int p2, float k, float restingLength, float damping = 1.f);
+
+	void Move(int from, int to); // Overwrites the spring to with the spring from
+
+	void PopBack();
+
+	void Reserve(int capacity);
+
+	void Clear();
+
+	inline int Size() const { return (int)particle1.size(); }
+};
+
+// Adds the forces of the springs [begin, end) to the particles of the pool.
+// Uses AVX2 (8 springs per iteration) or SSE (4 springs per iteration) when available.
+void ApplyClothSpringForces(const ClothSprings& springs, ParticlePool& pool, int begin, int end);
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "Collider.h"
+
+AABB GetBounds(const Collider& collider, const glm::vec3& position, const glm::quat& orientation)
+{
+	switch (collider.type)
+	{
+	case BOX_COLLIDER:
+	{
+		// Extent of the rotated box along each world axis
+		glm::mat3 rotation = glm::mat3_cast(orientation);
+		glm::vec3 halfSize(0.f);
+		for (int i = 0; i < 3; ++i)
+			halfSize += glm::abs(rotation[i]) * collider.size[i];
+
+		return AABB(position, halfSize);
+	}
+
+	case SPHERE_COLLIDER:
+		return AABB(position, glm::vec3(collider.size.x));
+	}
+
+	return AABB(position, glm::vec3(0.f));
+}
+
+OBB GetOBB(const Collider& collider, const glm::vec3& position, const glm::quat& orientation)
+{
+	// SimpleGeometry reads the axes of an OBB from the rows of its orientation
+	return OBB(position, collider.size, glm::transpose(glm::mat3_cast(orientation)));
+}
+
+Sphere GetSphere(const Collider& collider, const glm::vec3& position)
+{
+	return Sphere(position, collider.size.x);
+}
\ No newline at end of file
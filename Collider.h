@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "SimpleGeometry.h"
+
+enum
+{
+	NO_COLLIDER,
+	BOX_COLLIDER,
+	SPHERE_COLLIDER
+};
+
+// Collision shape of a rigid body. It is defined in object space and centered on the center of mass.
+struct Collider
+{
+	int type;
+	glm::vec3 size; // Half extents of the box, or the radius of the sphere in x
+
+	inline Collider() : type(NO_COLLIDER), size(0.f) {}
+
+	inline Collider(int type, const glm::vec3& size) : type(type), size(size) {}
+};
+
+inline Collider BoxCollider(const glm::vec3& halfExtents) { return Collider(BOX_COLLIDER, halfExtents); }
+
+inline Collider SphereCollider(float radius) { return Collider(SPHERE_COLLIDER, glm::vec3(radius)); }
+
+// World space shapes of a collider placed at the given transform
+AABB GetBounds(const Collider& collider, const glm::vec3& position, const glm::quat& orientation);
+
+OBB GetOBB(const Collider& collider, const glm::vec3& position, const glm::quat& orientation);
+
+Sphere GetSphere(const Collider& collider, const glm::vec3& position);
\ No newline at end of file
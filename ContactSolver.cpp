@@ -0,0 +1,260 @@
+#include "ContactSolver.h"
+
+#include <algorithm>
+
+#define CONTACT_MATCH_DISTANCE_SQ 0.0025f // Cached points closer than 5 cm are the same contact
+
+static inline void GetTangents(const glm::vec3& normal, glm::vec3& tangent1, glm::vec3& tangent2)
+{
+	if (fabsf(normal.x) >= 0.57735f)
+		tangent1 = glm::normalize(glm::vec3(normal.y, -normal.x, 0.f));
+	else
+		tangent1 = glm::normalize(glm::vec3(0.f, normal.z, -normal.y));
+
+	tangent2 = glm::cross(normal, tangent1);
+}
+
+int ContactSolver::AddBody(RigidBody* body, float deltaTime)
+{
+	if (body == nullptr) return -1;
+
+	auto found = bodyIndices.find(body);
+	if (found != bodyIndices.end()) return found->second;
+
+	SolverBody solverBody;
+	solverBody.body = body;
+	solverBody.inverseMass = body->GetInverseMass();
+	solverBody.inverseInertia = body->GetWorldInverseInertiaTensor();
+
+	// Solve on the velocities the forces of this step will produce, so that gravity does not
+	// push the bodies into the ground after the contacts are solved
+	glm::vec3 velocity = body->GetVelocity();
+	glm::vec3 angularVelocity = body->GetAngularVelocity();
+
+	glm::vec3 force = body->GetForce() - velocity * body->GetDamping();
+	glm::vec3 torque = body->GetTorque() - angularVelocity * body->GetAngularDamping();
+
+	solverBody.initialVelocity = velocity + force * (solverBody.inverseMass * deltaTime);
+	solverBody.initialAngularVelocity = angularVelocity + solverBody.inverseInertia * torque * deltaTime;
+	solverBody.velocity = solverBody.initialVelocity;
+	solverBody.angularVelocity = solverBody.initialAngularVelocity;
+
+	int index = (int)bodies.size();
+	bodies.push_back(solverBody);
+	bodyIndices[body] = index;
+	return index;
+}
+
+void ContactSolver::Prepare(const std::vector<ContactManifold>& contacts, ContactCache& cache, float deltaTime)
+{
+	bodies.clear();
+	bodyIndices.clear();
+	constraints.clear();
+	constraints.reserve(contacts.size());
+
+	for (const ContactManifold& manifold : contacts)
+	{
+		SolverConstraint constraint;
+		constraint.body1 = AddBody(manifold.body1, deltaTime);
+		constraint.body2 = AddBody(manifold.body2, deltaTime);
+		constraint.cache = &cache[ContactKey(manifold.body1, manifold.body2, manifold.plane)];
+		constraint.normal = manifold.normal;
+		GetTangents(manifold.normal, constraint.tangents[0], constraint.tangents[1]);
+		constraint.numPoints = manifold.numContacts;
+
+		const SolverBody* body1 = constraint.body1 != -1 ? &bodies[constraint.body1] : nullptr;
+		const SolverBody* body2 = constraint.body2 != -1 ? &bodies[constraint.body2] : nullptr;
+
+		const ContactCacheEntry* cached = constraint.cache;
+
+		for (int i = 0; i < manifold.numContacts; ++i)
+		{
+			SolverPoint& point = constraint.points[i];
+			const glm::vec3& contact = manifold.contacts[i];
+
+			point.r1 = body1 ? contact - body1->body->GetPosition() : glm::vec3(0.f);
+			point.r2 = body2 ? contact - body2->body->GetPosition() : glm::vec3(0.f);
+
+			// Effective masses along the normal and the tangents
+			glm::vec3 axes[3] = { constraint.normal, constraint.tangents[0], constraint.tangents[1] };
+			float masses[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				float k = 0.f;
+				if (body1)
+				{
+					glm::vec3 rn = glm::cross(point.r1, axes[a]);
+					k += body1->inverseMass + glm::dot(rn, body1->inverseInertia * rn);
+				}
+				if (body2)
+				{
+					glm::vec3 rn = glm::cross(point.r2, axes[a]);
+					k += body2->inverseMass + glm::dot(rn, body2->inverseInertia * rn);
+				}
+				masses[a] = k > 0.f ? 1.f / k : 0.f;
+			}
+			point.normalMass = masses[0];
+			point.tangentMass[0] = masses[1];
+			point.tangentMass[1] = masses[2];
+
+			// Push out a fraction of the penetration, and bounce the fast impacts
+			glm::vec3 relativeVelocity(0.f);
+			if (body2) relativeVelocity += body2->velocity + glm::cross(body2->angularVelocity, point.r2);
+			if (body1) relativeVelocity -= body1->velocity + glm::cross(body1->angularVelocity, point.r1);
+			float normalVelocity = glm::dot(relativeVelocity, constraint.normal);
+
+			point.velocityBias = baumgarte / deltaTime * std::max(manifold.depths[i] - slop, 0.f);
+			if (normalVelocity < -restitutionThreshold)
+				point.velocityBias = std::max(point.velocityBias, -restitution * normalVelocity);
+
+			// Impulses of the same point in the last frame
+			point.normalImpulse = 0.f;
+			point.tangentImpulse[0] = 0.f;
+			point.tangentImpulse[1] = 0.f;
+
+			if (!warmStarting || !body1) continue;
+
+			glm::vec3 localPoint = glm::inverse(body1->body->GetOrientation()) * point.r1;
+			for (int c = 0; c < cached->numContacts; ++c)
+			{
+				if (glm::distance2(localPoint, cached->localPoints[c]) < CONTACT_MATCH_DISTANCE_SQ)
+				{
+					point.normalImpulse = cached->normalImpulses[c];
+					point.tangentImpulse[0] = glm::dot(cached->tangentImpulses[c], constraint.tangents[0]);
+					point.tangentImpulse[1] = glm::dot(cached->tangentImpulses[c], constraint.tangents[1]);
+					break;
+				}
+			}
+		}
+
+		constraints.push_back(constraint);
+	}
+}
+
+static inline void ApplySolverImpulse(glm::vec3& velocity, glm::vec3& angularVelocity, float inverseMass, const glm::mat3& inverseInertia, const glm::vec3& r, const glm::vec3& impulse)
+{
+	velocity += inverseMass * impulse;
+	angularVelocity += inverseInertia * glm::cross(r, impulse);
+}
+
+void ContactSolver::WarmStart()
+{
+	for (SolverConstraint& constraint : constraints)
+	{
+		SolverBody* body1 = constraint.body1 != -1 ? &bodies[constraint.body1] : nullptr;
+		SolverBody* body2 = constraint.body2 != -1 ? &bodies[constraint.body2] : nullptr;
+
+		for (int i = 0; i < constraint.numPoints; ++i)
+		{
+			SolverPoint& point = constraint.points[i];
+			glm::vec3 impulse =
+				point.normalImpulse * constraint.normal +
+				point.tangentImpulse[0] * constraint.tangents[0] +
+				point.tangentImpulse[1] * constraint.tangents[1];
+
+			if (body1) ApplySolverImpulse(body1->velocity, body1->angularVelocity, body1->inverseMass, body1->inverseInertia, point.r1, -impulse);
+			if (body2) ApplySolverImpulse(body2->velocity, body2->angularVelocity, body2->inverseMass, body2->inverseInertia, point.r2, impulse);
+		}
+	}
+}
+
+void ContactSolver::SolveVelocities()
+{
+	for (SolverConstraint& constraint : constraints)
+	{
+		SolverBody* body1 = constraint.body1 != -1 ? &bodies[constraint.body1] : nullptr;
+		SolverBody* body2 = constraint.body2 != -1 ? &bodies[constraint.body2] : nullptr;
+
+		for (int i = 0; i < constraint.numPoints; ++i)
+		{
+			SolverPoint& point = constraint.points[i];
+
+			// Friction first: the normal constraint is more important, so it goes last
+			for (int t = 0; t < 2; ++t)
+			{
+				glm::vec3 relativeVelocity(0.f);
+				if (body2) relativeVelocity += body2->velocity + glm::cross(body2->angularVelocity, point.r2);
+				if (body1) relativeVelocity -= body1->velocity + glm::cross(body1->angularVelocity, point.r1);
+
+				float lambda = -point.tangentMass[t] * glm::dot(relativeVelocity, constraint.tangents[t]);
+
+				// Coulomb cone approximated by a box
+				float maxFriction = friction * point.normalImpulse;
+				float newImpulse = glm::clamp(point.tangentImpulse[t] + lambda, -maxFriction, maxFriction);
+				lambda = newImpulse - point.tangentImpulse[t];
+				point.tangentImpulse[t] = newImpulse;
+
+				glm::vec3 impulse = lambda * constraint.tangents[t];
+				if (body1) ApplySolverImpulse(body1->velocity, body1->angularVelocity, body1->inverseMass, body1->inverseInertia, point.r1, -impulse);
+				if (body2) ApplySolverImpulse(body2->velocity, body2->angularVelocity, body2->inverseMass, body2->inverseInertia, point.r2, impulse);
+			}
+
+			glm::vec3 relativeVelocity(0.f);
+			if (body2) relativeVelocity += body2->velocity + glm::cross(body2->angularVelocity, point.r2);
+			if (body1) relativeVelocity -= body1->velocity + glm::cross(body1->angularVelocity, point.r1);
+
+			float lambda = point.normalMass * (point.velocityBias - glm::dot(relativeVelocity, constraint.normal));
+
+			// The accumulated impulse can only push
+			float newImpulse = std::max(point.normalImpulse + lambda, 0.f);
+			lambda = newImpulse - point.normalImpulse;
+			point.normalImpulse = newImpulse;
+
+			glm::vec3 impulse = lambda * constraint.normal;
+			if (body1) ApplySolverImpulse(body1->velocity, body1->angularVelocity, body1->inverseMass, body1->inverseInertia, point.r1, -impulse);
+			if (body2) ApplySolverImpulse(body2->velocity, body2->angularVelocity, body2->inverseMass, body2->inverseInertia, point.r2, impulse);
+		}
+	}
+}
+
+void ContactSolver::StoreImpulses()
+{
+	for (const SolverConstraint& constraint : constraints)
+	{
+		ContactCacheEntry* cache = constraint.cache;
+		const SolverBody* body1 = constraint.body1 != -1 ? &bodies[constraint.body1] : nullptr;
+		if (!body1)
+		{
+			cache->numContacts = 0;
+			continue;
+		}
+
+		glm::quat inverseOrientation = glm::inverse(body1->body->GetOrientation());
+
+		cache->numContacts = constraint.numPoints;
+		for (int i = 0; i < constraint.numPoints; ++i)
+		{
+			const SolverPoint& point = constraint.points[i];
+			cache->localPoints[i] = inverseOrientation * point.r1;
+			cache->normalImpulses[i] = point.normalImpulse;
+			cache->tangentImpulses[i] = point.tangentImpulse[0] * constraint.tangents[0] + point.tangentImpulse[1] * constraint.tangents[1];
+		}
+	}
+}
+
+void ContactSolver::ApplyVelocities()
+{
+	// Only the change is applied: the integration of the bodies adds the forces again
+	for (const SolverBody& solverBody : bodies)
+	{
+		RigidBody* body = solverBody.body;
+		body->SetVelocity(body->GetVelocity() + solverBody.velocity - solverBody.initialVelocity);
+		body->SetAngularVelocity(body->GetAngularVelocity() + solverBody.angularVelocity - solverBody.initialAngularVelocity);
+	}
+}
+
+void ContactSolver::Solve(const std::vector<ContactManifold>& contacts, ContactCache& cache, float deltaTime)
+{
+	if (contacts.empty() || deltaTime <= 0.f) return;
+
+	Prepare(contacts, cache, deltaTime);
+
+	if (warmStarting)
+		WarmStart();
+
+	for (int i = 0; i < iterations; ++i)
+		SolveVelocities();
+
+	StoreImpulses();
+	ApplyVelocities();
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Narrowphase.h"
+
+#include <vector>
+#include <unordered_map>
+
+#define DEFAULT_CONTACT_ITERATIONS 8
+
+// Sequential impulses solver for the contacts and their friction. The accumulated impulses
+// are kept in the contact cache and applied again at the start of the next solve (warm
+// starting), so resting contacts converge in a few iterations.
+class ContactSolver
+{
+protected:
+	struct SolverBody
+	{
+		RigidBody* body;
+		glm::vec3 velocity; // Includes the velocity gained from the forces of this step
+		glm::vec3 angularVelocity; // World space
+		glm::vec3 initialVelocity;
+		glm::vec3 initialAngularVelocity;
+		float inverseMass;
+		glm::mat3 inverseInertia; // World space
+	};
+
+	struct SolverPoint
+	{
+		glm::vec3 r1, r2; // From the centers of mass to the contact
+		float normalMass;
+		float tangentMass[2];
+		float velocityBias;
+		float normalImpulse;
+		float tangentImpulse[2];
+	};
+
+	struct SolverConstraint
+	{
+		int body1, body2; // -1 for static geometry
+		ContactCacheEntry* cache;
+		glm::vec3 normal;
+		glm::vec3 tangents[2];
+		int numPoints;
+		SolverPoint points[MAX_CONTACT_POINTS];
+	};
+
+	std::vector<SolverBody> bodies;
+	std::unordered_map<RigidBody*, int> bodyIndices;
+	std::vector<SolverConstraint> constraints;
+
+	int AddBody(RigidBody* body, float deltaTime);
+
+	void Prepare(const std::vector<ContactManifold>& contacts, ContactCache& cache, float deltaTime);
+	void WarmStart();
+	void SolveVelocities();
+	void StoreImpulses();
+	void ApplyVelocities();
+
+public:
+	int iterations = DEFAULT_CONTACT_ITERATIONS;
+	float friction = 0.5f;
+	float restitution = 0.f;
+	float restitutionThreshold = 1.f; // Slower impacts do not bounce
+	float baumgarte = 0.2f; // Fraction of the penetration corrected per step
+	float slop = 0.005f; // Penetration allowed to keep the contacts stable
+	bool warmStarting = true;
+
+	// Changes the velocities of the bodies so the contacts do not approach. It must run after
+	// the forces of the step are applied and before the bodies are integrated.
+	void Solve(const std::vector<ContactManifold>& contacts, ContactCache& cache, float deltaTime);
+};
\ No newline at end of file
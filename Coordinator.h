@@ -8,6 +8,7 @@ class Coordinator
 public:
 	//Coordinator() = default;
 
-	virtual void coordinate(Model* model, PhysicsObject* object) const { }
+	// interpolation blends the previous (0) and current (1) physics state
+	virtual void coordinate(Model* model, PhysicsObject* object, float interpolation = 1.f) const { }
 };
 
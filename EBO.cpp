@@ -17,6 +17,12 @@ void EBO::Unbind()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+void EBO::Update(const std::vector<GLuint>& indices, int first, int count)
+{
+	Bind();
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * sizeof(GLuint), count * sizeof(GLuint), indices.data() + first);
+}
+
 void EBO::Delete()
 {
 	glDeleteBuffers(1, &ID);
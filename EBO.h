@@ -15,6 +15,10 @@ public:
 	void Bind();
 	void Unbind();
 	void Delete();
+
+	// Uploads the indices [first, first + count). Bind the VAO first, unbinding the buffer would
+	// detach it from the VAO.
+	void Update(const std::vector<GLuint>& indices, int first, int count);
 };
 
 #endif
\ No newline at end of file
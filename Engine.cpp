@@ -5,9 +5,11 @@
 std::vector<GameObject*> addedModels;
 
 Engine::Engine() : 
-	physicsSystem(PhysicsSystem()), 
+	physicsSystem(), 
 	scene(Scene())
-{}
+{
+	physicsSystem.SetStaticScene(&staticScene);
+}
 
 //Engine::~Engine()
 //{
@@ -47,6 +49,9 @@ void Engine::AddObject(GameObject* object)
 	{
 		scene.AddModel(model);
 		modelToObjectMap[model] = object;
+
+		if (object->physics == nullptr)
+			staticScene.AddModel(model);
 	}
 }
 
@@ -80,6 +85,7 @@ void Engine::RemoveGameObject(GameObject* object)
 		for (Model* model : object->models)
 		{
 			scene.RemoveModel(model);
+			staticScene.RemoveModel(model);
 			modelToObjectMap.erase(model);
 		}
 
@@ -90,7 +96,45 @@ void Engine::RemoveGameObject(GameObject* object)
 
 void Engine::Update(float deltaTime)
 {
-	physicsSystem.Update(deltaTime);
+	accumulator += deltaTime;
+
+	// Avoid the spiral of death: if the simulation can not keep up, slow it down instead
+	float maxAccumulator = fixedDeltaTime * maxStepsPerFrame;
+	if (accumulator > maxAccumulator)
+		accumulator = maxAccumulator;
+
+	float substepDeltaTime = fixedDeltaTime / substeps;
+
+	substepStats = SubstepStats();
+
+	while (accumulator >= fixedDeltaTime)
+	{
+		physicsSystem.SaveState();
+
+		for (int i = 0; i < substeps; ++i)
+		{
+			if (forceCallback) forceCallback();
+			physicsSystem.Update(substepDeltaTime);
+			substepStats.Add(physicsSystem.GetSubstepStats());
+		}
+
+		accumulator -= fixedDeltaTime;
+	}
+
+	interpolation = accumulator / fixedDeltaTime;
+}
+
+void Engine::SetFixedTimeStep(float fixedDeltaTime, int substeps, int maxStepsPerFrame)
+{
+	if (fixedDeltaTime <= 0.f || substeps < 1 || maxStepsPerFrame < 1)
+	{
+		std::cout << "Invalid fixed time step configuration." << std::endl;
+		return;
+	}
+
+	this->fixedDeltaTime = fixedDeltaTime;
+	this->substeps = substeps;
+	this->maxStepsPerFrame = maxStepsPerFrame;
 }
 
 void Engine::Coordinate()
@@ -100,7 +144,7 @@ void Engine::Coordinate()
 		for (Model* model : object->models)
 		{
 			if (object->coordinators[model] != nullptr)
-				object->coordinators[model]->coordinate(model, object->physics);
+				object->coordinators[model]->coordinate(model, object->physics, interpolation);
 		}
 	}
 }
@@ -5,15 +5,31 @@
 #include "GameObject.h"
 #include "GameSelection.h"
 #include <unordered_map>
+#include <functional>
+
+#define DEFAULT_FIXED_DELTA_TIME (1.f / 240.f)
+#define DEFAULT_MAX_STEPS_PER_FRAME 8
 
 class Engine
 {
 private:
 	std::unordered_map<Model*, GameObject*> modelToObjectMap;
 
+	// Fixed timestep
+	float fixedDeltaTime = DEFAULT_FIXED_DELTA_TIME;
+	int substeps = 1; // Physics updates per fixed step
+	int maxStepsPerFrame = DEFAULT_MAX_STEPS_PER_FRAME; // Catch-up budget, the time beyond it is dropped
+	float accumulator = 0.f;
+	float interpolation = 1.f; // Fraction of a fixed step left in the accumulator
+
+	SubstepStats substepStats; // Of the physics updates of the last frame
+
+	std::function<void()> forceCallback;
+
 public:
 	PhysicsSystem physicsSystem;
 	Scene scene;
+	Scene staticScene; // Models without a physics object, the cloths collide with them
 
 	std::vector<GameObject*> objects;
 
@@ -25,8 +41,19 @@ public:
 
 	void RemoveGameObject(GameObject* object);
 
+	// Advances the simulation by the elapsed frame time in steps of fixed size
 	void Update(float deltaTime);
 
+	void SetFixedTimeStep(float fixedDeltaTime, int substeps = 1, int maxStepsPerFrame = DEFAULT_MAX_STEPS_PER_FRAME);
+	inline float GetFixedDeltaTime() const { return fixedDeltaTime; }
+	inline int GetSubsteps() const { return substeps; }
+	inline float GetInterpolation() const { return interpolation; }
+	inline const SubstepStats& GetSubstepStats() const { return substepStats; }
+
+	// Called before every physics update. Forces are cleared after each update, so the external
+	// ones (gravity, wind...) must be applied here rather than once per frame.
+	inline void SetForceCallback(const std::function<void()>& callback) { forceCallback = callback; }
+
 	void Coordinate();
 
 	void Render(const Frustum& frustum, Shader& shader, const char* uniformName);
@@ -4,6 +4,7 @@
 #include "GameParticle.h"
 #include "GameRigidBody.h"
 #include "GameCloth.h"
+#include "GameRope.h"
 #include "RigidBodyPoint.h"
 #include "ApplicationPointCoordinator.h"
 
@@ -43,11 +44,11 @@ public:
 		if (fabsf(radius) > ALMOST_ZERO) SetModel(radius);
 	}
 
-	/*GameApplicationPoint(GameRope rope, glm::vec3 point, float radius = 0.f)
+	GameApplicationPoint(GameRope rope, glm::vec3 point, float radius = 0.f)
 	{
 		physics = rope->GetParticleAt(point);
 		if (fabsf(radius) > ALMOST_ZERO) SetModel(radius);
-	}*/
+	}
 
 	GameApplicationPoint(const glm::vec3& point, float radius = 0.f)
 	{
@@ -78,8 +78,8 @@ private:
 			selectedModel = selection.object->GetModels().front();
 			selectedParticle = ToParticle(selection.object->GetPhysicsObject());
 			offset = selection.point - selectedParticle->GetPosition();
-			particleInitialFix = selectedParticle->fixed;
-			selectedParticle->fixed = true;
+			particleInitialFix = selectedParticle->IsFixed();
+			selectedParticle->SetFixed(true);
 		}
 
 		selectedParticle->SetPosition(cursorPosition - offset);
@@ -91,11 +91,13 @@ private:
 
 		if(!lockedSelection)
 		{
+			// Ropes are held by their nearest particle too
+			PhysicsObject* physics = selection.object->GetPhysicsObject();
 			selectedModel = selection.object->GetModels().front();
-			selectedParticle = ToCloth(selection.object->GetPhysicsObject())->GetParticleAt(selection.point);
+			selectedParticle = physics->GetType() == ROPE ? ToRope(physics)->GetParticleAt(selection.point) : ToCloth(physics)->GetParticleAt(selection.point);
 			offset = selection.point - selectedParticle->GetPosition();
-			particleInitialFix = selectedParticle->fixed;
-			selectedParticle->fixed = true;
+			particleInitialFix = selectedParticle->IsFixed();
+			selectedParticle->SetFixed(true);
 		}
 
 		selectedParticle->SetPosition(cursorPosition - offset);
@@ -112,7 +114,7 @@ private:
 		{
 			cursorParticle = new GameParticle(0.2f, 1.f);
 			(*cursorParticle)->SetPosition(selection.point);
-			(*cursorParticle)->fixed = true;
+			(*cursorParticle)->SetFixed(true);
 			selectedRigidPoint = new GameApplicationPoint(*static_cast<GameRigidBody*>(selection.object), selection.point, 0.f);
 			selectionSpring = new GameSpring(*selectedRigidPoint, *cursorParticle, 1000.f, 0.f);
 			(*selectionSpring)->SetDamping((*selectionSpring)->GetConstant() / 50.f);
@@ -172,7 +174,7 @@ public:
 
 		if(selectedParticle != nullptr)
 		{
-			selectedParticle->fixed = particleInitialFix;
+			selectedParticle->SetFixed(particleInitialFix);
 			selectedParticle = nullptr;
 		}
 
@@ -227,7 +229,7 @@ public:
 			// update cloths accelerators
 			for(GameObject* object : engine.objects)
 			{
-				if(object->GetPhysicsObject() != nullptr && object->GetType() == CLOTH)
+				if(object->GetPhysicsObject() != nullptr && (object->GetType() == CLOTH || object->GetType() == ROPE))
 				{
 					object->GetModels()[0]->GetMesh()->UpdateAccelerator();
 				}
@@ -292,7 +294,7 @@ public:
 		case PARTICLE:
 			HandleParticle();
 			break;
-		case CLOTH:
+		case CLOTH: case ROPE:
 			HandleCloth();
 			break;
 		case RIGID_BODY:
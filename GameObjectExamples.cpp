@@ -91,8 +91,8 @@ GameCloth CreateClothExample()
 
 	GameCloth cloth(clothSize, clothSize, clothSpacing);
 	
-	cloth->GetParticle(0, clothSize - 1).fixed = true;
-	cloth->GetParticle(clothSize - 1, clothSize - 1).fixed = true;
+	cloth->GetParticle(0, clothSize - 1).SetFixed(true);
+	cloth->GetParticle(clothSize - 1, clothSize - 1).SetFixed(true);
 
 	Mesh* clothMesh = cloth.GetMesh();
 
@@ -0,0 +1 @@
+#include "GameRope.h"
\ No newline at end of file
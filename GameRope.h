@@ -0,0 +1,50 @@
+#pragma once
+#include "GameObject.h"
+#include "Rope.h"
+#include "RopeCoordinator.h"
+#include "GeometrySamples.h"
+
+class GameRope : public GameObject
+{
+protected:
+	void AddModel(Model* model, float radius)
+	{
+		models.push_back(model);
+		coordinators[model] = new RopeCoordinator(radius);
+	}
+
+public:
+	GameRope(const glm::vec3& start, const glm::vec3& end, int numParticles, float mass = 1.f, float radius = 0.05f)
+	{
+		physics = new Rope(start, end, numParticles, mass);
+		Mesh* mesh = CreateRopeMesh(GetPhysics()->GetNumberOfParticles(), 8, WHITE);
+		Model* model = new Model(mesh);
+
+		AddModel(model, radius);
+	}
+
+	inline Rope* GetPhysics()
+	{
+		return ToRope(physics);
+	}
+
+	inline const Rope* GetPhysics() const
+	{
+		return ToRope(physics);
+	}
+
+	inline Rope* operator->()
+	{
+		return GetPhysics();
+	}
+
+	inline const Rope* operator->() const
+	{
+		return ToRope(physics);
+	}
+
+	inline Model* GetModel() const
+	{
+		return models[0];
+	}
+};
\ No newline at end of file
@@ -550,4 +550,44 @@ void DrawPlane(const Plane& plane, Shader& shader, const char* uniformLocation,
 	planeModel.orientation = glm::quat(glm::vec3(0.f, 1.f, 0.f), plane.normal);
 
 	planeModel.Render(shader, uniformLocation);
+}
+
+Mesh* CreateRopeMesh(int numParticles, int sectorCount, Color color)
+{
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+
+	float sectorStep = 2.f * glm::pi<float>() / sectorCount;
+
+	for (int i = 0; i < numParticles; ++i)
+	for (int j = 0; j < sectorCount; ++j)
+	{
+		glm::vec3 normal(std::cos(j * sectorStep), 0.f, std::sin(j * sectorStep));
+
+		vertices.push_back(Vertex(
+			glm::vec3(0.f, (float)i, 0.f) + 0.5f * normal,
+			normal,
+			color
+		));
+	}
+
+	for (int i = 0; i < numParticles - 1; ++i)
+	for (int j = 0; j < sectorCount; ++j)
+	{
+		int next = (j + 1) % sectorCount;
+
+		indices.push_back(i * sectorCount + j);
+		indices.push_back(i * sectorCount + next);
+		indices.push_back((i + 1) * sectorCount + j);
+
+		indices.push_back((i + 1) * sectorCount + next);
+		indices.push_back((i + 1) * sectorCount + j);
+		indices.push_back(i * sectorCount + next);
+	}
+
+	Mesh* mesh = new Mesh(vertices, indices, GL_DYNAMIC_DRAW, false);
+
+	loadedMeshes.push_back(mesh);
+
+	return mesh;
 }
\ No newline at end of file
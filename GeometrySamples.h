@@ -14,6 +14,9 @@ Mesh* CreateConeMesh(int sectorCount, Color color = WHITE);
 
 Mesh* CreateClothMesh(int width, int height, Color color = WHITE);
 
+// Tube with a ring of sectorCount vertices per particle, placed by the RopeCoordinator
+Mesh* CreateRopeMesh(int numParticles, int sectorCount, Color color = WHITE);
+
 void DeleteGeometrySamples();
 
 void DrawOBB(const OBB& obb, Shader& shader, const char* uniformLocation, Color color = PURPLE + TRANSPARENCY(0.5f));
@@ -0,0 +1,197 @@
+#include "ImplicitSpringSolver.h"
+
+#include <algorithm>
+
+#define MIN_SPRING_LENGTH 1E-6f // Same threshold as the explicit springs
+
+ImplicitSpringSolver::ImplicitSpringSolver()
+{
+	conjugateGradient.setMaxIterations(DEFAULT_IMPLICIT_ITERATIONS);
+	conjugateGradient.setTolerance(DEFAULT_IMPLICIT_TOLERANCE);
+}
+
+void ImplicitSpringSolver::Build(const ClothSprings& springs, int newNumParticles)
+{
+	numParticles = newNumParticles;
+	numSprings = springs.Size();
+
+	std::vector<Eigen::Triplet<float>> triplets;
+	triplets.reserve(9 * (numParticles + 2 * numSprings));
+
+	auto addBlock = [&triplets](int row, int column) {
+		for (int i = 0; i < 3; ++i)
+			for (int j = 0; j < 3; ++j)
+				triplets.emplace_back(3 * row + i, 3 * column + j, 0.f);
+	};
+
+	for (int i = 0; i < numParticles; ++i)
+		addBlock(i, i);
+
+	for (int s = 0; s < numSprings; ++s)
+	{
+		addBlock(springs.particle1[s], springs.particle2[s]);
+		addBlock(springs.particle2[s], springs.particle1[s]);
+	}
+
+	matrix.resize(3 * numParticles, 3 * numParticles);
+	matrix.setFromTriplets(triplets.begin(), triplets.end());
+	matrix.makeCompressed();
+
+	// Repeated springs share their blocks, the values are added anyway
+	auto getBlock = [this](int row, int column, int* offsets) {
+		for (int i = 0; i < 3; ++i)
+			for (int j = 0; j < 3; ++j)
+				offsets[3 * i + j] = (int)(&matrix.coeffRef(3 * row + i, 3 * column + j) - matrix.valuePtr());
+	};
+
+	diagonalBlocks.resize(9 * numParticles);
+	for (int i = 0; i < numParticles; ++i)
+		getBlock(i, i, &diagonalBlocks[9 * i]);
+
+	springBlocks.resize(18 * numSprings);
+	for (int s = 0; s < numSprings; ++s)
+	{
+		getBlock(springs.particle1[s], springs.particle2[s], &springBlocks[18 * s]);
+		getBlock(springs.particle2[s], springs.particle1[s], &springBlocks[18 * s + 9]);
+	}
+
+	rightHandSide.resize(3 * numParticles);
+	deltaVelocities = Eigen::VectorXf::Zero(3 * numParticles);
+
+	dirty = false;
+}
+
+static inline void AddToBlock(float* values, const int* offsets, const glm::mat3& block)
+{
+	// glm is column major: block[column][row]
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			values[offsets[3 * i + j]] += block[j][i];
+}
+
+void ImplicitSpringSolver::Integrate(const ClothSprings& springs, ParticlePool& pool, float deltaTime)
+{
+	if (dirty || numParticles != pool.Size() || numSprings != springs.Size())
+		Build(springs, pool.Size());
+
+	if (numParticles == 0) return;
+
+	const float h = deltaTime;
+	float* values = matrix.valuePtr();
+	std::fill(values, values + matrix.nonZeros(), 0.f);
+
+	glm::vec3* position = pool.positions.data();
+	glm::vec3* velocity = pool.velocities.data();
+	glm::vec3* force = pool.forces.data();
+
+	// Mass and damping of every particle. The inactive ones get an identity row, and the
+	// springs do not couple them, so their velocity change is 0.
+	for (int i = 0; i < numParticles; ++i)
+	{
+		bool active = !pool.fixed[i] && pool.awake[i];
+		float diagonal = active ? pool.masses[i] + h * pool.dampings[i] : 1.f;
+
+		glm::vec3 f = force[i] - pool.dampings[i] * velocity[i];
+		rightHandSide.segment<3>(3 * i) = active ? Eigen::Vector3f(h * f.x, h * f.y, h * f.z) : Eigen::Vector3f::Zero();
+
+		const int* offsets = &diagonalBlocks[9 * i];
+		values[offsets[0]] += diagonal;
+		values[offsets[4]] += diagonal;
+		values[offsets[8]] += diagonal;
+	}
+
+	for (int s = 0; s < numSprings; ++s)
+	{
+		int a = springs.particle1[s];
+		int b = springs.particle2[s];
+
+		glm::vec3 relativePosition = position[b] - position[a];
+		glm::vec3 relativeVelocity = velocity[b] - velocity[a];
+
+		float length = glm::length(relativePosition);
+		if (length < MIN_SPRING_LENGTH) continue;
+
+		float k = springs.constants[s];
+		float damping = springs.dampings[s];
+		glm::vec3 direction = relativePosition / length;
+
+		// Force on a and its Jacobian with respect to xb. The transversal term is dropped when the
+		// spring is compressed, which keeps the matrix positive definite.
+		glm::vec3 f = (k * (length - springs.restingLengths[s])) * direction + damping * relativeVelocity;
+
+		glm::mat3 outer = glm::outerProduct(direction, direction);
+		float transversal = std::max(0.f, 1.f - springs.restingLengths[s] / length);
+		glm::mat3 stiffness = k * (outer + transversal * (glm::mat3(1.f) - outer));
+
+		// h * (f + h K v)
+		glm::vec3 impulse = h * (f + h * (stiffness * relativeVelocity));
+
+		bool activeA = !pool.fixed[a] && pool.awake[a];
+		bool activeB = !pool.fixed[b] && pool.awake[b];
+
+		glm::mat3 block = (h * h) * stiffness + glm::mat3(h * damping);
+
+		if (activeA)
+		{
+			rightHandSide.segment<3>(3 * a) += Eigen::Vector3f(impulse.x, impulse.y, impulse.z);
+			AddToBlock(values, &diagonalBlocks[9 * a], block);
+		}
+
+		if (activeB)
+		{
+			rightHandSide.segment<3>(3 * b) -= Eigen::Vector3f(impulse.x, impulse.y, impulse.z);
+			AddToBlock(values, &diagonalBlocks[9 * b], block);
+		}
+
+		if (activeA && activeB)
+		{
+			AddToBlock(values, &springBlocks[18 * s], -block);
+			AddToBlock(values, &springBlocks[18 * s + 9], -block);
+		}
+	}
+
+	conjugateGradient.compute(matrix);
+	deltaVelocities = conjugateGradient.solveWithGuess(rightHandSide, deltaVelocities);
+	lastIterations = (int)conjugateGradient.iterations();
+
+	for (int i = 0; i < numParticles; ++i)
+	{
+		if (!pool.fixed[i] && pool.awake[i])
+		{
+			velocity[i] += glm::vec3(deltaVelocities[3 * i], deltaVelocities[3 * i + 1], deltaVelocities[3 * i + 2]);
+			position[i] += h * velocity[i];
+		}
+
+		force[i] = glm::vec3(0.f);
+	}
+}
+
+void ImplicitSpringSolver::Invalidate()
+{
+	dirty = true;
+}
+
+void ImplicitSpringSolver::MoveSpring(int from, int to)
+{
+	if (dirty) return; // The next step builds everything
+
+	std::copy(springBlocks.begin() + 18 * from, springBlocks.begin() + 18 * (from + 1), springBlocks.begin() + 18 * to);
+}
+
+void ImplicitSpringSolver::RemoveLastSpring()
+{
+	if (dirty) return;
+
+	numSprings--;
+	springBlocks.resize(18 * numSprings);
+}
+
+void ImplicitSpringSolver::SetIterations(int iterations)
+{
+	conjugateGradient.setMaxIterations(iterations > 1 ? iterations : 1);
+}
+
+void ImplicitSpringSolver::SetTolerance(float tolerance)
+{
+	conjugateGradient.setTolerance(tolerance);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ClothSprings.h"
+
+#include <Eigen/Sparse>
+#include <Eigen/IterativeLinearSolvers>
+#include <vector>
+
+#define DEFAULT_IMPLICIT_ITERATIONS 50 // Conjugate gradient iterations per step
+#define DEFAULT_IMPLICIT_TOLERANCE 1E-4f // Relative residual of the conjugate gradient
+
+// Backward Euler integration of particles joined by springs (Baraff and Witkin):
+//     (M - h D - h^2 K) dv = h (f + h K v),  v += dv,  x += h v
+// where K and D are the Jacobians of the forces with respect to the positions and velocities.
+// The sparsity pattern only depends on the springs, so it is built once and the values are
+// written in place every step. The system is solved with a conjugate gradient with a diagonal
+// preconditioner, starting from the velocity change of the previous step.
+class ImplicitSpringSolver
+{
+protected:
+	typedef Eigen::SparseMatrix<float> Matrix;
+
+	Matrix matrix;
+	Eigen::VectorXf rightHandSide;
+	Eigen::VectorXf deltaVelocities; // Also the initial guess of the next step
+
+	Eigen::ConjugateGradient<Matrix, Eigen::Lower | Eigen::Upper, Eigen::DiagonalPreconditioner<float>> conjugateGradient;
+
+	// Offsets in the values of the matrix of the 9 entries of each 3x3 block
+	std::vector<int> diagonalBlocks; // Per particle
+	std::vector<int> springBlocks; // Per spring, the blocks (p1, p2) and (p2, p1)
+
+	int numParticles = 0;
+	int numSprings = 0;
+	bool dirty = true;
+
+	int lastIterations = 0;
+
+	void Build(const ClothSprings& springs, int numParticles);
+
+public:
+	ImplicitSpringSolver();
+
+	// Integrates every particle of the pool with the forces already accumulated in it plus the
+	// forces of the springs. Fixed and sleeping particles do not move.
+	void Integrate(const ClothSprings& springs, ParticlePool& pool, float deltaTime);
+
+	void Invalidate(); // Call whenever the springs or the particles change
+
+	// Follow the removal of springs without building the pattern again. The blocks of the removed
+	// springs stay in the matrix as zeros.
+	void MoveSpring(int from, int to);
+	void RemoveLastSpring();
+
+	void SetIterations(int iterations);
+	void SetTolerance(float tolerance);
+
+	inline int GetLastIterations() const { return lastIterations; }
+};
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+enum
+{
+	SEMI_IMPLICIT_EULER_INTEGRATOR,
+	VELOCITY_VERLET_INTEGRATOR, // Translation only
+	RK4_INTEGRATOR,
+	SYMPLECTIC_INTEGRATOR, // Rotation only
+	NUM_INTEGRATORS
+};
+
+// Integrator policies for the rigid bodies. The translational ones advance the position and the
+// velocity under a constant acceleration. The rotational ones advance the orientation and the
+// angular velocity in object space (principal axes) under a constant torque, with the Euler
+// equations: I w' = torque - w x (I w).
+
+struct SemiImplicitEulerIntegrator
+{
+	static inline void Translate(glm::vec3& position, glm::vec3& velocity, const glm::vec3& acceleration, float deltaTime)
+	{
+		velocity += acceleration * deltaTime;
+		position += velocity * deltaTime;
+	}
+
+	static inline void Rotate(glm::quat& orientation, glm::vec3& w, const glm::vec3& inertia, const glm::vec3& inverseInertia, const glm::vec3& torque, float deltaTime)
+	{
+		glm::vec3 angularAcceleration = (torque - glm::cross(w, inertia * w)) * inverseInertia;
+
+		w += angularAcceleration * deltaTime;
+		orientation += 0.5f * orientation * glm::quat(0.f, w) * deltaTime;
+		orientation = glm::normalize(orientation);
+	}
+};
+
+struct VelocityVerletIntegrator
+{
+	// The acceleration is constant during the step, so the half kicks add up to a single one
+	static inline void Translate(glm::vec3& position, glm::vec3& velocity, const glm::vec3& acceleration, float deltaTime)
+	{
+		position += (velocity + 0.5f * acceleration * deltaTime) * deltaTime;
+		velocity += acceleration * deltaTime;
+	}
+};
+
+struct RK4Integrator
+{
+	// With a constant acceleration the four stages reduce to the exact solution, so there is no
+	// need to evaluate them
+	static inline void Translate(glm::vec3& position, glm::vec3& velocity, const glm::vec3& acceleration, float deltaTime)
+	{
+		VelocityVerletIntegrator::Translate(position, velocity, acceleration, deltaTime);
+	}
+
+	static inline void Rotate(glm::quat& orientation, glm::vec3& w, const glm::vec3& inertia, const glm::vec3& inverseInertia, const glm::vec3& torque, float deltaTime)
+	{
+		glm::quat q0 = orientation;
+		glm::vec3 w0 = w;
+
+		glm::quat dq1; glm::vec3 dw1;
+		Derivative(q0, w0, inertia, inverseInertia, torque, dq1, dw1);
+
+		glm::quat dq2; glm::vec3 dw2;
+		Derivative(q0 + dq1 * (deltaTime * 0.5f), w0 + dw1 * (deltaTime * 0.5f), inertia, inverseInertia, torque, dq2, dw2);
+
+		glm::quat dq3; glm::vec3 dw3;
+		Derivative(q0 + dq2 * (deltaTime * 0.5f), w0 + dw2 * (deltaTime * 0.5f), inertia, inverseInertia, torque, dq3, dw3);
+
+		glm::quat dq4; glm::vec3 dw4;
+		Derivative(q0 + dq3 * deltaTime, w0 + dw3 * deltaTime, inertia, inverseInertia, torque, dq4, dw4);
+
+		orientation += (1.0f / 6.0f) * (dq1 + 2.0f * dq2 + 2.0f * dq3 + dq4) * deltaTime;
+		w += (1.0f / 6.0f) * (dw1 + 2.0f * dw2 + 2.0f * dw3 + dw4) * deltaTime;
+
+		orientation = glm::normalize(orientation);
+	}
+
+	static inline void Derivative(const glm::quat& q, const glm::vec3& w, const glm::vec3& inertia, const glm::vec3& inverseInertia, const glm::vec3& torque, glm::quat& dq, glm::vec3& dw)
+	{
+		dq = 0.5f * q * glm::quat(0.f, w);
+		dw = (torque - glm::cross(w, inertia * w)) * inverseInertia;
+	}
+};
+
+// Splitting of the free rigid body in rotations about each principal axis (Dullweber, Leimkuhler
+// and McLachlan). Each rotation is exact, so the orientation stays unit and the angular
+// momentum keeps its length. The torque is applied as two half kicks around the free motion.
+struct SymplecticIntegrator
+{
+	static inline void Rotate(glm::quat& orientation, glm::vec3& w, const glm::vec3& inertia, const glm::vec3& inverseInertia, const glm::vec3& torque, float deltaTime)
+	{
+		float halfTime = 0.5f * deltaTime;
+		glm::vec3 worldTorque = orientation * torque;
+
+		glm::vec3 momentum = inertia * w + torque * halfTime;
+
+		RotateAboutAxis<0>(orientation, momentum, inverseInertia, halfTime);
+		RotateAboutAxis<1>(orientation, momentum, inverseInertia, halfTime);
+		RotateAboutAxis<2>(orientation, momentum, inverseInertia, deltaTime);
+		RotateAboutAxis<1>(orientation, momentum, inverseInertia, halfTime);
+		RotateAboutAxis<0>(orientation, momentum, inverseInertia, halfTime);
+
+		// The torque is constant in world space, so the second kick sees it from the new orientation
+		momentum += (glm::inverse(orientation) * worldTorque) * halfTime;
+
+		w = momentum * inverseInertia;
+		orientation = glm::normalize(orientation);
+	}
+
+	// Exact flow of the kinetic energy term of one axis: the body turns about the axis and the
+	// angular momentum, seen from the body, turns the other way
+	template <int axis>
+	static inline void RotateAboutAxis(glm::quat& orientation, glm::vec3& momentum, const glm::vec3& inverseInertia, float deltaTime)
+	{
+		float halfAngle = 0.5f * momentum[axis] * inverseInertia[axis] * deltaTime;
+		float s = sinf(halfAngle);
+		float c = cosf(halfAngle);
+
+		// orientation * (c, s * axis)
+		glm::quat q = orientation;
+		glm::vec3 v(q.x, q.y, q.z);
+		glm::vec3 cross(0.f);
+		cross[(axis + 1) % 3] = v[(axis + 2) % 3];
+		cross[(axis + 2) % 3] = -v[(axis + 1) % 3];
+
+		orientation.w = c * q.w - s * v[axis];
+		glm::vec3 rotated = c * v + s * cross;
+		rotated[axis] += s * q.w;
+		orientation.x = rotated.x;
+		orientation.y = rotated.y;
+		orientation.z = rotated.z;
+
+		// The other two components of the momentum turn by -angle in their plane
+		float cosAngle = c * c - s * s;
+		float sinAngle = 2.f * s * c;
+		const int i = (axis + 1) % 3;
+		const int j = (axis + 2) % 3;
+		float mi = momentum[i];
+		float mj = momentum[j];
+		momentum[i] = cosAngle * mi + sinAngle * mj;
+		momentum[j] = cosAngle * mj - sinAngle * mi;
+	}
+};
\ No newline at end of file
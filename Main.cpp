@@ -1,5 +1,7 @@
 #include <iostream>
 #include <iomanip>
+#include <thread>
+#include <chrono>
 
 #include "GMV_Physics.h"
 #include "GMV_Samples.h"
@@ -170,7 +172,7 @@ int main()
 	engine.AddObject(&mobilePhonePoint);
 	engine.AddObject(&particle_mobilePhone);
 
-	particle_mobilePhone->fixed = true;
+	particle_mobilePhone->SetFixed(true);
 	particle_mobilePhone->SetPosition(mobilePhone->GetPosition() + mobilePhoneSize);
 
 	GameSpring spring_mobilePhone(particle_mobilePhone, mobilePhonePoint, 1000.f, 0.f);
@@ -187,8 +189,8 @@ int main()
 
 	GameCloth cloth(clothSize, clothSize, clothSpacing, 1.f);
 	engine.AddObject(&cloth);
-	cloth->GetParticle(0, clothSize - 1).fixed = true;
-	cloth->GetParticle(clothSize - 1, clothSize - 1).fixed = true;	
+	cloth->GetParticle(0, clothSize - 1).SetFixed(true);
+	cloth->GetParticle(clothSize - 1, clothSize - 1).SetFixed(true);	
 	cloth->SetPosition(glm::vec3(5.f, 0.f, 0.f));
 
 	GameRigidBody boxInCloth = CreateGameBox(100, glm::vec3(1.f));
@@ -271,7 +273,7 @@ int main()
 
 	GameRigidBody& topRigid = rigids[0];
 	GameParticle topParticle(0.2f, 1.f);
-	topParticle->fixed = true;
+	topParticle->SetFixed(true);
 	glm::vec3 perturbation = glm::vec3(
 		((float)rand() / (float)RAND_MAX - 0.5f) * 0.1f,
 		((float)rand() / (float)RAND_MAX - 0.5f) * 0.1f,
@@ -285,15 +287,28 @@ int main()
 	engine.AddObject(&topSpring);
 
 
+	// External forces, applied before every physics step
+	engine.SetForceCallback([&]() {
+		cloth->ApplyAcceleration(gravity);
+		mobilePhone->ApplyAcceleration(gravity);
+		boxInCloth->ApplyAcceleration(gravity);
+		for (int i = 0; i < numCylinders; ++i)
+		{
+			rigids[i]->ApplyAcceleration(gravity);
+		}
+	});
+
+
 	// ############ MAIN LOOP ############
 	
 	// MAIN LOOP SETUP
 	const float fpsLimit = 120.f;
 	float currentTime = glfwGetTime();
 	float deltaTime = 1 / fpsLimit;
-	float minimumDeltaTime = 1 / 100.f; // Minimum delta time to avoid too high speeds
 	float simulationSpeed = 1.f;
 
+	engine.SetFixedTimeStep(1 / 240.f, 1, 8);
+
 	// LOOP
 	while (!glfwWindowShouldClose(window))
 	{
@@ -318,14 +333,6 @@ int main()
 		cylinder.orientation = glm::rotate(cylinder.orientation, deltaTime, glm::vec3(0.f, 1.f, 0.f));
 		cylinder.orientation = glm::rotate(glm::quat(1.f, 0.f, 0.f, 0.f), deltaTime, glm::vec3(0.f, 1.f, 0.f)) * cylinder.orientation;
 
-		cloth->ApplyAcceleration(gravity);
-		mobilePhone->ApplyAcceleration(gravity);
-		boxInCloth->ApplyAcceleration(gravity);
-		for(int i = 0; i < numCylinders; ++i)
-		{
-			rigids[i]->ApplyAcceleration(gravity);
-		}
-
 		engine.Update(deltaTime * simulationSpeed);
 
 		// Rendering
@@ -345,13 +352,15 @@ int main()
 		cursor.renderCursor(shaderProgram, "model");
 
 
-		// Wait until next photogram should happen and get deltaTime (do not separate this lines)
+		// Sleep until next photogram should happen and get deltaTime (do not separate this lines)
+		// The engine steps the physics with a fixed timestep, so deltaTime does not need clamping
 		{
-			while ((float)glfwGetTime() - currentTime < 1 / fpsLimit);
+			float remainingTime = 1 / fpsLimit - ((float)glfwGetTime() - currentTime);
+			if (remainingTime > 0.f)
+				std::this_thread::sleep_for(std::chrono::duration<float>(remainingTime));
+
 			deltaTime = (float)glfwGetTime() - currentTime;
 			currentTime = (float)glfwGetTime();
-
-			if (deltaTime > minimumDeltaTime / simulationSpeed) deltaTime = minimumDeltaTime / simulationSpeed;
 		}
 
 
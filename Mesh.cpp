@@ -1,5 +1,6 @@
 #include "Mesh.h"
-#include <list>
+#include <algorithm>
+#include <cfloat>
 
 
 Mesh::Mesh(
@@ -29,7 +30,7 @@ void Mesh::CreateBuffers(GLenum usage)
 	vao.Bind();
 
 	vbo = VBO(vertices, usage);
-	EBO ebo(indices);
+	ebo = EBO(indices);
 
 	vao.LinkAttrib(vbo, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, position));
 	vao.LinkAttrib(vbo, 1, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, normal));
@@ -67,248 +68,357 @@ void Mesh::Render()
 void Mesh::Update()
 {
 	vbo.Update(vertices);
-	if (accelerator != 0) {
-		FreeBVHNode(accelerator);
-		delete accelerator;
-		accelerator = 0;
-		Accelerate();
-	}
+	UpdateAccelerator();
 }
 
-void Mesh::Accelerate() {
-	if (accelerator != 0) return;
-
-	glm::vec3 min = vertices[0].position;
-	glm::vec3 max = vertices[0].position;
-
-	for (int i = 1; i < GetNumVertices(); ++i)
-	{
-		min.x = fminf(vertices[i].position.x, min.x);
-		min.y = fminf(vertices[i].position.y, min.y);
-		min.z = fminf(vertices[i].position.z, min.z);
-
-		max.x = fmaxf(vertices[i].position.x, max.x);
-		max.y = fmaxf(vertices[i].position.y, max.y);
-		max.z = fmaxf(vertices[i].position.z, max.z);
-	}
-
-	accelerator = new BVHNode();
-	accelerator->bounds = FromMinMax(min, max);
-	accelerator->numTriangles = GetNumTriangles();
+void Mesh::UpdateIndices(int first, int count)
+{
+	if (count <= 0) return;
 
-	accelerator->triangles = new int[GetNumTriangles()];
+	vao.Bind();
+	ebo.Update(indices, first, count);
+	vao.Unbind();
+}
 
-	for (int i = 0; i < GetNumTriangles(); ++i)
-		accelerator->triangles[i] = i;
+void Mesh::Accelerate() {
+	if (accelerator != 0 || GetNumTriangles() == 0) return;
 
-	SplitBVHNode(accelerator, *this, 3);
+	accelerator = new BVH();
+	BuildBVH(*accelerator, *this);
 }
 
 void Mesh::UpdateAccelerator()
 {
 	if (accelerator == 0) return;
-	FreeBVHNode(accelerator);
+
+	// A deformed mesh keeps its tree while refitting does not make it much worse than a new one
+	if (accelerator->leafTriangles.size() == GetNumTriangles() &&
+		RefitBVH(*accelerator, *this) <= accelerator->buildCost * BVH_REFIT_COST_GROWTH) return;
+
 	delete accelerator;
 	accelerator = 0;
 	Accelerate();
 }
 
+BVHTriangle Mesh::GetBVHTriangle(int index) const
+{
+	Triangle triangle = GetTriangle(index);
+
+	BVHTriangle result;
+	result.a = triangle.a;
+	result.index = index;
+	result.edge1 = triangle.b - triangle.a;
+	result.edge2 = triangle.c - triangle.a;
+	return result;
+}
+
 void AccelerateMesh(Mesh& mesh)
 {
 	mesh.Accelerate();
 }
 
-void SplitBVHNode(BVHNode* node, const Mesh& mesh, int depth)
+static float HalfArea(const glm::vec3& min, const glm::vec3& max)
+{
+	glm::vec3 d = max - min;
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+struct BVHBin
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+	int count = 0;
+};
+
+void BuildBVH(BVH& bvh, const Mesh& mesh)
 {
-	if (depth-- == 0) return;
+	int numTriangles = mesh.GetNumTriangles();
 
-	if (node->numTriangles <= 0) return; // Si no hay triangulos no tiene sentido hacer nada
+	bvh.nodes.clear();
+	bvh.leafTriangles.clear();
+	if (numTriangles == 0) return;
 
-	if (node->children == 0) // Si no tiene hijos anade nuevos hijos
+	// Bounds and centroids of the triangles, the build only looks at these
+	std::vector<glm::vec3> triangleMin(numTriangles), triangleMax(numTriangles), centroids(numTriangles);
+	std::vector<int> order(numTriangles); // Triangles in the order of the leaves
+
+	for (int i = 0; i < numTriangles; ++i)
 	{
-		node->children = new BVHNode[8];
-
-		// Crea 8 cajas.
-		glm::vec3 c = node->bounds.position;
-		glm::vec3 e = node->bounds.size * 0.5f;
-
-		node->children[0].bounds = AABB(c + glm::vec3(-e.x, +e.y, -e.z), e);
-		node->children[1].bounds = AABB(c + glm::vec3(+e.x, +e.y, -e.z), e);
-		node->children[2].bounds = AABB(c + glm::vec3(-e.x, +e.y, +e.z), e);
-		node->children[3].bounds = AABB(c + glm::vec3(+e.x, +e.y, +e.z), e);
-		node->children[4].bounds = AABB(c + glm::vec3(-e.x, -e.y, -e.z), e);
-		node->children[5].bounds = AABB(c + glm::vec3(+e.x, -e.y, -e.z), e);
-		node->children[6].bounds = AABB(c + glm::vec3(-e.x, -e.y, +e.z), e);
-		node->children[7].bounds = AABB(c + glm::vec3(+e.x, -e.y, +e.z), e);
+		Triangle triangle = mesh.GetTriangle(i);
+		triangleMin[i] = glm::min(glm::min(triangle.a, triangle.b), triangle.c);
+		triangleMax[i] = glm::max(glm::max(triangle.a, triangle.b), triangle.c);
+		centroids[i] = (triangleMin[i] + triangleMax[i]) * 0.5f;
+		order[i] = i;
 	}
 
-	//if (node->children == 0) return; // Si no tienes hijos entonces no se puede hacer nada (aunque si no tenia hijos ya le hemos asignado 8 hijos, por lo que se puede omitir)
+	// A tree with a triangle per leaf has 2n - 1 nodes, plus the unused second one
+	bvh.nodes.reserve(2 * numTriangles);
+	bvh.nodes.resize(2);
+	bvh.nodes[0].first = 0;
+	bvh.nodes[0].count = numTriangles;
+
+	// Nodes to split, with their depth
+	std::vector<std::pair<int, int>> pending;
+	pending.push_back(std::make_pair(0, 0));
 
-	// A continuacion asignamos a cada hijo una lista de triangulos.
-	for (int i = 0; i < 8; ++i)
+	while (!pending.empty())
 	{
-		node->children[i].numTriangles = 0;
+		int index = pending.back().first;
+		int depth = pending.back().second;
+		pending.pop_back();
 
-		for (int j = 0; j < node->numTriangles; ++j)
-		{
-			Triangle triangle = mesh.GetTriangle(node->triangles[j]);
+		int first = bvh.nodes[index].first;
+		int count = bvh.nodes[index].count;
+		int* triangles = order.data() + first;
 
-			if (TriangleAABB(triangle, node->children[i].bounds)) // si el triangulo esta contenido en el AABB del hijo entonces el hijo tendra un triangulo mas
-				node->children[i].numTriangles += 1;
+		glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+		glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+
+		for (int i = 0; i < count; ++i)
+		{
+			min = glm::min(min, triangleMin[triangles[i]]);
+			max = glm::max(max, triangleMax[triangles[i]]);
+			centroidMin = glm::min(centroidMin, centroids[triangles[i]]);
+			centroidMax = glm::max(centroidMax, centroids[triangles[i]]);
 		}
 
-		if (node->children[i].numTriangles == 0) continue; // si no hay triangulos entonces pasar al siguiente hijo
+		bvh.nodes[index].min = min;
+		bvh.nodes[index].max = max;
 
-		node->children[i].triangles = new int[node->children[i].numTriangles];
+		if (count <= BVH_LEAF_TRIANGLES || depth + 1 >= BVH_MAX_DEPTH) continue;
 
-		int index = 0;
+		// Binned SAH: the triangles are sorted into bins by their centroid along each axis, and
+		// the boundaries between bins are the candidate planes
+		float area = HalfArea(min, max);
+		float bestCost = count * area;
+		int bestAxis = -1;
+		int bestBin = 0;
 
-		for (int j = 0; j < node->numTriangles; ++j) {
-			Triangle triangle = mesh.GetTriangle(node->triangles[j]);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent <= 0.f) continue;
 
-			if (TriangleAABB(triangle, node->children[i].bounds)) // si el triangulo esta contenido en el AABB del hijo entonces se incluye
+			float scale = BVH_BINS / extent;
+			BVHBin bins[BVH_BINS];
+
+			for (int i = 0; i < count; ++i)
 			{
-				node->children[i].triangles[index++] = node->triangles[j];
+				int t = triangles[i];
+				int b = std::min((int)((centroids[t][axis] - centroidMin[axis]) * scale), BVH_BINS - 1);
+				bins[b].min = glm::min(bins[b].min, triangleMin[t]);
+				bins[b].max = glm::max(bins[b].max, triangleMax[t]);
+				bins[b].count++;
 			}
-		}
-	}
 
-	// Limpiamos el nodo actual porque toda su informacion esta contenida en los hijos
-	node->numTriangles = 0;
-	delete[] node->triangles;
-	node->triangles = 0;
+			// Sweep from the right, then from the left evaluating each plane
+			float rightAreas[BVH_BINS];
+			int rightCounts[BVH_BINS];
+			BVHBin right;
 
-	// Repetimos el proceso con cada uno de los hijos
-	for (int i = 0; i < 8; ++i)
-		SplitBVHNode(&node->children[i], mesh, depth);
-}
+			for (int b = BVH_BINS - 1; b > 0; --b)
+			{
+				right.min = glm::min(right.min, bins[b].min);
+				right.max = glm::max(right.max, bins[b].max);
+				right.count += bins[b].count;
+				rightAreas[b] = right.count > 0 ? HalfArea(right.min, right.max) : 0.f;
+				rightCounts[b] = right.count;
+			}
 
-void FreeBVHNode(BVHNode* node)
-{
-	if (node->children != 0)
-	{
-		for (int i = 0; i < 8; ++i)
-			FreeBVHNode(&node->children[i]);
+			BVHBin left;
 
-		delete[] node->children;
-		node->children = 0;
-	}
+			for (int b = 0; b < BVH_BINS - 1; ++b)
+			{
+				left.min = glm::min(left.min, bins[b].min);
+				left.max = glm::max(left.max, bins[b].max);
+				left.count += bins[b].count;
 
-	if (node->numTriangles != 0 || node->triangles != 0)
-	{
-		delete[] node->triangles;
-		node->triangles = 0;
-		node->numTriangles = 0;
-	}
-}
+				if (left.count == 0 || rightCounts[b + 1] == 0) continue;
 
-float Raycast(const Mesh& mesh, const Ray& ray) // POSIBLE ERROR: No se considera el caso en el que el rayo da a dos triangulos, sino que se devolvera la distancia contra el primero que compruebe. Habria que tomar la menor de todas las distancias
-{
+				float cost = BVH_TRAVERSAL_COST * area + left.count * HalfArea(left.min, left.max) + rightCounts[b + 1] * rightAreas[b + 1];
 
-	if (mesh.accelerator == 0)
-	{
-		for (int i = 0; i < mesh.GetNumTriangles(); ++i)
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		int middle;
+
+		if (bestAxis >= 0)
 		{
-			float result = Raycast(mesh.GetTriangle(i), ray);
-			if (result >= 0) return result;
+			float scale = BVH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+			int axis = bestAxis;
+			glm::vec3 origin = centroidMin;
+
+			middle = (int)(std::partition(triangles, triangles + count, [&](int t) {
+				return std::min((int)((centroids[t][axis] - origin[axis]) * scale), BVH_BINS - 1) <= bestBin;
+			}) - triangles);
+		}
+		else if (count > BVH_MAX_LEAF_TRIANGLES)
+		{
+			// Splitting does not pay, or every centroid is the same, but the leaf would be too
+			// large: split at the median of the longest axis
+			glm::vec3 extent = centroidMax - centroidMin;
+			int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+			middle = count / 2;
+			std::nth_element(triangles, triangles + middle, triangles + count, [&](int a, int b) {
+				return centroids[a][axis] < centroids[b][axis];
+			});
 		}
+		else continue;
+
+		int left = (int)bvh.nodes.size();
+		bvh.nodes.resize(left + 2);
+
+		bvh.nodes[left].first = first;
+		bvh.nodes[left].count = middle;
+		bvh.nodes[left + 1].first = first + middle;
+		bvh.nodes[left + 1].count = count - middle;
 
-		return -1.f;
+		bvh.nodes[index].first = left;
+		bvh.nodes[index].count = 0;
+
+		pending.push_back(std::make_pair(left + 1, depth + 1));
+		pending.push_back(std::make_pair(left, depth + 1));
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
+	bvh.leafTriangles.resize(numTriangles);
+
+	for (int i = 0; i < numTriangles; ++i)
+		bvh.leafTriangles[i].index = order[i];
+
+	SetLeafTriangles(bvh, mesh);
 
-	float rMin = -1.f;
+	bvh.buildCost = GetBVHCost(bvh);
+}
 
-	while (!toProcess.empty())
+void SetLeafTriangles(BVH& bvh, const Mesh& mesh)
+{
+	for (BVHTriangle& leafTriangle : bvh.leafTriangles)
+		leafTriangle = mesh.GetBVHTriangle(leafTriangle.index);
+}
+
+float RefitBVH(BVH& bvh, const Mesh& mesh)
+{
+	if (bvh.nodes.empty()) return 0.f;
+
+	float cost = 0.f;
+
+	// The children are always stored after their parent, so a backwards sweep visits them first
+	for (int i = (int)bvh.nodes.size() - 1; i >= 0; --i)
 	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
+		if (i == 1) continue; // Unused
+
+		BVHNode& node = bvh.nodes[i];
 
-		if (iterator->numTriangles >= 0)
+		if (node.IsLeaf())
 		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
+			node.min = glm::vec3(FLT_MAX);
+			node.max = glm::vec3(-FLT_MAX);
+
+			for (int j = node.first; j < node.first + node.count; ++j)
 			{
-				float r = Raycast(mesh.GetTriangle(iterator->triangles[i]), ray);
+				Triangle triangle = mesh.GetTriangle(bvh.leafTriangles[j].index);
+				node.min = glm::min(node.min, glm::min(glm::min(triangle.a, triangle.b), triangle.c));
+				node.max = glm::max(node.max, glm::max(glm::max(triangle.a, triangle.b), triangle.c));
 
-				if (r < 0) continue;
-				
-				if (rMin < 0 || r < rMin) rMin = r;
+				bvh.leafTriangles[j].a = triangle.a;
+				bvh.leafTriangles[j].edge1 = triangle.b - triangle.a;
+				bvh.leafTriangles[j].edge2 = triangle.c - triangle.a;
 			}
-		}
 
-		if (iterator->children != 0)
+			cost += node.count * HalfArea(node.min, node.max);
+		}
+		else
 		{
-			for (int i = 8 - 1; i >= 0; --i)
-			{
-				if (Raycast(iterator->children[i].bounds, ray) >= 0)
-					toProcess.push_front(&iterator->children[i]);
-			}
+			const BVHNode& left = bvh.nodes[node.first];
+			const BVHNode& right = bvh.nodes[node.first + 1];
+			node.min = glm::min(left.min, right.min);
+			node.max = glm::max(left.max, right.max);
+
+			cost += BVH_TRAVERSAL_COST * HalfArea(node.min, node.max);
 		}
 	}
 
-	return rMin;
+	float rootArea = HalfArea(bvh.nodes[0].min, bvh.nodes[0].max);
+	return rootArea > 0.f ? cost / rootArea : 0.f;
 }
 
-float Raycast(const Mesh& mesh, const Ray& ray, int& triangle) // POSIBLE ERROR: No se considera el caso en el que el rayo da a dos triangulos, sino que se devolvera la distancia contra el primero que compruebe. Habria que tomar la menor de todas las distancias
+float GetBVHCost(const BVH& bvh)
 {
-	triangle = -1;
+	if (bvh.nodes.empty()) return 0.f;
 
-	if (mesh.accelerator == 0)
+	// Each node is reached with the probability of hitting its bounds once inside the root
+	float cost = 0.f;
+
+	for (int i = 0; i < (int)bvh.nodes.size(); ++i)
 	{
-		for (int i = 0; i < mesh.GetNumTriangles(); ++i)
-		{
-			float result = Raycast(mesh.GetTriangle(i), ray);
-			if (result >= 0) 
-			{
-				triangle = i;
-				return result;
-			}
-		}
+		if (i == 1) continue;
 
-		return -1.f;
+		const BVHNode& node = bvh.nodes[i];
+		cost += (node.IsLeaf() ? node.count : BVH_TRAVERSAL_COST) * HalfArea(node.min, node.max);
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
+	float rootArea = HalfArea(bvh.nodes[0].min, bvh.nodes[0].max);
+	return rootArea > 0.f ? cost / rootArea : 0.f;
+}
+
+float Raycast(const BVHTriangle& triangle, const Ray& ray)
+{
+	glm::vec3 p = glm::cross(ray.direction, triangle.edge2);
+	float det = glm::dot(triangle.edge1, p);
+
+	if (det <= 0.f) return -1.f; // Back face, or parallel
+
+	float inverseDet = 1.f / det;
+	glm::vec3 s = ray.origin - triangle.a;
+
+	float u = glm::dot(s, p) * inverseDet;
+	if (u < -BVH_EDGE_EPSILON) return -1.f;
+
+	glm::vec3 q = glm::cross(s, triangle.edge1);
 
-	float rMin = -1.f;
+	float v = glm::dot(ray.direction, q) * inverseDet;
+	if (v < -BVH_EDGE_EPSILON || u + v > 1.f + BVH_EDGE_EPSILON) return -1.f;
 
-	while (!toProcess.empty())
+	float t = glm::dot(triangle.edge2, q) * inverseDet;
+	return t >= 0.f ? t : -1.f;
+}
+
+float Raycast(const Mesh& mesh, const Ray& ray)
+{
+	int triangle;
+	return Raycast(mesh, ray, triangle);
+}
+
+float Raycast(const Mesh& mesh, const Ray& ray, int& triangle)
+{
+	triangle = -1;
+
+	if (mesh.accelerator == 0)
 	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
+		float rMin = -1.f;
 
-		if (iterator->numTriangles >= 0)
+		for (int i = 0; i < mesh.GetNumTriangles(); ++i)
 		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
-			{
-				float r = Raycast(mesh.GetTriangle(iterator->triangles[i]), ray);
-
-				if (r >= 0) {
-					if (rMin < 0 || r < rMin) 
-					{
-						rMin = r;
-						triangle = iterator->triangles[i];
-					}
-				}
-			}
-		}
+			float r = Raycast(mesh.GetBVHTriangle(i), ray);
 
-		if (iterator->children != 0)
-		{
-			for (int i = 8 - 1; i >= 0; --i)
+			if (r >= 0 && (rMin < 0 || r <= rMin))
 			{
-				if (Raycast(iterator->children[i].bounds, ray) >= 0)
-					toProcess.push_front(&iterator->children[i]);
+				rMin = r;
+				triangle = i;
 			}
 		}
+
+		return rMin;
 	}
 
-	return rMin;
+	return RaycastBVH(*mesh.accelerator, ray, FLT_MAX, [&](const BVHTriangle& t) { return Raycast(t, ray); }, &triangle);
 }
 
 bool MeshAABB(const Mesh& mesh, const AABB& aabb)
@@ -321,32 +431,10 @@ bool MeshAABB(const Mesh& mesh, const AABB& aabb)
 		return false;
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
-
-	while (!toProcess.empty())
-	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
-
-		if (iterator->numTriangles >= 0)
-		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
-				if (TriangleAABB(mesh.GetTriangle(iterator->triangles[i]), aabb)) return true;
-		}
-
-		if (iterator->children != 0)
-		{
-			for (int i = 8 - 1; i >= 0; --i)
-			{
-				if (AABBAABB(iterator->children[i].bounds, aabb))
-					toProcess.push_front(&iterator->children[i]);
-			}
-		}
-	}
-
-	return false;
+	return TraverseBVH(*mesh.accelerator,
+		[&](const BVHNode& node) { return AABBAABB(node.GetBounds(), aabb); },
+		[&](const BVHTriangle& t) { return TriangleAABB(t.GetTriangle(), aabb); }
+	);
 }
 
 bool Linetest(const Mesh& mesh, const Line& line)
@@ -359,32 +447,12 @@ bool Linetest(const Mesh& mesh, const Line& line)
 		return false;
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
-
-	while (!toProcess.empty())
-	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
-
-		if (iterator->numTriangles >= 0)
-		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
-				if (Linetest(mesh.GetTriangle(iterator->triangles[i]), line)) return true;
-		}
-
-		if (iterator->children != 0)
-		{
-			for (int i = 8 - 1; i >= 0; --i)
-			{
-				if (Linetest(iterator->children[i].bounds, line))
-					toProcess.push_front(&iterator->children[i]);
-			}
-		}
-	}
+	// The closest hit of the ray along the line, the nodes beyond its end are culled
+	Ray ray;
+	ray.origin = line.start;
+	ray.direction = glm::normalize(line.end - line.start);
 
-	return false;
+	return RaycastBVH(*mesh.accelerator, ray, Length(line), [&](const BVHTriangle& t) { return Raycast(t, ray); }) >= 0.f;
 }
 
 bool MeshSphere(const Mesh& mesh, const Sphere& sphere)
@@ -397,32 +465,10 @@ bool MeshSphere(const Mesh& mesh, const Sphere& sphere)
 		return false;
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
-
-	while (!toProcess.empty())
-	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
-
-		if (iterator->numTriangles >= 0)
-		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
-				if (TriangleSphere(mesh.GetTriangle(iterator->triangles[i]), sphere)) return true;
-		}
-
-		if (iterator->children != 0)
-		{
-			for (int i = 8 - 1; i >= 0; --i)
-			{
-				if (AABBSphere(iterator->children[i].bounds, sphere))
-					toProcess.push_front(&iterator->children[i]);
-			}
-		}
-	}
-
-	return false;
+	return TraverseBVH(*mesh.accelerator,
+		[&](const BVHNode& node) { return AABBSphere(node.GetBounds(), sphere); },
+		[&](const BVHTriangle& t) { return TriangleSphere(t.GetTriangle(), sphere); }
+	);
 }
 
 bool MeshOBB(const Mesh& mesh, const OBB& obb)
@@ -435,32 +481,10 @@ bool MeshOBB(const Mesh& mesh, const OBB& obb)
 		return false;
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
-
-	while (!toProcess.empty())
-	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
-
-		if (iterator->numTriangles >= 0)
-		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
-				if (TriangleOBB(mesh.GetTriangle(iterator->triangles[i]), obb)) return true;
-		}
-
-		if (iterator->children != 0)
-		{
-			for (int i = 8 - 1; i >= 0; --i)
-			{
-				if (AABBOBB(iterator->children[i].bounds, obb))
-					toProcess.push_front(&iterator->children[i]);
-			}
-		}
-	}
-
-	return false;
+	return TraverseBVH(*mesh.accelerator,
+		[&](const BVHNode& node) { return AABBOBB(node.GetBounds(), obb); },
+		[&](const BVHTriangle& t) { return TriangleOBB(t.GetTriangle(), obb); }
+	);
 }
 
 bool MeshPlane(const Mesh& mesh, const Plane& plane)
@@ -473,32 +497,10 @@ bool MeshPlane(const Mesh& mesh, const Plane& plane)
 		return false;
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
-
-	while (!toProcess.empty())
-	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
-
-		if (iterator->numTriangles >= 0)
-		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
-				if (TrianglePlane(mesh.GetTriangle(iterator->triangles[i]), plane)) return true;
-		}
-
-		if (iterator->children != 0)
-		{
-			for (int i = 8 - 1; i >= 0; --i)
-			{
-				if (AABBPlane(iterator->children[i].bounds, plane))
-					toProcess.push_front(&iterator->children[i]);
-			}
-		}
-	}
-
-	return false;
+	return TraverseBVH(*mesh.accelerator,
+		[&](const BVHNode& node) { return AABBPlane(node.GetBounds(), plane); },
+		[&](const BVHTriangle& t) { return TrianglePlane(t.GetTriangle(), plane); }
+	);
 }
 
 bool MeshTriangle(const Mesh& mesh, const Triangle& triangle)
@@ -511,30 +513,8 @@ bool MeshTriangle(const Mesh& mesh, const Triangle& triangle)
 		return false;
 	}
 
-	// Entonces tiene acelerador por lo que no hace falta comprobarlo
-	std::list<BVHNode*> toProcess;
-	toProcess.push_front(mesh.accelerator);
-
-	while (!toProcess.empty())
-	{
-		BVHNode* iterator = *(toProcess.begin());
-		toProcess.erase(toProcess.begin());
-
-		if (iterator->numTriangles >= 0)
-		{
-			for (int i = 0; i < iterator->numTriangles; ++i)
-				if (TriangleTriangle(mesh.GetTriangle(iterator->triangles[i]), triangle)) return true;
-		}
-
-		if (iterator->children != 0)
-		{
-			for (int i = 8 - 1; i >= 0; --i)
-			{
-				if (AABBTriangle(iterator->children[i].bounds, triangle))
-					toProcess.push_front(&iterator->children[i]);
-			}
-		}
-	}
-
-	return false;
-}
+	return TraverseBVH(*mesh.accelerator,
+		[&](const BVHNode& node) { return AABBTriangle(node.GetBounds(), triangle); },
+		[&](const BVHTriangle& t) { return TriangleTriangle(t.GetTriangle(), triangle); }
+	);
+}
\ No newline at end of file
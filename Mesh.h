@@ -4,15 +4,199 @@
 #include "Colors.h"
 #include "VAO.h"
 #include "EBO.h"
+#include "AlignedAllocator.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#define BVH_BINS 16 // Candidate split planes per axis of the SAH build
+#define BVH_LEAF_TRIANGLES 2 // Nodes with this many triangles or fewer are not split
+#define BVH_MAX_LEAF_TRIANGLES 16 // Larger nodes are split even if the SAH would keep them
+#define BVH_TRAVERSAL_COST 1.f // Cost of visiting a node, relative to testing a triangle
+#define BVH_MAX_DEPTH 64 // Deeper nodes are left as leaves
+#define BVH_NODE_ALIGNMENT 64 // A cache line, two sibling nodes fill it
+#define BVH_REFIT_COST_GROWTH 1.5f // A refitted tree is rebuilt when its cost grows past this factor
+#define BVH_EDGE_EPSILON 1E-4f // Barycentric tolerance of the ray tests, so that rays do not slip between neighbouring triangles
+
+// Node of the bounding volume hierarchy of a mesh. The two children of an inner node are stored
+// together, at first and first + 1. A leaf holds the triangles [first, first + count) of
+// BVH::leafTriangles.
+struct BVHNode
+{
+	glm::vec3 min;
+	int first;
+	glm::vec3 max;
+	int count; // 0 for an inner node
+
+	inline bool IsLeaf() const { return count > 0; }
+
+	inline AABB GetBounds() const { return FromMinMax(min, max); }
+};
+
+// Triangle of a leaf as a vertex and the two edges from it, the form the Möller–Trumbore tests
+// use. The tests read it one field at a time, so it is packed to 40 bytes.
+struct BVHTriangle
+{
+	glm::vec3 a;
+	int index; // In the mesh
+	glm::vec3 edge1; // b - a
+	glm::vec3 edge2; // c - a
+
+	inline Triangle GetTriangle() const { return Triangle(a, a + edge1, a + edge2); }
+};
 
-typedef struct BVHNode
+// Binary bounding volume hierarchy built with the surface area heuristic. The nodes are stored in
+// a flat array whose first node is the root. The second one is unused, so that every pair of
+// siblings starts at an even index and shares a cache line. Each triangle is in exactly one leaf.
+// The queries read the triangles from a copy in the order of the leaves, instead of gathering
+// their vertices from the render layout of the mesh.
+struct BVH
 {
-	AABB bounds;
-	BVHNode* children;
-	int numTriangles;
-	int* triangles;
-	BVHNode() : children(0), numTriangles(0), triangles(0) {}
-} BVHNode;
+	std::vector<BVHNode, AlignedAllocator<BVHNode, BVH_NODE_ALIGNMENT>> nodes;
+	std::vector<BVHTriangle> leafTriangles; // Triangles of the mesh in the order of the leaves, see SetLeafTriangles
+	float buildCost = 0.f; // Cost when it was built, see GetBVHCost
+
+	inline int GetNumNodes() const { return nodes.empty() ? 0 : (int)nodes.size() - 1; }
+};
+
+#define BVH_STACK_SIZE BVH_MAX_DEPTH // A depth first traversal keeps at most a node per level
+
+// Depth first traversal of the BVH with a fixed stack and no allocations. The nodes that fail
+// overlaps(node) are skipped, and visit(triangle) is called for the BVHTriangles of the leaves
+// reached. Stops and returns true as soon as visit returns true.
+template <typename Overlaps, typename Visit>
+inline bool TraverseBVH(const BVH& bvh, const Overlaps& overlaps, const Visit& visit)
+{
+	int stack[BVH_STACK_SIZE];
+	int size = 0;
+	int index = 0;
+
+	while (true)
+	{
+		const BVHNode& node = bvh.nodes[index];
+
+		if (overlaps(node))
+		{
+			if (!node.IsLeaf())
+			{
+				stack[size++] = node.first + 1;
+				index = node.first;
+				continue;
+			}
+
+			for (int i = node.first; i < node.first + node.count; ++i)
+				if (visit(bvh.leafTriangles[i])) return true;
+		}
+
+		if (size == 0) return false;
+		index = stack[--size];
+	}
+}
+
+// Inverse of the direction of a ray for the slab tests, with a huge value instead of an infinite
+// one so that a ray in the plane of a face does not give NaN
+inline glm::vec3 GetInverseDirection(const glm::vec3& direction)
+{
+	glm::vec3 inverse;
+	for (int axis = 0; axis < 3; ++axis)
+		inverse[axis] = fabsf(direction[axis]) > 1E-8f ? 1.f / direction[axis] : (direction[axis] < 0.f ? -1E8f : 1E8f);
+	return inverse;
+}
+
+// Distance along the ray to the bounds of the node, 0 if it starts inside them, FLT_MAX if it
+// misses them or reaches them beyond maxDistance
+inline float RayNodeDistance(const BVHNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+{
+	glm::vec3 t1 = (node.min - origin) * inverseDirection;
+	glm::vec3 t2 = (node.max - origin) * inverseDirection;
+	glm::vec3 tNear = glm::min(t1, t2);
+	glm::vec3 tFar = glm::max(t1, t2);
+
+	float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+	float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+	return entry <= exit ? entry : FLT_MAX;
+}
+
+// Closest hit of the ray with the triangles of the BVH up to maxDistance, or -1. hit(triangle),
+// called with BVHTriangles, returns the distance along the ray to the triangle, negative if it misses it. The children are
+// visited front to back, and the nodes entered beyond the closest hit found so far are culled.
+template <typename Hit>
+inline float RaycastBVH(const BVH& bvh, const Ray& ray, float maxDistance, const Hit& hit, int* outTriangle = 0)
+{
+	glm::vec3 inverseDirection = GetInverseDirection(ray.direction);
+
+	int stack[BVH_STACK_SIZE];
+	float distances[BVH_STACK_SIZE]; // Entry distance of each node of the stack
+	int size = 0;
+
+	float closest = maxDistance;
+	int closestTriangle = -1;
+
+	int index = RayNodeDistance(bvh.nodes[0], ray.origin, inverseDirection, closest) != FLT_MAX ? 0 : -1;
+
+	while (index >= 0)
+	{
+		const BVHNode& node = bvh.nodes[index];
+
+		if (node.IsLeaf())
+		{
+			for (int i = node.first; i < node.first + node.count; ++i)
+			{
+				float t = hit(bvh.leafTriangles[i]);
+
+				if (t >= 0.f && t <= closest)
+				{
+					closest = t;
+					closestTriangle = bvh.leafTriangles[i].index;
+				}
+			}
+		}
+		else
+		{
+			int nearChild = node.first;
+			int farChild = node.first + 1;
+			float nearDistance = RayNodeDistance(bvh.nodes[nearChild], ray.origin, inverseDirection, closest);
+			float farDistance = RayNodeDistance(bvh.nodes[farChild], ray.origin, inverseDirection, closest);
+
+			if (farDistance < nearDistance)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearDistance, farDistance);
+			}
+
+			if (nearDistance != FLT_MAX)
+			{
+				if (farDistance != FLT_MAX)
+				{
+					stack[size] = farChild;
+					distances[size++] = farDistance;
+				}
+
+				index = nearChild;
+				continue;
+			}
+		}
+
+		// The hits found since a node was pushed can make it too far
+		index = -1;
+
+		while (size > 0)
+		{
+			--size;
+
+			if (distances[size] <= closest)
+			{
+				index = stack[size];
+				break;
+			}
+		}
+	}
+
+	if (outTriangle != 0) *outTriangle = closestTriangle;
+
+	return closestTriangle >= 0 ? closest : -1.f;
+}
 
 //struct Mesh
 //{
@@ -50,11 +234,12 @@ class Mesh
 public:
 	VAO vao;
 	VBO vbo;
+	EBO ebo;
 
 	std::vector<Vertex> vertices;
 	std::vector<GLuint> indices;
 
-	BVHNode* accelerator;
+	BVH* accelerator; // 0 if the mesh is not accelerated
 
 	Mesh() : accelerator(0) {}
 
@@ -89,22 +274,41 @@ public:
 		return t;
 	}
 
+	BVHTriangle GetBVHTriangle(int index) const; // The triangle in the form of the BVH leaves
+
 	void Render();
 
 	void Update();
 
-	void Accelerate();
+	void UpdateIndices(int first, int count); // Uploads only the indices [first, first + count)
+
+	void Accelerate(); // Builds the BVH, meshes without triangles are not accelerated
 
+	// Refits the BVH if there is one, and rebuilds it if the triangles changed or the refit
+	// degraded it too much
 	void UpdateAccelerator();
 };
 
 void AccelerateMesh(Mesh& mesh);
 
-void SplitBVHNode(BVHNode* node, const Mesh& model, int depth);
+// Binned SAH build, O(n log n). The triangle indices are partitioned in place as the nodes are split,
+// and become the indices of the leaf triangles.
+void BuildBVH(BVH& bvh, const Mesh& mesh);
+
+void SetLeafTriangles(BVH& bvh, const Mesh& mesh); // Copies the vertices of the mesh into the leaf triangles, by their index
+
+// Recomputes the bounds of the nodes bottom up keeping the tree, O(n). Returns the new cost.
+float RefitBVH(BVH& bvh, const Mesh& mesh);
+
+// Expected cost of a query by the surface area heuristic, in triangle tests
+float GetBVHCost(const BVH& bvh);
+
+// Möller–Trumbore test, only the front face counts as in Raycast(Triangle, Ray)
+float Raycast(const BVHTriangle& triangle, const Ray& ray);
 
-void FreeBVHNode(BVHNode* node);
+float Raycast(const Mesh& mesh, const Ray& ray); // Closest hit, -1 if none
 
-float Raycast(const Mesh& mesh, const Ray& ray);
+float Raycast(const Mesh& mesh, const Ray& ray, int& triangle); // Also the triangle hit, -1 if none
 
 //int GetRaycastedTriangle(const Mesh& mesh, const Ray& ray);
 
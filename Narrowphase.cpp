@@ -0,0 +1,450 @@
+#include "Narrowphase.h"
+#include "Collider.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define CONTACT_EPSILON 1E-6f
+#define CONTACT_CLIP_TOLERANCE 1E-3f // Slack of the inside tests of the clipped points
+#define CONTACT_MERGE_DISTANCE_SQ 1E-6f // Points closer than this are the same point
+
+// The axes of an OBB are the rows of its orientation (see SimpleGeometry)
+static inline void GetAxes(const OBB& obb, glm::vec3* axes)
+{
+	for (int i = 0; i < 3; ++i)
+		axes[i] = glm::vec3(obb.orientation[0][i], obb.orientation[1][i], obb.orientation[2][i]);
+}
+
+static void GetVertices(const OBB& obb, glm::vec3* vertices)
+{
+	glm::vec3 axes[3];
+	GetAxes(obb, axes);
+
+	for (int i = 0; i < 8; ++i)
+	{
+		vertices[i] = obb.position
+			+ axes[0] * (i & 1 ? obb.size.x : -obb.size.x)
+			+ axes[1] * (i & 2 ? obb.size.y : -obb.size.y)
+			+ axes[2] * (i & 4 ? obb.size.z : -obb.size.z);
+	}
+}
+
+static void GetEdges(const OBB& obb, Line* edges)
+{
+	glm::vec3 v[8];
+	GetVertices(obb, v);
+
+	// Vertices that differ in one bit share an edge
+	int numEdges = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		for (int bit = 1; bit < 8; bit <<= 1)
+		{
+			if (i & bit) continue;
+			edges[numEdges++] = Line(v[i], v[i | bit]);
+		}
+	}
+}
+
+static void GetPlanes(const OBB& obb, Plane* planes)
+{
+	glm::vec3 axes[3];
+	GetAxes(obb, axes);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		planes[2 * i + 0] = Plane(axes[i], glm::dot(axes[i], obb.position + axes[i] * obb.size[i]));
+		planes[2 * i + 1] = Plane(-axes[i], -glm::dot(axes[i], obb.position - axes[i] * obb.size[i]));
+	}
+}
+
+static bool ClipToPlane(const Plane& plane, const Line& line, Point* outPoint)
+{
+	glm::vec3 ab = line.end - line.start;
+
+	float nA = glm::dot(plane.normal, line.start);
+	float nAB = glm::dot(plane.normal, ab);
+
+	if (fabsf(nAB) < CONTACT_EPSILON) return false; // Parallel
+
+	float t = (plane.distance - nA) / nAB;
+	if (t < 0.f || t > 1.f) return false;
+
+	*outPoint = line.start + ab * t;
+	return true;
+}
+
+// Points where the edges cross the faces of the box
+static void ClipEdgesToOBB(const Line* edges, const OBB& obb, std::vector<glm::vec3>& outPoints)
+{
+	Plane planes[6];
+	GetPlanes(obb, planes);
+
+	OBB tolerant = obb;
+	tolerant.size += glm::vec3(CONTACT_CLIP_TOLERANCE);
+
+	Point point;
+	for (int i = 0; i < 6; ++i)
+	{
+		for (int j = 0; j < 12; ++j)
+		{
+			if (ClipToPlane(planes[i], edges[j], &point) && PointInOBB(point, tolerant))
+				outPoints.push_back(point);
+		}
+	}
+}
+
+static void SetSingleContact(ContactManifold* manifold, const glm::vec3& normal, float depth, const glm::vec3& contact)
+{
+	manifold->normal = normal;
+	manifold->depth = depth;
+	manifold->numContacts = 1;
+	manifold->contacts[0] = contact;
+	manifold->depths[0] = depth;
+}
+
+static void SetContacts(ContactManifold* manifold, const glm::vec3& normal, std::vector<glm::vec3>& points, std::vector<float>& depths)
+{
+	ReduceContacts(points, depths, normal);
+
+	manifold->normal = normal;
+	manifold->depth = 0.f;
+	manifold->numContacts = (int)points.size();
+
+	for (int i = 0; i < points.size(); ++i)
+	{
+		manifold->contacts[i] = points[i];
+		manifold->depths[i] = depths[i];
+		if (depths[i] > manifold->depth) manifold->depth = depths[i];
+	}
+}
+
+void ReduceContacts(std::vector<glm::vec3>& points, std::vector<float>& depths, const glm::vec3& normal)
+{
+	// Merge duplicates (the same corner may be found from both boxes)
+	for (int i = 0; i < points.size(); ++i)
+	{
+		for (int j = (int)points.size() - 1; j > i; --j)
+		{
+			if (glm::distance2(points[i], points[j]) < CONTACT_MERGE_DISTANCE_SQ)
+			{
+				if (depths[j] > depths[i]) depths[i] = depths[j];
+				points.erase(points.begin() + j);
+				depths.erase(depths.begin() + j);
+			}
+		}
+	}
+
+	int n = (int)points.size();
+	if (n <= MAX_CONTACT_POINTS) return;
+
+	// 1. Deepest point
+	int i0 = 0;
+	for (int i = 1; i < n; ++i)
+		if (depths[i] > depths[i0]) i0 = i;
+
+	// 2. Farthest point from it
+	int i1 = i0 == 0 ? 1 : 0;
+	for (int i = 0; i < n; ++i)
+		if (glm::distance2(points[i], points[i0]) > glm::distance2(points[i1], points[i0])) i1 = i;
+
+	// 3. Point that makes the largest triangle
+	int i2 = -1;
+	float maxArea = 0.f;
+	for (int i = 0; i < n; ++i)
+	{
+		float area = glm::dot(glm::cross(points[i1] - points[i0], points[i] - points[i0]), normal);
+		if (fabsf(area) > fabsf(maxArea))
+		{
+			maxArea = area;
+			i2 = i;
+		}
+	}
+
+	std::vector<int> kept = { i0, i1 };
+	if (i2 != -1)
+	{
+		// Counterclockwise around the normal
+		if (maxArea < 0.f) std::swap(i1, i2);
+		kept = { i0, i1, i2 };
+
+		// 4. Point farthest outside of the triangle
+		int i3 = -1;
+		float minEdgeArea = 0.f;
+		int triangle[3] = { i0, i1, i2 };
+		for (int i = 0; i < n; ++i)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				const glm::vec3& a = points[triangle[e]];
+				const glm::vec3& b = points[triangle[(e + 1) % 3]];
+
+				float edgeArea = glm::dot(glm::cross(b - a, points[i] - a), normal);
+				if (edgeArea < minEdgeArea)
+				{
+					minEdgeArea = edgeArea;
+					i3 = i;
+				}
+			}
+		}
+
+		if (i3 != -1) kept.push_back(i3);
+	}
+
+	std::vector<glm::vec3> keptPoints;
+	std::vector<float> keptDepths;
+	for (int i : kept)
+	{
+		keptPoints.push_back(points[i]);
+		keptDepths.push_back(depths[i]);
+	}
+
+	points.swap(keptPoints);
+	depths.swap(keptDepths);
+}
+
+bool SphereSphere(const Sphere& sphere1, const Sphere& sphere2, ContactManifold* outManifold)
+{
+	glm::vec3 d = sphere2.position - sphere1.position;
+	float radiusSum = sphere1.radius + sphere2.radius;
+
+	float distanceSq = glm::length2(d);
+	if (distanceSq >= radiusSum * radiusSum) return false;
+
+	float distance = sqrtf(distanceSq);
+	glm::vec3 normal = distance > CONTACT_EPSILON ? d / distance : glm::vec3(0.f, 1.f, 0.f);
+	float depth = radiusSum - distance;
+
+	SetSingleContact(outManifold, normal, depth, sphere1.position + normal * (sphere1.radius - depth * 0.5f));
+	return true;
+}
+
+bool SphereOBB(const Sphere& sphere, const OBB& obb, ContactManifold* outManifold)
+{
+	Point closestPoint = ClosestPoint(sphere.position, obb);
+
+	glm::vec3 d = closestPoint - sphere.position;
+	float distanceSq = glm::length2(d);
+	if (distanceSq >= sphere.radius * sphere.radius) return false;
+
+	if (distanceSq > CONTACT_EPSILON * CONTACT_EPSILON)
+	{
+		float distance = sqrtf(distanceSq);
+		glm::vec3 normal = d / distance;
+		float depth = sphere.radius - distance;
+
+		SetSingleContact(outManifold, normal, depth, sphere.position + normal * (sphere.radius - depth * 0.5f));
+		return true;
+	}
+
+	// The center is inside of the box: push it out through the closest face
+	glm::vec3 axes[3];
+	GetAxes(obb, axes);
+
+	glm::vec3 local = sphere.position - obb.position;
+
+	int face = 0;
+	float faceDistance = 0.f;
+	float faceSign = 1.f;
+	for (int i = 0; i < 3; ++i)
+	{
+		float projection = glm::dot(local, axes[i]);
+		float distance = obb.size[i] - fabsf(projection);
+		if (i == 0 || distance < faceDistance)
+		{
+			face = i;
+			faceDistance = distance;
+			faceSign = projection < 0.f ? -1.f : 1.f;
+		}
+	}
+
+	glm::vec3 normal = -faceSign * axes[face]; // Towards the inside of the box
+	SetSingleContact(outManifold, normal, sphere.radius + faceDistance, sphere.position);
+	return true;
+}
+
+bool OBBOBB(const OBB& obb1, const OBB& obb2, ContactManifold* outManifold, int* satAxis)
+{
+	glm::vec3 axes1[3], axes2[3];
+	GetAxes(obb1, axes1);
+	GetAxes(obb2, axes2);
+
+	glm::vec3 test[15];
+	for (int i = 0; i < 3; ++i)
+	{
+		test[i] = axes1[i];
+		test[3 + i] = axes2[i];
+		test[6 + i * 3 + 0] = glm::cross(axes2[i], axes1[0]);
+		test[6 + i * 3 + 1] = glm::cross(axes2[i], axes1[1]);
+		test[6 + i * 3 + 2] = glm::cross(axes2[i], axes1[2]);
+	}
+
+	// The axis that separated the boxes in the last frame is likely to still do it
+	if (satAxis && *satAxis != NO_SAT_AXIS && glm::length2(test[*satAxis]) > CONTACT_EPSILON)
+	{
+		Interval a = GetInterval(obb1, test[*satAxis]);
+		Interval b = GetInterval(obb2, test[*satAxis]);
+		if (b.min > a.max || a.min > b.max) return false;
+	}
+
+	float depth = INFINITY;
+	glm::vec3 normal(0.f);
+
+	for (int i = 0; i < 15; ++i)
+	{
+		float lengthSq = glm::length2(test[i]);
+		if (lengthSq < CONTACT_EPSILON) continue; // Parallel edges
+
+		glm::vec3 axis = test[i] / sqrtf(lengthSq);
+
+		Interval a = GetInterval(obb1, axis);
+		Interval b = GetInterval(obb2, axis);
+
+		if (b.min > a.max || a.min > b.max)
+		{
+			if (satAxis) *satAxis = i;
+			return false;
+		}
+
+		float penetration = std::min(a.max - b.min, b.max - a.min);
+		if (penetration < depth)
+		{
+			depth = penetration;
+			normal = axis;
+		}
+	}
+
+	if (satAxis) *satAxis = NO_SAT_AXIS;
+
+	if (glm::dot(obb2.position - obb1.position, normal) < 0.f)
+		normal = -normal;
+
+	Line edges1[12], edges2[12];
+	GetEdges(obb1, edges1);
+	GetEdges(obb2, edges2);
+
+	std::vector<glm::vec3> points;
+	ClipEdgesToOBB(edges2, obb1, points);
+	ClipEdgesToOBB(edges1, obb2, points);
+
+	if (points.empty())
+	{
+		// Numerical corner case: use the deepest vertex of the second box
+		glm::vec3 vertices[8];
+		GetVertices(obb2, vertices);
+
+		int deepest = 0;
+		for (int i = 1; i < 8; ++i)
+			if (glm::dot(vertices[i], normal) < glm::dot(vertices[deepest], normal)) deepest = i;
+
+		points.push_back(vertices[deepest]);
+	}
+
+	// Move the points to the plane halfway between both surfaces
+	Interval interval = GetInterval(obb1, normal);
+	float distance = (interval.max - interval.min) * 0.5f - depth * 0.5f;
+	glm::vec3 pointOnPlane = obb1.position + normal * distance;
+
+	for (glm::vec3& point : points)
+		point += normal * glm::dot(normal, pointOnPlane - point);
+
+	std::vector<float> depths(points.size(), depth);
+	SetContacts(outManifold, normal, points, depths);
+	return true;
+}
+
+bool SpherePlane(const Sphere& sphere, const Plane& plane, ContactManifold* outManifold)
+{
+	float distance = glm::dot(sphere.position, plane.normal) - plane.distance;
+	if (distance >= sphere.radius) return false;
+
+	glm::vec3 normal = -plane.normal;
+	float depth = sphere.radius - distance;
+
+	SetSingleContact(outManifold, normal, depth, sphere.position + normal * (sphere.radius - depth * 0.5f));
+	return true;
+}
+
+bool OBBPlane(const OBB& obb, const Plane& plane, ContactManifold* outManifold)
+{
+	glm::vec3 vertices[8];
+	GetVertices(obb, vertices);
+
+	std::vector<glm::vec3> points;
+	std::vector<float> depths;
+
+	for (const glm::vec3& vertex : vertices)
+	{
+		float distance = glm::dot(vertex, plane.normal) - plane.distance;
+		if (distance >= 0.f) continue;
+
+		points.push_back(vertex - plane.normal * (distance * 0.5f));
+		depths.push_back(-distance);
+	}
+
+	if (points.empty()) return false;
+
+	SetContacts(outManifold, -plane.normal, points, depths);
+	return true;
+}
+
+bool FindContacts(RigidBody& body1, RigidBody& body2, ContactManifold* outManifold, int* satAxis)
+{
+	const Collider& collider1 = body1.GetCollider();
+	const Collider& collider2 = body2.GetCollider();
+
+	bool hit = false;
+
+	if (collider1.type == BOX_COLLIDER && collider2.type == BOX_COLLIDER)
+	{
+		hit = OBBOBB(
+			GetOBB(collider1, body1.GetPosition(), body1.GetOrientation()),
+			GetOBB(collider2, body2.GetPosition(), body2.GetOrientation()),
+			outManifold, satAxis
+		);
+	}
+	else if (collider1.type == SPHERE_COLLIDER && collider2.type == SPHERE_COLLIDER)
+	{
+		hit = SphereSphere(GetSphere(collider1, body1.GetPosition()), GetSphere(collider2, body2.GetPosition()), outManifold);
+	}
+	else if (collider1.type == SPHERE_COLLIDER && collider2.type == BOX_COLLIDER)
+	{
+		hit = SphereOBB(GetSphere(collider1, body1.GetPosition()), GetOBB(collider2, body2.GetPosition(), body2.GetOrientation()), outManifold);
+	}
+	else if (collider1.type == BOX_COLLIDER && collider2.type == SPHERE_COLLIDER)
+	{
+		hit = SphereOBB(GetSphere(collider2, body2.GetPosition()), GetOBB(collider1, body1.GetPosition(), body1.GetOrientation()), outManifold);
+		if (hit) outManifold->normal = -outManifold->normal;
+	}
+
+	if (!hit) return false;
+
+	outManifold->body1 = &body1;
+	outManifold->body2 = &body2;
+	outManifold->plane = -1;
+	return true;
+}
+
+bool FindContacts(RigidBody& body, const Plane& plane, ContactManifold* outManifold)
+{
+	const Collider& collider = body.GetCollider();
+
+	bool hit = false;
+
+	switch (collider.type)
+	{
+	case BOX_COLLIDER:
+		hit = OBBPlane(GetOBB(collider, body.GetPosition(), body.GetOrientation()), plane, outManifold);
+		break;
+
+	case SPHERE_COLLIDER:
+		hit = SpherePlane(GetSphere(collider, body.GetPosition()), plane, outManifold);
+		break;
+	}
+
+	if (!hit) return false;
+
+	outManifold->body1 = &body;
+	outManifold->body2 = nullptr;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "SimpleGeometry.h"
+#include "RigidBody.h"
+
+#include <functional>
+#include <vector>
+#include <unordered_map>
+
+#define MAX_CONTACT_POINTS 4
+#define NO_SAT_AXIS -1
+
+// Contact between two bodies, or between a body and a static plane (body2 == nullptr)
+struct ContactManifold
+{
+	RigidBody* body1;
+	RigidBody* body2;
+	int plane; // Index of the static plane, -1 for two bodies
+
+	glm::vec3 normal; // From body1 to body2
+	float depth; // Largest penetration
+
+	int numContacts;
+	glm::vec3 contacts[MAX_CONTACT_POINTS]; // World points between both surfaces
+	float depths[MAX_CONTACT_POINTS];
+
+	inline ContactManifold() : body1(nullptr), body2(nullptr), plane(-1), normal(0.f), depth(0.f), numContacts(0) {}
+};
+
+// Identifies a contact pair across frames
+struct ContactKey
+{
+	const RigidBody* body1;
+	const RigidBody* body2;
+	int plane;
+
+	inline ContactKey(const RigidBody* body1, const RigidBody* body2, int plane) : body1(body1), body2(body2), plane(plane) {}
+
+	inline bool operator==(const ContactKey& other) const
+	{
+		return body1 == other.body1 && body2 == other.body2 && plane == other.plane;
+	}
+};
+
+struct ContactKeyHash
+{
+	inline size_t operator()(const ContactKey& key) const
+	{
+		size_t hash = std::hash<const void*>()(key.body1);
+		hash ^= std::hash<const void*>()(key.body2) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		hash ^= std::hash<int>()(key.plane) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		return hash;
+	}
+};
+
+// Data kept for a contact pair between frames
+struct ContactCacheEntry
+{
+	int satAxis = NO_SAT_AXIS; // Separating axis found in the last frame, tested first
+
+	// Accumulated impulses of the last solve, to warm start the next one
+	int numContacts = 0;
+	glm::vec3 localPoints[MAX_CONTACT_POINTS]; // Contact points in the space of body1
+	float normalImpulses[MAX_CONTACT_POINTS];
+	glm::vec3 tangentImpulses[MAX_CONTACT_POINTS]; // Friction impulse in world space
+};
+
+typedef std::unordered_map<ContactKey, ContactCacheEntry, ContactKeyHash> ContactCache;
+
+// Contact manifolds of pairs of shapes. The normal goes from the first shape to the second.
+// satAxis (optional) is the separating axis of the previous frame and receives the new one.
+bool SphereSphere(const Sphere& sphere1, const Sphere& sphere2, ContactManifold* outManifold);
+
+bool SphereOBB(const Sphere& sphere, const OBB& obb, ContactManifold* outManifold);
+
+bool OBBOBB(const OBB& obb1, const OBB& obb2, ContactManifold* outManifold, int* satAxis = nullptr);
+
+// The solid side of a plane is the one opposite to its normal
+bool SpherePlane(const Sphere& sphere, const Plane& plane, ContactManifold* outManifold);
+
+bool OBBPlane(const OBB& obb, const Plane& plane, ContactManifold* outManifold);
+
+// Contact manifold between the colliders of two bodies (sets the bodies of the manifold)
+bool FindContacts(RigidBody& body1, RigidBody& body2, ContactManifold* outManifold, int* satAxis = nullptr);
+
+bool FindContacts(RigidBody& body, const Plane& plane, ContactManifold* outManifold);
+
+// Keeps the MAX_CONTACT_POINTS points that cover the largest area, starting by the deepest one
+void ReduceContacts(std::vector<glm::vec3>& points, std::vector<float>& depths, const glm::vec3& normal);
\ No newline at end of file
@@ -1,7 +1,58 @@
 #include "Particle.h"
 
+Particle::Particle(const Particle& other) : ApplicationPoint(PARTICLE)
+{
+	*this = other;
+}
+
+Particle& Particle::operator=(const Particle& other)
+{
+	if (this == &other) return *this;
+
+	glm::vec3 otherForce = other.force;
+	float otherDamping = other.damping;
+	if (other.pool)
+	{
+		int index = other.pool->GetIndex(other.handle);
+		otherForce = other.pool->forces[index];
+		otherDamping = other.pool->dampings[index];
+	}
+
+	SetMass(other.GetMass());
+	SetPosition(other.GetPosition());
+	SetVelocity(other.GetVelocity());
+	SetFixed(other.IsFixed());
+
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->forces[index] = otherForce;
+		pool->dampings[index] = otherDamping;
+	}
+	else
+	{
+		force = otherForce;
+		damping = otherDamping;
+	}
+
+	return *this;
+}
+
+Particle::~Particle()
+{
+	if (pool)
+		pool->Remove(handle);
+}
+
 void Particle::Update(float deltaTime)
 {
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->Integrate(deltaTime, index, index + 1);
+		return;
+	}
+
 	if(!fixed)
 	{
 		force -= damping * velocity;
@@ -14,12 +65,116 @@ void Particle::Update(float deltaTime)
 }
 void Particle::AddForce(const glm::vec3& newForce)
 {
-	force += newForce;
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->forces[index] += newForce;
+		pool->awake[index] = 1;
+	}
+	else
+		force += newForce;
 }
 
 void Particle::ResetForces()
 {
-	force = glm::vec3(0.f);
+	if (pool)
+		pool->forces[pool->GetIndex(handle)] = glm::vec3(0.f);
+	else
+		force = glm::vec3(0.f);
+}
+
+glm::vec3 Particle::GetInterpolatedPosition(float interpolation) const
+{
+	if (pool)
+		return pool->GetInterpolatedPosition(pool->GetIndex(handle), interpolation);
+
+	return position;
+}
+
+void Particle::SetPosition(glm::vec3 newPosition)
+{
+	// Moving a particle by hand is a teleport, so nothing is interpolated
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->positions[index] = newPosition;
+		pool->previousPositions[index] = newPosition;
+		pool->awake[index] = 1;
+	}
+	else
+		position = newPosition;
+}
+
+void Particle::ApplyImpulse(const glm::vec3& impulse)
+{
+	if (IsFixed()) return;
+
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->velocities[index] += impulse * pool->inverseMasses[index];
+		pool->awake[index] = 1;
+	}
+	else
+		velocity += impulse / mass;
+}
+
+void Particle::ApplyPositionImpulse(const glm::vec3& positionImpulse)
+{
+	if (IsFixed()) return;
+
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->positions[index] += positionImpulse * pool->inverseMasses[index];
+		pool->awake[index] = 1;
+	}
+	else
+		position += positionImpulse / mass;
+}
+
+void Particle::SetVelocity(glm::vec3 newVelocity)
+{
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->velocities[index] = newVelocity;
+		pool->awake[index] = 1;
+	}
+	else
+		velocity = newVelocity;
+}
+
+void Particle::SetMass(float newMass)
+{
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->masses[index] = newMass;
+		pool->inverseMasses[index] = 1.f / newMass;
+		pool->massVersion++;
+	}
+	else
+		mass = newMass;
+}
+
+void Particle::SetFixed(bool newFixed)
+{
+	if (pool)
+	{
+		int index = pool->GetIndex(handle);
+		pool->fixed[index] = newFixed ? 1 : 0;
+		pool->awake[index] = 1;
+		pool->massVersion++;
+	}
+	else
+		fixed = newFixed;
+}
+
+void Particle::WakeUp()
+{
+	if (pool)
+		pool->awake[pool->GetIndex(handle)] = 1;
 }
 
 Particle* ToParticle(PhysicsObject* obj)
@@ -3,7 +3,11 @@
 #include <glm/glm.hpp>
 #include "PhysicsObject.h"
 #include "ApplicationPoint.h"
+#include "ParticlePool.h"
 
+// A particle is a view over a slot of a ParticlePool. While it is not stored in any pool it
+// keeps its own state, which is copied into the pool when it is added to one and copied back
+// when it is removed.
 class Particle : public ApplicationPoint
 {
 protected:
@@ -15,25 +19,45 @@ protected:
 	//glm::vec3 oldPosition;
 
 	float damping = 1.f;
-
-public:
 	bool fixed = false;
 
+	ParticlePool* pool = nullptr;
+	ParticleHandle handle;
+
+	friend class ParticlePool;
+
+public:
 	inline Particle() : mass(1.0f), position(0.0f), velocity(0.0f), force(0.0f), ApplicationPoint(PARTICLE) {}
 	inline Particle(float mass) : mass(1.f), position(0.f), velocity(0.f), force(0.f), ApplicationPoint(PARTICLE) {}
 
+	Particle(const Particle& other); // The copy does not belong to any pool
+	Particle& operator=(const Particle& other);
+
+	~Particle(); // Removes the particle from its pool
+
 	void Update(float deltaTime);
 
 	void AddForce(const glm::vec3& newForce) override;
+	void ApplyImpulse(const glm::vec3& impulse) override;
+	void ApplyPositionImpulse(const glm::vec3& positionImpulse) override;
 	void ResetForces();
 
-	virtual inline glm::vec3 GetPosition() const { return position; }
-	virtual inline glm::vec3 GetVelocity() const { return velocity; }
-	virtual inline float GetMass() const { return mass; }
-
-	virtual inline void SetPosition(glm::vec3 newPosition) { position = newPosition; }
-	virtual inline void SetVelocity(glm::vec3 newVelocity) { velocity = newVelocity; }
-	virtual inline void SetMass(float newMass) { mass = newMass; }
+	inline ParticlePool* GetPool() const { return pool; }
+	inline ParticleHandle GetHandle() const { return handle; }
+
+	virtual inline glm::vec3 GetPosition() const { return pool ? pool->positions[pool->GetIndex(handle)] : position; }
+	virtual inline glm::vec3 GetVelocity() const { return pool ? pool->velocities[pool->GetIndex(handle)] : velocity; }
+	glm::vec3 GetInterpolatedPosition(float interpolation) const override;
+	virtual inline float GetMass() const { return pool ? pool->masses[pool->GetIndex(handle)] : mass; }
+	inline bool IsFixed() const { return pool ? pool->fixed[pool->GetIndex(handle)] != 0 : fixed; }
+	inline float GetInverseMass(const glm::vec3& direction) const override { return IsFixed() ? 0.f : 1.f / GetMass(); }
+	inline bool IsAwake() const { return pool ? pool->awake[pool->GetIndex(handle)] != 0 : true; }
+
+	virtual void SetPosition(glm::vec3 newPosition);
+	virtual void SetVelocity(glm::vec3 newVelocity);
+	virtual void SetMass(float newMass);
+	void SetFixed(bool newFixed);
+	void WakeUp(); // The physics system wakes the island of the particle in its next update
 };
 
 Particle* ToParticle(PhysicsObject* obj);
\ No newline at end of file
@@ -5,12 +5,12 @@
 class ParticleCoordinator : public Coordinator
 {
 public:
-	void coordinate(Model* model, PhysicsObject* object) const override
+	void coordinate(Model* model, PhysicsObject* object, float interpolation = 1.f) const override
 	{
 		Particle* particle = ToParticle(object);
 		if (!particle) return;
 
-		model->position = particle->GetPosition();
+		model->position = particle->GetInterpolatedPosition(interpolation);
 	}
 };
 
@@ -0,0 +1,181 @@
+#include "ParticlePool.h"
+#include "Particle.h"
+
+ParticleHandle ParticlePool::Add(Particle* particle)
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (unsigned int)slotToIndex.size();
+		slotToIndex.push_back(0);
+		generations.push_back(0);
+	}
+
+	unsigned int index = (unsigned int)positions.size();
+	slotToIndex[slot] = index;
+	indexToSlot.push_back(slot);
+
+	positions.push_back(particle->position);
+	previousPositions.push_back(particle->position);
+	velocities.push_back(particle->velocity);
+	forces.push_back(particle->force);
+	masses.push_back(particle->mass);
+	inverseMasses.push_back(1.f / particle->mass);
+	dampings.push_back(particle->damping);
+	fixed.push_back(particle->fixed ? 1 : 0);
+	awake.push_back(1);
+	restingFrames.push_back(0);
+	views.push_back(particle);
+
+	massVersion++;
+
+	ParticleHandle handle(slot, generations[slot]);
+	particle->pool = this;
+	particle->handle = handle;
+
+	return handle;
+}
+
+void ParticlePool::Remove(ParticleHandle handle)
+{
+	if (!IsValid(handle)) return;
+
+	unsigned int index = slotToIndex[handle.slot];
+	unsigned int last = (unsigned int)positions.size() - 1;
+
+	// Give the state back to the particle so it can live outside of the pool
+	Particle* particle = views[index];
+	if (particle != nullptr)
+	{
+		particle->position = positions[index];
+		particle->velocity = velocities[index];
+		particle->force = forces[index];
+		particle->mass = masses[index];
+		particle->damping = dampings[index];
+		particle->fixed = fixed[index] != 0;
+		particle->pool = nullptr;
+		particle->handle = ParticleHandle();
+	}
+
+	// Swap with the last element to keep the arrays dense
+	if (index != last)
+	{
+		positions[index] = positions[last];
+		previousPositions[index] = previousPositions[last];
+		velocities[index] = velocities[last];
+		forces[index] = forces[last];
+		masses[index] = masses[last];
+		inverseMasses[index] = inverseMasses[last];
+		dampings[index] = dampings[last];
+		fixed[index] = fixed[last];
+		awake[index] = awake[last];
+		restingFrames[index] = restingFrames[last];
+		views[index] = views[last];
+
+		unsigned int movedSlot = indexToSlot[last];
+		indexToSlot[index] = movedSlot;
+		slotToIndex[movedSlot] = index;
+	}
+
+	positions.pop_back();
+	previousPositions.pop_back();
+	velocities.pop_back();
+	forces.pop_back();
+	masses.pop_back();
+	inverseMasses.pop_back();
+	dampings.pop_back();
+	fixed.pop_back();
+	awake.pop_back();
+	restingFrames.pop_back();
+	views.pop_back();
+	indexToSlot.pop_back();
+
+	generations[handle.slot]++;
+	freeSlots.push_back(handle.slot);
+	massVersion++;
+}
+
+void ParticlePool::Clear()
+{
+	while (!indexToSlot.empty())
+	{
+		unsigned int slot = indexToSlot.back();
+		Remove(ParticleHandle(slot, generations[slot]));
+	}
+}
+
+void ParticlePool::Reserve(int capacity)
+{
+	positions.reserve(capacity);
+	previousPositions.reserve(capacity);
+	velocities.reserve(capacity);
+	forces.reserve(capacity);
+	masses.reserve(capacity);
+	inverseMasses.reserve(capacity);
+	dampings.reserve(capacity);
+	fixed.reserve(capacity);
+	awake.reserve(capacity);
+	restingFrames.reserve(capacity);
+	views.reserve(capacity);
+	indexToSlot.reserve(capacity);
+}
+
+bool ParticlePool::IsValid(ParticleHandle handle) const
+{
+	return handle.slot < generations.size() && generations[handle.slot] == handle.generation;
+}
+
+void ParticlePool::Integrate(float deltaTime)
+{
+	Integrate(deltaTime, 0, Size());
+}
+
+void ParticlePool::Integrate(float deltaTime, int begin, int end)
+{
+	glm::vec3* position = positions.data();
+	glm::vec3* velocity = velocities.data();
+	glm::vec3* force = forces.data();
+	const float* inverseMass = inverseMasses.data();
+	const float* damping = dampings.data();
+	const unsigned char* isFixed = fixed.data();
+	const unsigned char* isAwake = awake.data();
+
+	// Branchless so the loop can be vectorized: fixed and sleeping particles are masked out
+	for (int i = begin; i < end; ++i)
+	{
+		float active = (isFixed[i] | !isAwake[i]) ? 0.f : 1.f;
+
+		glm::vec3 acceleration = (force[i] - damping[i] * velocity[i]) * inverseMass[i];
+		velocity[i] += (active * deltaTime) * acceleration;
+		position[i] += (active * deltaTime) * velocity[i];
+
+		force[i] = glm::vec3(0.f);
+	}
+}
+
+void ParticlePool::ResetForces()
+{
+	for (glm::vec3& force : forces)
+		force = glm::vec3(0.f);
+}
+
+void ParticlePool::SetAwake(bool newAwake)
+{
+	for (int i = 0; i < Size(); ++i)
+	{
+		awake[i] = newAwake ? 1 : 0;
+		restingFrames[i] = 0;
+		if (!newAwake)
+			velocities[i] = glm::vec3(0.f);
+	}
+}
+
+void ParticlePool::SaveState()
+{
+	previousPositions = positions;
+}
\ No newline at end of file
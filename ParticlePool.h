@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "SlotMap.h"
+
+class Particle;
+
+#define INVALID_PARTICLE_SLOT INVALID_SLOT
+
+// Stable reference to a particle stored in a ParticlePool
+typedef SlotHandle ParticleHandle;
+
+// Structure of arrays storage for particles. The data is kept dense (swap and pop on removal)
+// so that the integration is a single linear sweep over contiguous arrays.
+class ParticlePool
+{
+protected:
+	std::vector<unsigned int> slotToIndex;
+	std::vector<unsigned int> indexToSlot;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeSlots;
+
+public:
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> previousPositions; // Positions before the last fixed step, for rendering
+	std::vector<glm::vec3> velocities;
+	std::vector<glm::vec3> forces;
+	std::vector<float> masses;
+	std::vector<float> inverseMasses;
+	std::vector<float> dampings;
+	std::vector<unsigned char> fixed; // 1 if the particle is fixed, 0 otherwise
+	std::vector<unsigned char> awake; // 0 while sleeping; set again when the particle is moved or pushed
+	std::vector<int> restingFrames; // Consecutive frames with low kinetic energy
+
+	std::vector<Particle*> views; // Particle objects attached to each dense index
+
+	// Changes whenever a particle is added, removed, or changes its mass or fixed flag, so that
+	// the bounds derived from the masses know when to be rebuilt
+	unsigned int massVersion = 0;
+
+	ParticlePool() = default;
+
+	ParticlePool(const ParticlePool&) = delete;
+	ParticlePool& operator=(const ParticlePool&) = delete;
+
+	ParticleHandle Add(Particle* particle); // Copies the state of the particle into the pool and attaches it
+
+	void Remove(ParticleHandle handle); // Copies the state back into the particle and detaches it
+
+	void Clear();
+
+	void Reserve(int capacity);
+
+	bool IsValid(ParticleHandle handle) const;
+
+	inline unsigned int GetIndex(ParticleHandle handle) const { return slotToIndex[handle.slot]; }
+
+	inline int Size() const { return (int)positions.size(); }
+
+	void Integrate(float deltaTime);
+
+	void Integrate(float deltaTime, int begin, int end); // Integrates the dense range [begin, end)
+
+	void ResetForces();
+
+	void SetAwake(bool awake); // Wakes up or puts to sleep every particle (sleeping ones lose their velocity)
+
+	void SaveState(); // Stores the current positions as the previous ones
+
+	// Blend between the previous and the current position (0 = previous, 1 = current)
+	inline glm::vec3 GetInterpolatedPosition(int index, float interpolation) const
+	{
+		return previousPositions[index] + (positions[index] - previousPositions[index]) * interpolation;
+	}
+};
\ No newline at end of file
@@ -9,6 +9,7 @@ enum
 	CLOTH,
 	RIGID_BODY,
 	RIGID_BODY_POINT,
+	ROPE,
 	NO_PHYSICS
 };
 
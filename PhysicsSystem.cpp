@@ -2,76 +2,967 @@
 
 #include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <climits>
+#include <cfloat>
 
-//#define ASYNC
+// Relative cost of updating each kind of object, used to size the chunks of the thread pool
+#define RIGID_BODY_UPDATE_COST 40.f
+#define PARTICLE_UPDATE_COST 1.f
+#define IMPLICIT_SPRING_COST 20.f
 
-#ifdef ASYNC
-#include <future>
+#define PARTICLE_GRAIN_SIZE 4096 // Particles integrated per chunk
+#define SPRING_GRAIN_SIZE 512 // Springs of the same color applied per chunk
 
 void PhysicsSystem::Update(float deltaTime)
 {
+	// Collision detection
+	UpdateBroadphase();
+	UpdateNarrowphase();
+
+	UpdateIslands();
+
+	UpdateSubsteps(deltaTime);
+
+	// The spring network takes all the substeps, the rest of the objects a single step with the
+	// first one. The external forces are cleared by every integration, so they are kept.
+	if (springSubsteps > 1)
+		SaveExternalForces();
+
+	for (int substep = 0; substep < springSubsteps; ++substep)
+	{
+		if (substep > 0)
+			RestoreExternalForces();
+
+		if (threadPool == nullptr)
+			UpdateObjects(deltaTime, substep);
+		else
+			UpdateObjectsParallel(deltaTime, substep);
+	}
+
+	UpdateClothCollisions();
+}
+
+void PhysicsSystem::UpdateClothCollisions()
+{
+	clothContacts.resize(cloths.Size());
+	clothBodyContacts.clear();
+	numClothContacts = 0;
+
+	for (int c = 0; c < cloths.Size(); ++c)
+	{
+		Cloth* cloth = cloths[c];
+		if (!cloth->IsObstacleCollisionEnabled() || cloth->GetNumberOfParticles() == 0) continue;
+
+		// The hash of the cloth is only built if a body is near it
+		glm::vec3 min(FLT_MAX);
+		glm::vec3 max(-FLT_MAX);
+		for (const glm::vec3& position : cloth->particlePool.positions)
+		{
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+
+		glm::vec3 margin(cloth->GetObstacleThickness());
+		AABB bounds = FromMinMax(min - margin, max + margin);
+
+		broadphase->Query(bounds, clothQueryBodies);
+
+		// A sleeping cloth only wakes up when an awake body reaches it
+		if (!cloth->IsAwake())
+		{
+			for (RigidBody* body : clothQueryBodies)
+			{
+				if (!body->IsAwake()) continue;
+				cloth->SetAwake(true);
+				break;
+			}
+			if (!cloth->IsAwake()) continue;
+		}
+
+		ClothContacts& contacts = clothContacts[c];
+		contacts.Reset(cloth->GetNumberOfParticles());
+
+		// The bodies that reach the cloth are linked to it, so their islands sleep and wake together
+		for (RigidBody* body : clothQueryBodies)
+		{
+			if (FindClothContacts(*cloth, *body, contacts))
+				clothBodyContacts.push_back(std::make_pair(cloth, body));
+		}
+
+		for (const Plane& plane : planes)
+			FindClothContacts(*cloth, plane, contacts);
+
+		if (staticScene != nullptr)
+		{
+			for (Model* model : staticScene->Query(bounds))
+				FindClothContacts(*cloth, *model, contacts);
+		}
+
+		numClothContacts += SolveClothContacts(*cloth, contacts);
+	}
+}
+
+// Sleeping objects are skipped, they only drop the accelerations applied to them
+void PhysicsSystem::UpdateObjects(float deltaTime, int substep)
+{
+	float substepDeltaTime = deltaTime / springSubsteps;
+	bool first = substep == 0;
+
 	// Interactions
-	/*std::vector<std::future<void>> springFutures;
 	for (Spring* spring : springs)
+		if (IsSpringAwake(*spring) && !IsImplicitSpring(*spring))
+			spring->applyForce();
+
+	if (first)
+		contactSolver.Solve(contacts, contactCache, deltaTime);
+
+	// Updates
+	UpdateRigidBodies(deltaTime, substep, 0, rigidBodies.Size());
+
+	// The free particles move with the spring network
+	IntegrateParticles(substepDeltaTime);
+
+	for (int i = 0; i < cloths.Size(); ++i)
+	{
+		if (!first && !clothInNetwork[i]) continue;
+
+		Cloth* cloth = cloths[i];
+		if (cloth->IsAwake())
+			cloth->Update(clothInNetwork[i] ? substepDeltaTime : deltaTime, clothSubsteps[i]);
+		else
+			cloth->particlePool.ResetForces();
+	}
+
+	// The ropes follow the points they are attached to, so they go after the bodies
+	for (int i = 0; i < ropes.Size(); ++i)
+	{
+		if (!first && !ropeInNetwork[i]) continue;
+
+		Rope* rope = ropes[i];
+		if (rope->IsAwake())
+			rope->Update(ropeInNetwork[i] ? substepDeltaTime : deltaTime, ropeSubsteps[i]);
+		else
+			rope->particlePool.ResetForces();
+	}
+}
+
+// The awake bodies that are contiguous in the batch, take the same step and use its integrators
+// go through the SIMD kernel together
+void PhysicsSystem::UpdateRigidBodies(float deltaTime, int substep, int begin, int end)
+{
+	float substepDeltaTime = deltaTime / springSubsteps;
+	bool first = substep == 0;
+
+	int runBegin = 0, runEnd = 0; // Batch range of the bodies waiting for the kernel
+	float runDeltaTime = 0.f;
+
+	for (int i = begin; i < end; ++i)
+	{
+		if (!first && !bodyInNetwork[i]) continue;
+
+		RigidBody* body = rigidBodies[i];
+		float bodyDeltaTime = bodyInNetwork[i] ? substepDeltaTime : deltaTime;
+
+		if (!body->IsAwake())
+			body->ResetForces();
+		else if (!body->IsBatchIntegrated())
+			body->Update(bodyDeltaTime);
+		else
+		{
+			int index = rigidBodyBatch.GetIndex(body->GetHandle());
+			if (index != runEnd || bodyDeltaTime != runDeltaTime)
+			{
+				rigidBodyBatch.Integrate(runDeltaTime, runBegin, runEnd);
+				runBegin = index;
+				runDeltaTime = bodyDeltaTime;
+			}
+			runEnd = index + 1;
+		}
+	}
+
+	rigidBodyBatch.Integrate(runDeltaTime, runBegin, runEnd);
+}
+
+void PhysicsSystem::UpdateObjectsParallel(float deltaTime, int substep)
+{
+	float substepDeltaTime = deltaTime / springSubsteps;
+	bool first = substep == 0;
+
+	ApplySpringForcesParallel(substep);
+
+	if (first)
+		contactSolver.Solve(contacts, contactCache, deltaTime);
+
+	// Updates: every object only touches its own state, so all the chunks can run concurrently
+	std::vector<ThreadPool::Task> tasks;
+
+	float totalCost = RIGID_BODY_UPDATE_COST * rigidBodies.Size() + PARTICLE_UPDATE_COST * particles.Size();
+	for (int i = 0; i < cloths.Size(); ++i)
+		totalCost += GetUpdateCost(*cloths[i]) * clothSubsteps[i];
+	for (int i = 0; i < ropes.Size(); ++i)
+		totalCost += GetUpdateCost(*ropes[i]) * ropeSubsteps[i];
+
+	float targetCost = totalCost / (float)(4 * threadPool->GetNumThreads());
+	if (targetCost < PARTICLE_GRAIN_SIZE * PARTICLE_UPDATE_COST)
+		targetCost = PARTICLE_GRAIN_SIZE * PARTICLE_UPDATE_COST;
+
+	AddCostChunks(tasks, (int)rigidBodies.Size(),
+		[](int) { return RIGID_BODY_UPDATE_COST; },
+		targetCost,
+		[this, deltaTime, substep](int begin, int end) {
+			UpdateRigidBodies(deltaTime, substep, begin, end);
+		}
+	);
+
+	// The implicit springs couple all the free particles in a single system
+	if (implicitSprings)
+	{
+		tasks.push_back([this, substepDeltaTime]() {
+			IntegrateParticles(substepDeltaTime);
+		});
+	}
+
+	int particleChunk = (int)(targetCost / PARTICLE_UPDATE_COST);
+	for (int begin = 0; begin < particles.Size() && !implicitSprings; begin += particleChunk)
+	{
+		int end = std::min(begin + particleChunk, particles.Size());
+		tasks.push_back([this, substepDeltaTime, begin, end]() {
+			particles.Integrate(substepDeltaTime, begin, end);
+		});
+	}
+
+	// The springs of the cloths with a single substep were applied by color, the others apply
+	// them in each of their substeps
+	AddCostChunks(tasks, (int)cloths.Size(),
+		[this](int i) { return GetUpdateCost(*cloths[i]) * clothSubsteps[i]; },
+		targetCost,
+		[this, deltaTime, substepDeltaTime, first](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				if (!first && !clothInNetwork[i]) continue;
+
+				float clothDeltaTime = clothInNetwork[i] ? substepDeltaTime : deltaTime;
+
+				if (!cloths[i]->IsAwake())
+					cloths[i]->particlePool.ResetForces();
+				else if (clothSubsteps[i] > 1)
+					cloths[i]->Update(clothDeltaTime, clothSubsteps[i]);
+				else
+					cloths[i]->Integrate(clothDeltaTime);
+			}
+		}
+	);
+
+	threadPool->Run(tasks);
+
+	// The ropes follow the points they are attached to, so they run once the bodies are done.
+	// Several ropes may pull the same body, so their impulses are applied afterwards.
+	if (ropes.Size() == 0) return;
+
+	tasks.clear();
+	AddCostChunks(tasks, (int)ropes.Size(),
+		[this](int i) { return GetUpdateCost(*ropes[i]) * ropeSubsteps[i]; },
+		targetCost,
+		[this, deltaTime, substepDeltaTime, first](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				if (!first && !ropeInNetwork[i]) continue;
+
+				if (ropes[i]->IsAwake())
+					ropes[i]->Integrate(ropeInNetwork[i] ? substepDeltaTime : deltaTime, ropeSubsteps[i]);
+				else
+					ropes[i]->particlePool.ResetForces();
+			}
+		}
+	);
+
+	threadPool->Run(tasks);
+
+	for (int i = 0; i < ropes.Size(); ++i)
+		if ((first || ropeInNetwork[i]) && ropes[i]->IsAwake())
+			ropes[i]->ApplyAttachmentImpulses();
+}
+
+void PhysicsSystem::ApplySpringForcesParallel(int substep)
+{
+	std::vector<ThreadPool::Task> tasks;
+
+	// Springs of the same color never share an object, so a color can run without atomics.
+	// The colors run one after the other because different colors do share objects.
+	if (springColoring.IsDirty())
+		springColoring.Build(springs.GetItems());
+
+	for (int color = 0; color < springColoring.GetNumColors(); ++color)
+	{
+		const std::vector<int>& indices = springColoring.GetColor(color);
+		for (int begin = 0; begin < indices.size(); begin += SPRING_GRAIN_SIZE)
+		{
+			int end = std::min(begin + SPRING_GRAIN_SIZE, (int)indices.size());
+			tasks.push_back([this, &indices, begin, end]() {
+				for (int i = begin; i < end; ++i)
+					if (IsSpringAwake(*springs[indices[i]]) && !IsImplicitSpring(*springs[indices[i]]))
+						springs[indices[i]]->applyForce();
+			});
+		}
+		threadPool->Run(tasks);
+		tasks.clear();
+	}
+
+	// The springs of the system may be attached to cloth particles, so the cloths go after them.
+	// The cloths are independent of each other, so the same color of every cloth runs at once.
+	int numColors = 0;
+	for (Cloth* cloth : cloths)
+		numColors = std::max(numColors, cloth->GetNumSpringColors());
+
+	for (int color = 0; color < numColors; ++color)
+	{
+		for (int i = 0; i < cloths.Size(); ++i)
+		{
+			Cloth* cloth = cloths[i];
+			if (color >= cloth->GetNumSpringColors() || !cloth->IsAwake() || cloth->GetSolver() != SPRING_CLOTH_SOLVER) continue;
+
+			// Only the cloths that take a single step now, the substepped ones apply their own springs
+			if (clothSubsteps[i] > 1 || (substep > 0 && !clothInNetwork[i])) continue;
+
+			int numSprings = cloth->GetNumSprings(color);
+			for (int begin = 0; begin < numSprings; begin += SPRING_GRAIN_SIZE)
+			{
+				int end = std::min(begin + SPRING_GRAIN_SIZE, numSprings);
+				tasks.push_back([cloth, color, begin, end]() {
+					cloth->ApplySpringForces(color, begin, end);
+				});
+			}
+		}
+		threadPool->Run(tasks);
+		tasks.clear();
+	}
+}
+
+void PhysicsSystem::UpdateBroadphase()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < rigidBodies.Size(); ++i)
+	{
+		RigidBody* body = rigidBodies[i];
+		int& proxy = rigidBodyProxies[i];
+
+		// The collider may have been set or cleared after adding the body
+		if (proxy == -1)
+		{
+			if (body->HasCollider())
+				proxy = broadphase->AddProxy(body->GetBounds(), body);
+		}
+		else if (!body->HasCollider())
+		{
+			broadphase->RemoveProxy(proxy);
+			proxy = -1;
+		}
+		else broadphase->MoveProxy(proxy, body->GetBounds());
+	}
+
+	auto updated = std::chrono::steady_clock::now();
+
+	broadphase->FindPairs(collisionPairs);
+
+	auto end = std::chrono::steady_clock::now();
+
+	broadphaseStats.numProxies = broadphase->GetNumProxies();
+	broadphaseStats.numPairs = (int)collisionPairs.size();
+	broadphaseStats.updateTime = std::chrono::duration<float, std::milli>(updated - start).count();
+	broadphaseStats.findPairsTime = std::chrono::duration<float, std::milli>(end - updated).count();
+}
+
+void PhysicsSystem::UpdateNarrowphase()
+{
+	contacts.clear();
+	nextContactCache.clear();
+
+	if (connectedBodiesDirty)
+		UpdateConnectedBodies();
+
+	// Sleeping contacts are kept until one of their bodies wakes up, then they are found again
+	sleepingContacts.erase(
+		std::remove_if(sleepingContacts.begin(), sleepingContacts.end(), [](const ContactManifold& manifold) {
+			return manifold.body1->IsAwake() || (manifold.body2 != nullptr && manifold.body2->IsAwake());
+		}),
+		sleepingContacts.end()
+	);
+
+	for (const ContactManifold& manifold : sleepingContacts)
+	{
+		ContactKey key(manifold.body1, manifold.body2, manifold.plane);
+		auto cached = contactCache.find(key);
+		if (cached != contactCache.end())
+			nextContactCache[key] = cached->second;
+	}
+
+	ContactManifold manifold;
+
+	for (const BroadphasePair& pair : collisionPairs)
+	{
+		// Same order every frame so the pair keeps its cache entry
+		RigidBody* body1 = pair.body1;
+		RigidBody* body2 = pair.body2;
+		if (std::less<RigidBody*>()(body2, body1))
+			std::swap(body1, body2);
+
+		ContactKey key(body1, body2, -1);
+		if (connectedBodies.count(key)) continue;
+
+		if (!body1->IsAwake() && !body2->IsAwake()) continue;
+
+		auto cached = contactCache.find(key);
+		ContactCacheEntry entry = cached != contactCache.end() ? cached->second : ContactCacheEntry();
+
+		if (FindContacts(*body1, *body2, &manifold, &entry.satAxis))
+			contacts.push_back(manifold);
+		else
+			entry.numContacts = 0; // Nothing to warm start when they touch again
+
+		nextContactCache[key] = entry;
+	}
+
+	for (int i = 0; i < rigidBodies.Size(); ++i)
+	{
+		if (rigidBodyProxies[i] == -1 || !rigidBodies[i]->IsAwake()) continue;
+
+		for (int p = 0; p < planes.size(); ++p)
+		{
+			if (FindContacts(*rigidBodies[i], planes[p], &manifold))
+			{
+				manifold.plane = p;
+				contacts.push_back(manifold);
+
+				ContactKey key(rigidBodies[i], nullptr, p);
+				auto cached = contactCache.find(key);
+				nextContactCache[key] = cached != contactCache.end() ? cached->second : ContactCacheEntry();
+			}
+		}
+	}
+
+	// Pairs that are no longer close are dropped
+	contactCache.swap(nextContactCache);
+}
+
+void PhysicsSystem::UpdateIslands()
+{
+	if (!sleeping) return;
+
+	int numBodies = (int)rigidBodies.Size();
+	int numParticles = particles.Size();
+	int clothOffset = numBodies + numParticles;
+	int ropeOffset = clothOffset + (int)cloths.Size();
+	int numNodes = ropeOffset + (int)ropes.Size();
+
+	islands.Reset(numNodes);
+	islandAwake.assign(numNodes, 0);
+	islandRestingFrames.assign(numNodes, INT_MAX);
+
+	for (int i = 0; i < numBodies; ++i)
+		islandAwake[i] = rigidBodies[i]->IsAwake() ? 1 : 0;
+
+	for (int i = 0; i < numParticles; ++i)
+		islandAwake[numBodies + i] = particles.awake[i] & (particles.fixed[i] ^ 1);
+
+	for (int c = 0; c < cloths.Size(); ++c)
+	{
+		const Cloth* cloth = cloths[c];
+
+		// A sleeping cloth wakes up when any of its particles is moved or pushed
+		bool awake = cloth->IsAwake();
+		const std::vector<unsigned char>& particleAwake = cloth->particlePool.awake;
+		for (int i = 0; !awake && i < particleAwake.size(); ++i)
+			awake = particleAwake[i] != 0;
+		islandAwake[clothOffset + c] = awake ? 1 : 0;
+	}
+
+	for (int r = 0; r < ropes.Size(); ++r)
+	{
+		const Rope* rope = ropes[r];
+
+		bool awake = rope->IsAwake();
+		const std::vector<unsigned char>& particleAwake = rope->particlePool.awake;
+		for (int i = 0; !awake && i < particleAwake.size(); ++i)
+			awake = particleAwake[i] != 0;
+		islandAwake[ropeOffset + r] = awake ? 1 : 0;
+
+		// A rope joins the points it is attached to, as a spring
+		for (int end = ROPE_START; end <= ROPE_END; ++end)
+		{
+			if (rope->GetAttachment(end) == nullptr) continue;
+
+			bool moved;
+			int node = GetIslandNode(rope->GetAttachment(end), moved);
+			if (node != -1)
+				islands.Union(ropeOffset + r, node);
+			else if (moved)
+				islandAwake[ropeOffset + r] = 1;
+		}
+	}
+
+	// Springs join their ends. Static ends do not join anything, but moving them by hand (the
+	// cursor) wakes up the other end.
+	for (const Spring* spring : springs)
+	{
+		bool moved1, moved2;
+		int node1 = GetIslandNode(spring->p1, moved1);
+		int node2 = GetIslandNode(spring->p2, moved2);
+
+		if (node1 != -1 && node2 != -1)
+			islands.Union(node1, node2);
+		else if (node1 != -1 && moved2)
+			islandAwake[node1] = 1;
+		else if (node2 != -1 && moved1)
+			islandAwake[node2] = 1;
+	}
+
+	// So do the contacts between bodies, the planes are static
+	for (const ContactManifold& manifold : contacts)
+		if (manifold.body2 != nullptr)
+			islands.Union(GetRigidBodyIndex(manifold.body1), GetRigidBodyIndex(manifold.body2));
+
+	for (const ContactManifold& manifold : sleepingContacts)
+		if (manifold.body2 != nullptr)
+			islands.Union(GetRigidBodyIndex(manifold.body1), GetRigidBodyIndex(manifold.body2));
+
+	// And the cloths with the bodies they touched
+	for (const std::pair<const Cloth*, const RigidBody*>& contact : clothBodyContacts)
+		islands.Union(clothOffset + cloths.GetIndex(handles.at(contact.first)), GetRigidBodyIndex(contact.second));
+
+	// Count the resting frames of the awake nodes. A node that is being woken up counts as 0,
+	// so it takes its island with it.
+	for (int node = 0; node < numNodes; ++node)
+	{
+		int frames = 0;
+
+		if (node < numBodies)
+		{
+			RigidBody* body = rigidBodies[node];
+			if (body->IsAwake())
+			{
+				frames = body->GetKineticEnergy() < sleepEnergy * body->GetMass() ? body->GetRestingFrames() + 1 : 0;
+				body->SetRestingFrames(frames);
+			}
+		}
+		else if (node < clothOffset)
+		{
+			int i = node - numBodies;
+			if (particles.fixed[i]) continue; // Static, not part of any island
+
+			if (particles.awake[i])
+			{
+				frames = 0.5f * glm::length2(particles.velocities[i]) < sleepEnergy ? particles.restingFrames[i] + 1 : 0;
+				particles.restingFrames[i] = frames;
+			}
+		}
+		else if (node < ropeOffset)
+		{
+			Cloth* cloth = cloths[node - clothOffset];
+			if (cloth->IsAwake())
+			{
+				frames = cloth->GetKineticEnergy() <= sleepEnergy * cloth->GetMass() ? cloth->GetRestingFrames() + 1 : 0;
+				cloth->SetRestingFrames(frames);
+			}
+		}
+		else
+		{
+			Rope* rope = ropes[node - ropeOffset];
+			if (rope->IsAwake())
+			{
+				frames = rope->GetKineticEnergy() <= sleepEnergy * rope->GetMass() ? rope->GetRestingFrames() + 1 : 0;
+				rope->SetRestingFrames(frames);
+			}
+		}
+
+		int root = islands.Find(node);
+		islandAwake[root] |= islandAwake[node];
+		islandRestingFrames[root] = std::min(islandRestingFrames[root], frames);
+	}
+
+	// Awake islands that rested long enough go to sleep, the others wake up all their nodes.
+	// Sleeping islands that nothing touched stay as they are.
+	numIslands = 0;
+	numSleepingIslands = 0;
+
+	for (int node = 0; node < numNodes; ++node)
+	{
+		if (node >= numBodies && node < clothOffset && particles.fixed[node - numBodies])
+		{
+			particles.awake[node - numBodies] = 0; // Moving it only wakes up its neighbours once
+			continue;
+		}
+
+		int root = islands.Find(node);
+		bool awake = islandAwake[root] && islandRestingFrames[root] < sleepFrames;
+
+		if (islandAwake[root])
+			SetNodeAwake(node, awake);
+
+		if (node == root)
+		{
+			numIslands++;
+			if (!awake) numSleepingIslands++;
+		}
+	}
+
+	// The solver only sees the contacts of awake islands
+	auto isAsleep = [](const ContactManifold& manifold) {
+		return !manifold.body1->IsAwake() && (manifold.body2 == nullptr || !manifold.body2->IsAwake());
+	};
+
+	for (int i = 0; i < sleepingContacts.size();)
+	{
+		if (isAsleep(sleepingContacts[i])) { ++i; continue; }
+		contacts.push_back(sleepingContacts[i]);
+		sleepingContacts[i] = sleepingContacts.back();
+		sleepingContacts.pop_back();
+	}
+
+	for (int i = 0; i < contacts.size();)
+	{
+		if (!isAsleep(contacts[i])) { ++i; continue; }
+		sleepingContacts.push_back(contacts[i]);
+		contacts[i] = contacts.back();
+		contacts.pop_back();
+	}
+}
+
+int PhysicsSystem::GetIslandNode(const ApplicationPoint* point, bool& moved) const
+{
+	moved = false;
+
+	switch (point->GetType())
+	{
+	case PARTICLE:
+	{
+		const Particle* particle = static_cast<const Particle*>(point);
+		if (particle->GetPool() == &particles)
+		{
+			int index = particles.GetIndex(particle->GetHandle());
+			if (particles.fixed[index])
+			{
+				moved = particles.awake[index] != 0;
+				return -1;
+			}
+			return (int)rigidBodies.Size() + index;
+		}
+
+		auto cloth = clothPools.find(particle->GetPool());
+		if (cloth != clothPools.end())
+			return (int)rigidBodies.Size() + particles.Size() + cloths.GetIndex(cloth->second);
+
+		auto rope = ropePools.find(particle->GetPool());
+		if (rope == ropePools.end()) return -1;
+		return (int)rigidBodies.Size() + particles.Size() + (int)cloths.Size() + ropes.GetIndex(rope->second);
+	}
+
+	case RIGID_BODY_POINT:
+		return GetRigidBodyIndex(static_cast<const RigidBodyPoint*>(point)->GetRigidBody());
+	}
+
+	return -1; // A plain application point never moves
+}
+
+void PhysicsSystem::SetNodeAwake(int node, bool awake)
+{
+	int numBodies = (int)rigidBodies.Size();
+	int clothOffset = numBodies + particles.Size();
+	int ropeOffset = clothOffset + (int)cloths.Size();
+
+	if (node < numBodies)
+	{
+		RigidBody* body = rigidBodies[node];
+		if (!awake || !body->IsAwake())
+			body->SetAwake(awake);
+	}
+	else if (node < clothOffset)
+	{
+		int i = node - numBodies;
+		if (!awake || !particles.awake[i])
+		{
+			particles.awake[i] = awake ? 1 : 0;
+			particles.restingFrames[i] = 0;
+			if (!awake)
+				particles.velocities[i] = glm::vec3(0.f);
+		}
+	}
+	else if (node < ropeOffset)
+	{
+		Cloth* cloth = cloths[node - clothOffset];
+		if (!awake || !cloth->IsAwake())
+			cloth->SetAwake(awake);
+	}
+	else
+	{
+		Rope* rope = ropes[node - ropeOffset];
+		if (!awake || !rope->IsAwake())
+			rope->SetAwake(awake);
+	}
+}
+
+static bool IsPointAwake(const ApplicationPoint* point)
+{
+	switch (point->GetType())
+	{
+	case PARTICLE:
+	{
+		const Particle* particle = static_cast<const Particle*>(point);
+		return particle->IsAwake() && !particle->IsFixed();
+	}
+
+	case RIGID_BODY_POINT:
+		return static_cast<const RigidBodyPoint*>(point)->GetRigidBody()->IsAwake();
+	}
+
+	return false;
+}
+
+bool PhysicsSystem::IsSpringAwake(const Spring& spring) const
+{
+	return IsPointAwake(spring.p1) || IsPointAwake(spring.p2);
+}
+
+void PhysicsSystem::WakeUp(ApplicationPoint* point)
+{
+	switch (point->GetType())
+	{
+	case PARTICLE:
+		static_cast<Particle*>(point)->WakeUp();
+		break;
+
+	case RIGID_BODY_POINT:
+		static_cast<RigidBodyPoint*>(point)->GetRigidBody()->SetAwake(true);
+		break;
+	}
+}
+
+void PhysicsSystem::SetSleeping(bool enabled)
+{
+	sleeping = enabled;
+	if (enabled) return;
+
+	for (RigidBody* body : rigidBodies)
+		if (!body->IsAwake())
+			body->SetAwake(true);
+
+	for (int i = 0; i < particles.Size(); ++i)
+		particles.awake[i] = 1;
+
+	for (Cloth* cloth : cloths)
+		if (!cloth->IsAwake())
+			cloth->SetAwake(true);
+
+	for (Rope* rope : ropes)
+		if (!rope->IsAwake())
+			rope->SetAwake(true);
+
+	numSleepingIslands = 0;
+}
+
+void PhysicsSystem::SetSleepThreshold(float energyPerMass, int frames)
+{
+	sleepEnergy = energyPerMass;
+	sleepFrames = frames > 0 ? frames : 1;
+}
+
+void PhysicsSystem::InvalidateSprings()
+{
+	springColoring.Invalidate();
+	connectedBodiesDirty = true;
+	implicitSpringsDirty = true;
+}
+
+bool PhysicsSystem::IsImplicitSpring(const Spring& spring) const
+{
+	return implicitSprings &&
+		spring.p1->GetType() == PARTICLE && static_cast<const Particle*>(spring.p1)->GetPool() == &particles &&
+		spring.p2->GetType() == PARTICLE && static_cast<const Particle*>(spring.p2)->GetPool() == &particles;
+}
+
+void PhysicsSystem::UpdateImplicitSprings()
+{
+	if (implicitSpringsDirty)
+	{
+		implicitSpringSet.Clear();
+		implicitSpringSources.clear();
+
+		for (Spring* spring : springs)
+		{
+			if (!IsImplicitSpring(*spring)) continue;
+
+			int index1 = particles.GetIndex(static_cast<const Particle*>(spring->p1)->GetHandle());
+			int index2 = particles.GetIndex(static_cast<const Particle*>(spring->p2)->GetHandle());
+			implicitSpringSet.Add(index1, index2, spring->k, spring->restingLength, spring->damping);
+			implicitSpringSources.push_back(spring);
+		}
+
+		implicitSpringSolver.Invalidate();
+		implicitSpringsDirty = false;
+		return;
+	}
+
+	// The parameters of the springs may change at any time
+	for (int i = 0; i < implicitSpringSet.Size(); ++i)
+	{
+		const Spring* spring = implicitSpringSources[i];
+		implicitSpringSet.constants[i] = spring->k;
+		implicitSpringSet.restingLengths[i] = spring->restingLength;
+		implicitSpringSet.dampings[i] = spring->damping;
+	}
+}
+
+void PhysicsSystem::IntegrateParticles(float deltaTime)
+{
+	if (!implicitSprings)
+	{
+		particles.Integrate(deltaTime);
+		return;
+	}
+
+	UpdateImplicitSprings();
+	implicitSpringSolver.Integrate(implicitSpringSet, particles, deltaTime);
+}
+
+void PhysicsSystem::SetImplicitSprings(bool enabled)
+{
+	implicitSprings = enabled;
+	implicitSpringsDirty = true;
+}
+
+void PhysicsSystem::UpdateConnectedBodies()
+{
+	connectedBodies.clear();
+
+	for (const Spring* spring : springs)
+	{
+		if (spring->p1->GetType() != RIGID_BODY_POINT || spring->p2->GetType() != RIGID_BODY_POINT) continue;
+
+		const RigidBody* body1 = static_cast<const RigidBodyPoint*>(spring->p1)->GetRigidBody();
+		const RigidBody* body2 = static_cast<const RigidBodyPoint*>(spring->p2)->GetRigidBody();
+		if (std::less<const RigidBody*>()(body2, body1))
+			std::swap(body1, body2);
+
+		connectedBodies.insert(ContactKey(body1, body2, -1));
+	}
+
+	connectedBodiesDirty = false;
+}
+
+void PhysicsSystem::SetContactIterations(int iterations)
+{
+	contactSolver.iterations = iterations > 0 ? iterations : 1;
+}
+
+bool PhysicsSystem::SetRigidBodyIntegrator(int translationIntegrator, int rotationIntegrator)
+{
+	// Checked first, so that the system is never left half switched
+	if (!RigidBody::IsValidIntegrator(translationIntegrator, rotationIntegrator))
 	{
-		springFutures.push_back(std::async(std::launch::async, [spring]() {
-			spring->applyForce();
-		}));
+		std::cout << "The integrators " << translationIntegrator << " (translation) and " << rotationIntegrator << " (rotation) are not valid." << std::endl;
+		return false;
 	}
 
-	for (std::future<void>& f : springFutures)
-		f.get();*/
-	for (Spring* spring : springs)
-		spring->applyForce();
+	rigidBodyTranslationIntegrator = translationIntegrator;
+	rigidBodyRotationIntegrator = rotationIntegrator;
 
-	// Updates
-	std::vector<std::future<void>> rigidBodyFutures;
 	for (RigidBody* body : rigidBodies)
-	{
-		rigidBodyFutures.push_back(std::async(std::launch::async, [body, deltaTime]() {
-			body->Update(deltaTime);
-		}));
-	}
-	for (std::future<void>& f : rigidBodyFutures)
-		f.get();
-	std::vector<std::future<void>> particleFutures;
-	for (Particle* particle : particles)
-	{
-		particleFutures.push_back(std::async(std::launch::async, [particle, deltaTime]() {
-			particle->Update(deltaTime);
-		}));
-	}
-	for (std::future<void>& f : particleFutures)
-		f.get();
-	std::vector<std::future<void>> clothFutures;
-	for (Cloth* cloth : cloths)
-	{
-		clothFutures.push_back(std::async(std::launch::async, [cloth, deltaTime]() {
-			cloth->Update(deltaTime);
-		}));
-	}
-	for (std::future<void>& f : clothFutures)
-		f.get();
+		body->SetIntegrator(translationIntegrator, rotationIntegrator);
+
+	return true;
 }
 
-#else // ASYNC
-void PhysicsSystem::Update(float deltaTime)
+void PhysicsSystem::AddPlane(const Plane& plane)
+{
+	planes.push_back(plane);
+}
+
+void PhysicsSystem::ClearPlanes()
+{
+	// The bodies resting on the planes have to fall
+	for (const ContactManifold& manifold : sleepingContacts)
+		if (manifold.body2 == nullptr)
+			manifold.body1->SetAwake(true);
+
+	planes.clear();
+	contacts.clear();
+}
+
+void PhysicsSystem::SetBroadphase(int type)
+{
+	Broadphase* newBroadphase = CreateBroadphase(type);
+	if (newBroadphase == nullptr) return;
+
+	delete broadphase;
+	broadphase = newBroadphase;
+
+	// The proxies are added again on the next update
+	for (int& proxy : rigidBodyProxies)
+		proxy = -1;
+	collisionPairs.clear();
+}
+
+float PhysicsSystem::GetUpdateCost(const Cloth& cloth)
+{
+	float cost = PARTICLE_UPDATE_COST * cloth.particles.size();
+
+	// Each iteration of the XPBD solver visits every constraint
+	if (cloth.GetSolver() == XPBD_CLOTH_SOLVER)
+		cost += PARTICLE_UPDATE_COST * cloth.GetSolverIterations() * (cloth.constraints.Size() + cloth.constraints.GetNumPins());
+
+	// Assembling the matrix and a few conjugate gradient iterations over it
+	if (cloth.GetSolver() == IMPLICIT_CLOTH_SOLVER)
+		cost += IMPLICIT_SPRING_COST * cloth.springs.Size();
+
+	return cost;
+}
+
+float PhysicsSystem::GetUpdateCost(const Rope& rope)
+{
+	// The prediction and a sweep of the chain per iteration
+	return PARTICLE_UPDATE_COST * rope.GetNumberOfParticles() * (1 + rope.GetSolverIterations());
+}
+
+void PhysicsSystem::SaveState()
 {
-	// Interactions
-	for (Spring* spring : springs)
-		spring->applyForce();
-	
-	// Updates
 	for (RigidBody* body : rigidBodies)
-		body->Update(deltaTime);
+		body->SaveState();
 
-	for (Particle* particle : particles)
-		particle->Update(deltaTime);
+	particles.SaveState();
 
 	for (Cloth* cloth : cloths)
-		cloth->Update(deltaTime);
+		cloth->particlePool.SaveState();
+
+	for (Rope* rope : ropes)
+		rope->particlePool.SaveState();
+}
+
+void PhysicsSystem::SetMultithreading(bool enabled, int numThreads)
+{
+	delete threadPool;
+	threadPool = nullptr;
+
+	if (enabled)
+		threadPool = new ThreadPool(numThreads);
+}
+
+bool PhysicsSystem::IsMultithreaded() const
+{
+	return threadPool != nullptr;
+}
+
+PhysicsSystem::PhysicsSystem() : broadphase(CreateBroadphase(SWEEP_AND_PRUNE_BROADPHASE)) {}
+
+PhysicsSystem::~PhysicsSystem()
+{
+	// Give the state back to the particles and bodies so they do not point to a destroyed pool
+	particles.Clear();
+	rigidBodyBatch.Clear();
+
+	delete threadPool;
+	delete broadphase;
 }
-#endif // ASYNC
 
 /*void PhysicsSystem::Render(Shader& shader, const char* uniformName)
 {
@@ -81,6 +972,8 @@ void PhysicsSystem::Update(float deltaTime)
 
 bool PhysicsSystem::AddObject(PhysicsObject* object)
 {
+	if (object == nullptr) return false;
+
 	switch (object->GetType())
 	{
 	case RIGID_BODY:
@@ -92,6 +985,9 @@ bool PhysicsSystem::AddObject(PhysicsObject* object)
 	case CLOTH:
 		return AddObject(*ToCloth(object));
 
+	case ROPE:
+		return AddObject(*ToRope(object));
+
 	case SPRING:
 		return AddObject(*ToSpring(object));
 
@@ -105,13 +1001,24 @@ bool PhysicsSystem::AddObject(PhysicsObject* object)
 
 bool PhysicsSystem::AddObject(RigidBody& body)
 {
-	if (std::find(rigidBodies.begin(), rigidBodies.end(), &body) != rigidBodies.end())
+	if (handles.count(&body))
+	{
+		std::cout << "The rigid body number " << rigidBodies.Size() << " already exists." << std::endl;
+		return false;
+	}
+
+	if (body.GetBatch() != nullptr)
 	{
-		std::cout << "The rigid body number " << rigidBodies.size() << " already exists." << std::endl;
+		std::cout << "The rigid body already belongs to another physics system." << std::endl;
 		return false;
 	}
 
-	rigidBodies.push_back(&body);
+	body.SetAwake(true);
+	// The integrators of the system replace the ones of the body, which can still change them afterwards
+	body.SetIntegrator(rigidBodyTranslationIntegrator, rigidBodyRotationIntegrator);
+	handles[&body] = rigidBodies.Add(&body);
+	rigidBodyBatch.Add(&body); // Same dense order as rigidBodies
+	rigidBodyProxies.push_back(body.HasCollider() ? broadphase->AddProxy(body.GetBounds(), &body) : -1);
 	return true;
 }
 
@@ -119,11 +1026,18 @@ bool PhysicsSystem::AddObject(Particle& particle)
 {
 	if (HasParticle(&particle))
 	{
-		std::cout << "The particle number " << particles.size() << " already exists." << std::endl;
+		std::cout << "The particle number " << particles.Size() << " already exists." << std::endl;
+		return false;
+	}
+
+	if (particle.GetPool() != nullptr)
+	{
+		std::cout << "The particle already belongs to another physics object." << std::endl;
 		return false;
 	}
 
-	particles.push_back(&particle);
+	particles.Add(&particle);
+	implicitSpringsDirty = true;
 	return true;
 }
 
@@ -137,51 +1051,80 @@ bool PhysicsSystem::AddObject(Spring& spring)
 
 	//std::cout << "Added spring: " << &spring << std::endl;
 
-	springs.push_back(&spring);
+	if (handles.count(&spring))
+	{
+		std::cout << "The spring number " << springs.Size() << " already exists." << std::endl;
+		return false;
+	}
+
+	handles[&spring] = springs.Add(&spring);
+	LinkSpring(&spring);
+	InvalidateSprings();
+
+	WakeUp(spring.p1);
+	WakeUp(spring.p2);
 	return true;
 }
 
 bool PhysicsSystem::AddObject(Cloth& cloth)
 {
-	if (std::find(cloths.begin(), cloths.end(), &cloth) != cloths.end())
+	if (handles.count(&cloth))
 	{
-		std::cout << "The cloth number " << cloths.size() << " already exists." << std::endl;
+		std::cout << "The cloth number " << cloths.Size() << " already exists." << std::endl;
 		return false;
 	}
 
-	for (Particle& particle : cloth.particles)
+	// The particles of a cloth live in its own pool, so none of them can be in the system yet
+
+	cloth.SetAwake(true);
+	SlotHandle handle = cloths.Add(&cloth);
+	handles[&cloth] = handle;
+	clothPools[&cloth.particlePool] = handle;
+	return true;
+}
+
+bool PhysicsSystem::AddObject(Rope& rope)
+{
+	if (handles.count(&rope))
 	{
-		if (HasParticle(&particle))
-		{
-			std::cout << "A particle in the cloth already exists in the physics system." << std::endl;
-			return false;
-		}
+		std::cout << "The rope number " << ropes.Size() << " already exists." << std::endl;
+		return false;
 	}
 
-	cloths.push_back(&cloth);
+	rope.SetAwake(true);
+	SlotHandle handle = ropes.Add(&rope);
+	handles[&rope] = handle;
+	ropePools[&rope.particlePool] = handle;
 	return true;
 }
 
 void PhysicsSystem::RemoveObject(PhysicsObject* object)
 {
-	RigidBody* rigidBody = dynamic_cast<RigidBody*>(object);
-	if (rigidBody != nullptr)
+	if (object == nullptr) return;
+
+	switch (object->GetType())
 	{
-		RemoveObject(*rigidBody);
+	case RIGID_BODY:
+		RemoveObject(*ToRigidBody(object));
 		return;
-	}
 
-	Particle* particle = dynamic_cast<Particle*>(object);
-	if (particle != nullptr)
-	{
-		RemoveObject(*particle);
+	case PARTICLE:
+		RemoveObject(*ToParticle(object));
 		return;
-	}
 
-	Spring* spring = dynamic_cast<Spring*>(object);
-	if (spring != nullptr)
-	{
-		RemoveObject(*spring);
+	case CLOTH:
+		RemoveObject(*ToCloth(object));
+		return;
+
+	case ROPE:
+		RemoveObject(*ToRope(object));
+		return;
+
+	case SPRING:
+		RemoveObject(*ToSpring(object));
+		return;
+
+	case APPLICATION_POINT: case RIGID_BODY_POINT:
 		return;
 	}
 
@@ -190,53 +1133,212 @@ void PhysicsSystem::RemoveObject(PhysicsObject* object)
 
 void PhysicsSystem::RemoveObject(const RigidBody& body)
 {
-	auto ref = std::find(rigidBodies.begin(), rigidBodies.end(), &body);
-	if (ref == rigidBodies.end()) return;
-	rigidBodies.erase(ref);
-}
+	auto ref = handles.find(&body);
+	if (ref == handles.end()) return;
 
-void PhysicsSystem::RemoveObject(const Particle& particle)
-{
-	auto ref = std::find(particles.begin(), particles.end(), &particle);
-	if (ref == particles.end()) return;
-	particles.erase(ref);
+	int index = rigidBodies.GetIndex(ref->second);
+	if (rigidBodyProxies[index] != -1)
+		broadphase->RemoveProxy(rigidBodyProxies[index]);
 
+	// The proxies follow the swap and pop of the slot map
+	rigidBodyProxies[index] = rigidBodyProxies.back();
+	rigidBodyProxies.pop_back();
+	rigidBodies.Remove(ref->second);
+	rigidBodyBatch.Remove(body.GetHandle());
+	handles.erase(ref);
 
-	for (auto it = springs.begin(); it < springs.end(); it++)
+	// Do not hand out pairs or contacts with a removed body, and wake up the bodies touching it
+	collisionPairs.clear();
+	contacts.clear();
+	for (auto it = contactCache.begin(); it != contactCache.end();)
 	{
-		if (
-			dynamic_cast<Particle*>((*it)->p1) == &particle || 
-			dynamic_cast<Particle*>((*it)->p2) == &particle
-		)
+		if (it->first.body1 == &body || it->first.body2 == &body)
 		{
-			//springs.erase(it);
-			//it--;
-			RemoveObject(**it);
+			RigidBody* other = const_cast<RigidBody*>(it->first.body1 == &body ? it->first.body2 : it->first.body1);
+			if (other != nullptr)
+				other->SetAwake(true);
+			it = contactCache.erase(it);
 		}
+		else
+			++it;
 	}
+
+	sleepingContacts.erase(
+		std::remove_if(sleepingContacts.begin(), sleepingContacts.end(), [&body](const ContactManifold& manifold) {
+			return manifold.body1 == &body || manifold.body2 == &body;
+		}),
+		sleepingContacts.end()
+	);
+
+	// The cloths resting on it have to fall
+	for (const std::pair<const Cloth*, const RigidBody*>& contact : clothBodyContacts)
+		if (contact.second == &body)
+			const_cast<Cloth*>(contact.first)->SetAwake(true);
+
+	clothBodyContacts.erase(
+		std::remove_if(clothBodyContacts.begin(), clothBodyContacts.end(), [&body](const std::pair<const Cloth*, const RigidBody*>& contact) {
+			return contact.second == &body;
+		}),
+		clothBodyContacts.end()
+	);
+}
+
+void PhysicsSystem::RemoveObject(const Particle& particle)
+{
+	if (particle.GetPool() != &particles) return;
+	particles.Remove(particle.GetHandle());
+	implicitSpringsDirty = true; // The indices of the pool changed
+
+	// The springs attached to the particle go with it
+	auto attached = pointSprings.find(&particle);
+	if (attached == pointSprings.end()) return;
+
+	std::vector<Spring*> attachedSprings = attached->second;
+	for (Spring* spring : attachedSprings)
+		RemoveObject(*spring);
 }
 
 void PhysicsSystem::RemoveObject(const Spring& spring)
 {
-	auto ref = std::find(springs.begin(), springs.end(), &spring);
-	if (ref == springs.end()) return;
-	springs.erase(ref);
+	auto ref = handles.find(&spring);
+	if (ref == handles.end()) return;
+
+	springs.Remove(ref->second);
+	handles.erase(ref);
+	UnlinkSpring(const_cast<Spring*>(&spring));
+	InvalidateSprings();
+
+	WakeUp(spring.p1);
+	WakeUp(spring.p2);
 }
 
 void PhysicsSystem::RemoveObject(const Cloth& cloth)
 {
-	auto ref = std::find(cloths.begin(), cloths.end(), &cloth);
-	if (ref == cloths.end()) return;
-	cloths.erase(ref);
+	auto ref = handles.find(&cloth);
+	if (ref == handles.end()) return;
+
+	cloths.Remove(ref->second);
+	handles.erase(ref);
+	clothPools.erase(&cloth.particlePool);
+
+	clothBodyContacts.erase(
+		std::remove_if(clothBodyContacts.begin(), clothBodyContacts.end(), [&cloth](const std::pair<const Cloth*, const RigidBody*>& contact) {
+			return contact.first == &cloth;
+		}),
+		clothBodyContacts.end()
+	);
+
+	for (const Particle& particle : cloth.particles)
+	{
+		auto attached = pointSprings.find(&particle);
+		if (attached == pointSprings.end()) continue;
+
+		std::vector<Spring*> attachedSprings = attached->second;
+		for (Spring* spring : attachedSprings)
+			RemoveObject(*spring);
+	}
+}
+
+void PhysicsSystem::RemoveObject(const Rope& rope)
+{
+	auto ref = handles.find(&rope);
+	if (ref == handles.end()) return;
+
+	ropes.Remove(ref->second);
+	handles.erase(ref);
+	ropePools.erase(&rope.particlePool);
+
+	// What hung from the rope has to fall
+	for (int end = ROPE_START; end <= ROPE_END; ++end)
+		if (rope.GetAttachment(end) != nullptr)
+			WakeUp(rope.GetAttachment(end));
+
+	for (const Particle& particle : rope.particles)
+	{
+		auto attached = pointSprings.find(&particle);
+		if (attached == pointSprings.end()) continue;
+
+		std::vector<Spring*> attachedSprings = attached->second;
+		for (Spring* spring : attachedSprings)
+			RemoveObject(*spring);
+	}
+}
+
+void PhysicsSystem::LinkSpring(Spring* spring)
+{
+	pointSprings[spring->p1].push_back(spring);
+	if (spring->p2 != spring->p1)
+		pointSprings[spring->p2].push_back(spring);
+}
 
-	for (auto it = springs.begin(); it < springs.end(); it ++)
+void PhysicsSystem::UnlinkSpring(Spring* spring)
+{
+	const ApplicationPoint* points[2] = { spring->p1, spring->p2 };
+	for (const ApplicationPoint* point : points)
 	{
-		if (cloth.HasParticle(dynamic_cast<Particle*>((*it)->p1)) || cloth.HasParticle(dynamic_cast<Particle*>((*it)->p2)))
+		auto attached = pointSprings.find(point);
+		if (attached == pointSprings.end()) continue;
+
+		std::vector<Spring*>& attachedSprings = attached->second;
+		auto it = std::find(attachedSprings.begin(), attachedSprings.end(), spring);
+		if (it != attachedSprings.end())
 		{
-			springs.erase(it);
-			it--;
+			*it = attachedSprings.back();
+			attachedSprings.pop_back();
 		}
+
+		if (attachedSprings.empty())
+			pointSprings.erase(attached);
+	}
+}
+
+int PhysicsSystem::GetRigidBodyIndex(const RigidBody* body) const
+{
+	auto ref = handles.find(body);
+	return ref != handles.end() ? (int)rigidBodies.GetIndex(ref->second) : -1;
+}
+
+SlotHandle PhysicsSystem::GetHandle(const PhysicsObject* object) const
+{
+	if (object == nullptr) return SlotHandle();
+
+	const void* key = nullptr;
+	switch (object->GetType())
+	{
+	case PARTICLE:
+	{
+		const Particle* particle = static_cast<const Particle*>(object);
+		return particle->GetPool() == &particles ? particle->GetHandle() : SlotHandle();
+	}
+
+	case RIGID_BODY: key = static_cast<const RigidBody*>(object); break;
+	case SPRING: key = static_cast<const Spring*>(object); break;
+	case CLOTH: key = static_cast<const Cloth*>(object); break;
+	case ROPE: key = static_cast<const Rope*>(object); break;
 	}
+
+	auto ref = handles.find(key);
+	return ref != handles.end() ? ref->second : SlotHandle();
+}
+
+RigidBody* PhysicsSystem::GetRigidBody(SlotHandle handle) const
+{
+	return rigidBodies.IsValid(handle) ? rigidBodies.Get(handle) : nullptr;
+}
+
+Spring* PhysicsSystem::GetSpring(SlotHandle handle) const
+{
+	return springs.IsValid(handle) ? springs.Get(handle) : nullptr;
+}
+
+Cloth* PhysicsSystem::GetCloth(SlotHandle handle) const
+{
+	return cloths.IsValid(handle) ? cloths.Get(handle) : nullptr;
+}
+
+Rope* PhysicsSystem::GetRope(SlotHandle handle) const
+{
+	return ropes.IsValid(handle) ? ropes.Get(handle) : nullptr;
 }
 
 bool PhysicsSystem::HasParticle(const ApplicationPoint* point) const
@@ -248,29 +1350,18 @@ bool PhysicsSystem::HasParticle(const ApplicationPoint* point) const
 		const RigidBodyPoint* rbp = dynamic_cast<const RigidBodyPoint*>(point);
 		if (rbp == nullptr) return false;
 
-		for (const RigidBody* body : rigidBodies)
-		{
-			if (rbp->GetRigidBody() == body)
-				return true;
-		}
-
-		break;
+		return handles.count(rbp->GetRigidBody()) != 0;
 	}
 
 	case PARTICLE:
 	{
 
 		const Particle* particle = dynamic_cast<const Particle*>(point);
+		if (particle == nullptr) return false;
 
-		if (std::find(particles.begin(), particles.end(), particle) != particles.end()) return true;
-		
-		for (Cloth* cloth : cloths)
-		{
-			if (cloth->HasParticle(particle))
-				return true;
-		}
-		
-		break;
+		if (particle->GetPool() == &particles) return true;
+
+		return clothPools.count(particle->GetPool()) != 0 || ropePools.count(particle->GetPool()) != 0;
 	}
 
 	case APPLICATION_POINT:
@@ -290,10 +1381,252 @@ bool PhysicsSystem::HasParticle(const ApplicationPoint* point) const
 
 void PhysicsSystem::ClearObjects()
 {
-	rigidBodies.clear();
+	for (int proxy : rigidBodyProxies)
+	{
+		if (proxy != -1)
+			broadphase->RemoveProxy(proxy);
+	}
+
+	rigidBodies.Clear();
+	rigidBodyBatch.Clear();
+	rigidBodyProxies.clear();
+	collisionPairs.clear();
+	contacts.clear();
+	sleepingContacts.clear();
+	contactCache.clear();
+	clothBodyContacts.clear();
+	particles.Clear();
+	springs.Clear();
+	InvalidateSprings();
+	cloths.Clear();
+	ropes.Clear();
+	handles.clear();
+	clothPools.clear();
+	ropePools.clear();
+	pointSprings.clear();
 }
 
 //void PhysicsSystem::ClearConstraints()
 //{
 //	constraints.clear();
-//}
\ No newline at end of file
+//}
+
+// Inverse mass felt by a force at the point, 0 for the points that do not move
+static float GetPointInverseMass(const ApplicationPoint* point)
+{
+	switch (point->GetType())
+	{
+	case PARTICLE:
+	{
+		const Particle* particle = static_cast<const Particle*>(point);
+		return particle->IsFixed() ? 0.f : 1.f / particle->GetMass();
+	}
+
+	case RIGID_BODY_POINT:
+	{
+		// The rotation adds |r|^2 / I, bounded with the smallest moment of inertia
+		const RigidBody* body = static_cast<const RigidBodyPoint*>(point)->GetRigidBody();
+		glm::vec3 arm = point->GetPosition() - body->GetPosition();
+		float minInertia = std::min(body->GetI1(), std::min(body->GetI2(), body->GetI3()));
+		return body->GetInverseMass() + glm::length2(arm) / minInertia;
+	}
+	}
+
+	return 0.f;
+}
+
+static int GetSubsteps(float deltaTime, float stableTimeStep, int maxSubsteps)
+{
+	float limit = SUBSTEP_SAFETY * stableTimeStep;
+	if (deltaTime <= limit) return 1;
+	return std::min((int)ceilf(deltaTime / limit), maxSubsteps);
+}
+
+void PhysicsSystem::UpdateSubsteps(float deltaTime)
+{
+	springSubsteps = 1;
+	bodyInNetwork.assign(rigidBodies.Size(), 0);
+	clothInNetwork.assign(cloths.Size(), 0);
+	ropeInNetwork.assign(ropes.Size(), 0);
+
+	if (adaptiveSubsteps)
+	{
+		// Explicit springs are stable while h < 2 / (w + c). Each end of a spring bounds them with
+		// w^2 = 2 k / m and c = 2 d / m, where k and d add up all the springs attached to the point.
+		float stableTimeStep = FLT_MAX;
+		for (const Spring* spring : springs)
+		{
+			if (!IsSpringAwake(*spring) || IsImplicitSpring(*spring)) continue;
+
+			for (const ApplicationPoint* point : { spring->p1, spring->p2 })
+			{
+				float stiffness = 0.f;
+				float damping = 0.f;
+				for (const Spring* attached : pointSprings[point])
+				{
+					stiffness += attached->k;
+					damping += attached->damping;
+				}
+
+				float inverseMass = 2.f * GetPointInverseMass(point);
+				float frequency = sqrtf(stiffness * inverseMass) + damping * inverseMass;
+				if (frequency > 0.f)
+					stableTimeStep = std::min(stableTimeStep, 2.f / frequency);
+			}
+		}
+
+		springSubsteps = GetSubsteps(deltaTime, stableTimeStep, maxSubsteps);
+	}
+
+	// The bodies, cloths and ropes attached to the springs take their substeps
+	if (springSubsteps > 1)
+	{
+		for (const Spring* spring : springs)
+		{
+			if (!IsSpringAwake(*spring)) continue;
+
+			for (const ApplicationPoint* point : { spring->p1, spring->p2 })
+			{
+				if (point->GetType() == RIGID_BODY_POINT)
+				{
+					int index = GetRigidBodyIndex(static_cast<const RigidBodyPoint*>(point)->GetRigidBody());
+					if (index != -1) bodyInNetwork[index] = 1;
+				}
+				else if (point->GetType() == PARTICLE)
+				{
+					const ParticlePool* pool = static_cast<const Particle*>(point)->GetPool();
+
+					auto cloth = clothPools.find(pool);
+					if (cloth != clothPools.end()) clothInNetwork[cloths.GetIndex(cloth->second)] = 1;
+
+					auto rope = ropePools.find(pool);
+					if (rope != ropePools.end()) ropeInNetwork[ropes.GetIndex(rope->second)] = 1;
+				}
+			}
+		}
+	}
+
+	substepStats = SubstepStats();
+	substepStats.updates = 1;
+	substepStats.springSubsteps = springSubsteps;
+	substepStats.maxSpringSubsteps = springSubsteps;
+
+	clothSubsteps.assign(cloths.Size(), 1);
+	for (int i = 0; i < cloths.Size(); ++i)
+	{
+		const Cloth* cloth = cloths[i];
+		if (!cloth->IsAwake()) continue;
+
+		if (adaptiveSubsteps)
+		{
+			float clothDeltaTime = clothInNetwork[i] ? deltaTime / springSubsteps : deltaTime;
+			clothSubsteps[i] = GetSubsteps(clothDeltaTime, cloth->GetStableTimeStep(), maxSubsteps);
+		}
+
+		int steps = clothSubsteps[i] * (clothInNetwork[i] ? springSubsteps : 1);
+		substepStats.clothSubsteps += steps;
+		substepStats.maxClothSubsteps = std::max(substepStats.maxClothSubsteps, steps);
+	}
+
+	ropeSubsteps.assign(ropes.Size(), 1);
+	for (int i = 0; i < ropes.Size(); ++i)
+	{
+		const Rope* rope = ropes[i];
+		if (!rope->IsAwake()) continue;
+
+		if (adaptiveSubsteps)
+		{
+			float ropeDeltaTime = ropeInNetwork[i] ? deltaTime / springSubsteps : deltaTime;
+			ropeSubsteps[i] = GetSubsteps(ropeDeltaTime, rope->GetStableTimeStep(ropeDeltaTime), maxSubsteps);
+		}
+
+		int steps = ropeSubsteps[i] * (ropeInNetwork[i] ? springSubsteps : 1);
+		substepStats.ropeSubsteps += steps;
+		substepStats.maxRopeSubsteps = std::max(substepStats.maxRopeSubsteps, steps);
+	}
+}
+
+void PhysicsSystem::SaveExternalForces()
+{
+	savedForces.clear();
+
+	for (int i = 0; i < rigidBodies.Size(); ++i)
+	{
+		if (!bodyInNetwork[i]) continue;
+		savedForces.push_back(rigidBodies[i]->GetForce());
+		savedForces.push_back(rigidBodies[i]->GetTorque());
+	}
+
+	savedForces.insert(savedForces.end(), particles.forces.begin(), particles.forces.end());
+
+	for (int i = 0; i < cloths.Size(); ++i)
+		if (clothInNetwork[i])
+			savedForces.insert(savedForces.end(), cloths[i]->particlePool.forces.begin(), cloths[i]->particlePool.forces.end());
+
+	for (int i = 0; i < ropes.Size(); ++i)
+		if (ropeInNetwork[i])
+			savedForces.insert(savedForces.end(), ropes[i]->particlePool.forces.begin(), ropes[i]->particlePool.forces.end());
+}
+
+void PhysicsSystem::RestoreExternalForces()
+{
+	const glm::vec3* saved = savedForces.data();
+
+	for (int i = 0; i < rigidBodies.Size(); ++i)
+	{
+		if (!bodyInNetwork[i]) continue;
+
+		RigidBody* body = rigidBodies[i];
+		body->ResetForces();
+		if (body->IsAwake())
+		{
+			body->ApplyForce(saved[0], glm::vec3(0.f));
+			body->ApplyTorque(saved[1]);
+		}
+		saved += 2;
+	}
+
+	std::copy(saved, saved + particles.Size(), particles.forces.begin());
+	saved += particles.Size();
+
+	for (int i = 0; i < cloths.Size(); ++i)
+	{
+		if (!clothInNetwork[i]) continue;
+
+		std::vector<glm::vec3>& forces = cloths[i]->particlePool.forces;
+		std::copy(saved, saved + forces.size(), forces.begin());
+		saved += forces.size();
+	}
+
+	for (int i = 0; i < ropes.Size(); ++i)
+	{
+		if (!ropeInNetwork[i]) continue;
+
+		std::vector<glm::vec3>& forces = ropes[i]->particlePool.forces;
+		std::copy(saved, saved + forces.size(), forces.begin());
+		saved += forces.size();
+	}
+}
+
+void PhysicsSystem::SetAdaptiveSubsteps(bool enabled, int newMaxSubsteps)
+{
+	if (newMaxSubsteps < 1)
+	{
+		std::cout << "The maximum number of substeps must be at least 1." << std::endl;
+		return;
+	}
+
+	adaptiveSubsteps = enabled;
+	maxSubsteps = newMaxSubsteps;
+}
+
+void SubstepStats::Add(const SubstepStats& other)
+{
+	updates += other.updates;
+	springSubsteps += other.springSubsteps;
+	maxSpringSubsteps = std::max(maxSpringSubsteps, other.maxSpringSubsteps);
+	clothSubsteps += other.clothSubsteps;
+	maxClothSubsteps = std::max(maxClothSubsteps, other.maxClothSubsteps);
+	ropeSubsteps += other.ropeSubsteps;
+	maxRopeSubsteps = std::max(maxRopeSubsteps, other.maxRopeSubsteps);
+}
\ No newline at end of file
@@ -2,40 +2,247 @@
 
 #include "RigidBody.h"
 #include "Particle.h"
+#include "ParticlePool.h"
 #include "Spring.h"
 #include "Cloth.h"
+#include "Rope.h"
 #include "RigidBodyPoint.h"
 #include "Geometry3D.h"
+#include "ThreadPool.h"
+#include "SpringColoring.h"
+#include "Broadphase.h"
+#include "Narrowphase.h"
+#include "ContactSolver.h"
+#include "UnionFind.h"
+#include "SlotMap.h"
+#include "ImplicitSpringSolver.h"
+#include "ClothCollision.h"
+#include "Scene.h"
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#define DEFAULT_SLEEP_ENERGY 5E-3f // Kinetic energy per unit of mass (0.1 m/s)
+#define DEFAULT_SLEEP_FRAMES 60
+
+#define DEFAULT_MAX_SUBSTEPS 32
+#define SUBSTEP_SAFETY 0.5f // Fraction of the stable time step of the springs that is used
+
+// Substeps taken by the last update, or added over several updates (the engine reports a frame)
+struct SubstepStats
+{
+	int updates = 0;
+	int springSubsteps = 0; // Steps of the spring network (explicit springs of the system)
+	int maxSpringSubsteps = 0;
+	int clothSubsteps = 0; // Steps of every awake cloth
+	int maxClothSubsteps = 0;
+	int ropeSubsteps = 0; // Steps of every awake rope
+	int maxRopeSubsteps = 0;
+
+	void Add(const SubstepStats& other);
+};
 
 class PhysicsSystem
 {
 protected:
 	//std::vector<ApplicationPoint*> applicationPoints;
-	std::vector<RigidBody*> rigidBodies;
-	std::vector<Particle*> particles;
-	std::vector<Spring*> springs;
-	std::vector<Cloth*> cloths;
+	SlotMap<RigidBody*> rigidBodies;
+	RigidBodyBatch rigidBodyBatch; // State of the rigid bodies, which are views over it
+	std::vector<int> rigidBodyProxies; // Broadphase proxy of each dense rigid body, -1 if it has no collider
+	ParticlePool particles; // Free particles, stored as a structure of arrays
+	SlotMap<Spring*> springs;
+	SpringColoring springColoring; // Rebuilt on the next parallel update after adding or removing springs
+	SlotMap<Cloth*> cloths;
+	SlotMap<Rope*> ropes;
+
+	// Registry: handle of every rigid body, spring, cloth and rope, so that adding, removing and
+	// looking them up is O(1). The particles already have their handles in the pools.
+	std::unordered_map<const void*, SlotHandle> handles;
+	std::unordered_map<const ParticlePool*, SlotHandle> clothPools; // Cloth that owns each pool
+	std::unordered_map<const ParticlePool*, SlotHandle> ropePools; // Rope that owns each pool
+	std::unordered_map<const ApplicationPoint*, std::vector<Spring*>> pointSprings; // Springs attached to each point
 
 	//std::vector<OBB> constraints;
 
+	ThreadPool* threadPool = nullptr; // Only exists while multithreading is enabled
+
+	Broadphase* broadphase;
+	std::vector<BroadphasePair> collisionPairs; // Found by the last broadphase update
+	BroadphaseStats broadphaseStats;
+
+	std::vector<Plane> planes; // Static colliders
+	std::vector<ContactManifold> contacts; // Found by the last narrowphase update
+	std::vector<ContactManifold> sleepingContacts; // Contacts of sleeping islands, still valid since nothing moves
+	ContactCache contactCache, nextContactCache;
+
+	ContactSolver contactSolver;
+
+	// Integrators given to the rigid bodies, also to the ones added later
+	int rigidBodyTranslationIntegrator = RK4_INTEGRATOR;
+	int rigidBodyRotationIntegrator = RK4_INTEGRATOR;
+
+	// Pairs of bodies joined by a spring do not collide with each other
+	std::unordered_set<ContactKey, ContactKeyHash> connectedBodies;
+	bool connectedBodiesDirty = true;
+
+	// Islands: objects joined by springs or contacts. An island sleeps when all its objects have
+	// been resting for sleepFrames steps, and wakes up as a whole when any of them is disturbed.
+	bool sleeping = true;
+	float sleepEnergy = DEFAULT_SLEEP_ENERGY;
+	int sleepFrames = DEFAULT_SLEEP_FRAMES;
+
+	UnionFind islands; // Nodes: rigid bodies, then free particles, then cloths, then ropes (dense indices)
+	std::vector<unsigned char> islandAwake; // Per node, then per island root
+	std::vector<int> islandRestingFrames; // Per island root, the minimum of its nodes
+	int numIslands = 0;
+	int numSleepingIslands = 0;
+
+	// Springs between two free particles can be integrated implicitly together with the particles.
+	// The copy with pool indices is rebuilt when the springs or the particles change.
+	bool implicitSprings = false;
+	ClothSprings implicitSpringSet;
+	std::vector<Spring*> implicitSpringSources;
+	bool implicitSpringsDirty = true;
+	ImplicitSpringSolver implicitSpringSolver;
+
+	// Adaptive substepping: the explicit springs of the system with the objects attached to them,
+	// and each cloth with its own springs, take as many substeps as their stiffness requires. Each
+	// rope takes as many as it needs to bend. Everything else takes a single step.
+	bool adaptiveSubsteps = true;
+	int maxSubsteps = DEFAULT_MAX_SUBSTEPS;
+	int springSubsteps = 1;
+	std::vector<int> clothSubsteps; // Per dense cloth, within each step of the cloth
+	std::vector<int> ropeSubsteps; // Per dense rope, within each step of the rope
+	std::vector<unsigned char> bodyInNetwork; // Attached to a spring of the network, per dense body
+	std::vector<unsigned char> clothInNetwork;
+	std::vector<unsigned char> ropeInNetwork;
+	std::vector<glm::vec3> savedForces; // External forces of the network, applied again in every substep
+	SubstepStats substepStats;
+
+	// Cloths against the rigid bodies, the planes and the models of the static scene, once per
+	// update. A cloth and the bodies it touches form an island.
+	Scene* staticScene = nullptr;
+	std::vector<ClothContacts> clothContacts; // Per dense cloth
+	std::vector<RigidBody*> clothQueryBodies;
+	std::vector<std::pair<const Cloth*, const RigidBody*>> clothBodyContacts; // Of the last update
+	int numClothContacts = 0;
+
+	void InvalidateSprings(); // Call whenever the springs change
+	void LinkSpring(Spring* spring);
+	void UnlinkSpring(Spring* spring); // Removes it from the reverse index only
+	int GetRigidBodyIndex(const RigidBody* body) const; // -1 if it is not in the system
+	void UpdateConnectedBodies();
+
+	void UpdateBroadphase();
+	void UpdateNarrowphase();
+	void UpdateIslands();
+
+	int GetIslandNode(const ApplicationPoint* point, bool& moved) const; // -1 for static points
+	void SetNodeAwake(int node, bool awake);
+	bool IsSpringAwake(const Spring& spring) const;
+	void WakeUp(ApplicationPoint* point);
+
+	static float GetUpdateCost(const Cloth& cloth);
+	static float GetUpdateCost(const Rope& rope);
+
+	void ApplySpringForcesParallel(int substep);
+
+	void UpdateSubsteps(float deltaTime);
+	void SaveExternalForces();
+	void RestoreExternalForces();
+
+	// Substep 0 updates every object, the following ones only the spring network
+	void UpdateObjects(float deltaTime, int substep);
+	void UpdateObjectsParallel(float deltaTime, int substep);
+	void UpdateRigidBodies(float deltaTime, int substep, int begin, int end); // Dense range [begin, end)
+
+	bool IsImplicitSpring(const Spring& spring) const; // Joins two free particles and implicit springs are enabled
+	void UpdateImplicitSprings();
+	void IntegrateParticles(float deltaTime);
+
+	void UpdateClothCollisions();
+
 public:
+	PhysicsSystem();
+	~PhysicsSystem();
+
 	void Update(float deltaTime);
 
+	void SaveState(); // Stores the current state as the previous one for the render interpolation
+
+	void SetMultithreading(bool enabled, int numThreads = 0); // numThreads = 0 uses every hardware thread
+	bool IsMultithreaded() const;
+
+	void SetBroadphase(int type); // SWEEP_AND_PRUNE_BROADPHASE or AABB_TREE_BROADPHASE
+	inline int GetBroadphaseType() const { return broadphase->GetType(); }
+	inline const std::vector<BroadphasePair>& GetCollisionPairs() const { return collisionPairs; }
+	inline const BroadphaseStats& GetBroadphaseStats() const { return broadphaseStats; }
+	inline const std::vector<ContactManifold>& GetContacts() const { return contacts; }
+
+	inline ContactSolver& GetContactSolver() { return contactSolver; } // Iterations, friction...
+	void SetContactIterations(int iterations);
+
+	// Sets the integrators of every rigid body in the system and of the ones added afterwards
+	// (see RigidBody::SetIntegrator). Nothing changes if they are not valid.
+	bool SetRigidBodyIntegrator(int translationIntegrator, int rotationIntegrator);
+	inline int GetRigidBodyTranslationIntegrator() const { return rigidBodyTranslationIntegrator; }
+	inline int GetRigidBodyRotationIntegrator() const { return rigidBodyRotationIntegrator; }
+
+	// Integrates the springs between free particles with backward Euler (see ImplicitSpringSolver).
+	// Springs attached to rigid bodies or cloths are still explicit.
+	void SetImplicitSprings(bool enabled);
+	inline bool IsImplicitSpringsEnabled() const { return implicitSprings; }
+	inline ImplicitSpringSolver& GetImplicitSpringSolver() { return implicitSpringSolver; } // Iterations, tolerance...
+
+	void SetAdaptiveSubsteps(bool enabled, int maxSubsteps = DEFAULT_MAX_SUBSTEPS);
+	inline bool IsAdaptiveSubstepsEnabled() const { return adaptiveSubsteps; }
+	inline const SubstepStats& GetSubstepStats() const { return substepStats; } // Of the last update
+
+	void SetSleeping(bool enabled); // Disabling it wakes up everything
+	inline bool IsSleepingEnabled() const { return sleeping; }
+	void SetSleepThreshold(float energyPerMass, int frames);
+	inline int GetNumIslands() const { return numIslands; }
+	inline int GetNumSleepingIslands() const { return numSleepingIslands; }
+
+	// The models of the scene are static obstacles for the cloths, so it should only hold the
+	// models without a physics object
+	inline void SetStaticScene(Scene* scene) { staticScene = scene; }
+	inline Scene* GetStaticScene() const { return staticScene; }
+	inline int GetNumClothContacts() const { return numClothContacts; } // Particles in contact in the last update
+
+	void AddPlane(const Plane& plane); // Static plane, solid on the side opposite to its normal
+	void ClearPlanes();
+	inline const std::vector<Plane>& GetPlanes() const { return planes; }
+
 	bool AddObject(PhysicsObject* object);
 	bool AddObject(RigidBody& rigidBody);
 	bool AddObject(Particle& particle);
 	bool AddObject(Spring& spring);
 	bool AddObject(Cloth& cloth);
+	bool AddObject(Rope& rope);
 
 	void RemoveObject(PhysicsObject* object);
 	void RemoveObject(const RigidBody& rigidBody);
 	void RemoveObject(const Particle& particle);
 	void RemoveObject(const Spring& spring);
 	void RemoveObject(const Cloth& cloth);
+	void RemoveObject(const Rope& rope);
 
 	bool HasParticle(const ApplicationPoint* particle) const;
 
+	// Handles stay valid while the object is in the system, unlike the dense indices
+	SlotHandle GetHandle(const PhysicsObject* object) const; // Invalid handle if it is not in the system
+	RigidBody* GetRigidBody(SlotHandle handle) const; // nullptr for stale handles
+	Spring* GetSpring(SlotHandle handle) const;
+	Cloth* GetCloth(SlotHandle handle) const;
+	Rope* GetRope(SlotHandle handle) const;
+
+	inline int GetNumRigidBodies() const { return rigidBodies.Size(); }
+	inline int GetNumParticles() const { return particles.Size(); }
+	inline int GetNumSprings() const { return springs.Size(); }
+	inline int GetNumCloths() const { return cloths.Size(); }
+	inline int GetNumRopes() const { return ropes.Size(); }
+
 	//void AddConstraint(const OBB& constraint);
 
 	void ClearObjects();
@@ -0,0 +1,575 @@
+#include "RayPacket.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#if defined(__AVX__)
+#define RAY_PACKET_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAY_PACKET_SSE
+#include <emmintrin.h>
+#endif
+
+void RayPacket::Clear()
+{
+	count = 0;
+
+	// The unused lanes are masked out, but they must not hold garbage that traps
+	for (int i = 0; i < RAY_PACKET_SIZE; ++i)
+	{
+		originX[i] = originY[i] = originZ[i] = 0.f;
+		directionX[i] = directionY[i] = directionZ[i] = 0.f;
+		inverseDirectionX[i] = inverseDirectionY[i] = inverseDirectionZ[i] = 0.f;
+	}
+}
+
+bool RayPacket::Add(const Ray& ray)
+{
+	return Add(ray.origin, ray.direction);
+}
+
+bool RayPacket::Add(const glm::vec3& origin, const glm::vec3& direction)
+{
+	if (count == RAY_PACKET_SIZE) return false;
+
+	glm::vec3 inverseDirection = GetInverseDirection(direction);
+
+	originX[count] = origin.x;
+	originY[count] = origin.y;
+	originZ[count] = origin.z;
+	directionX[count] = direction.x;
+	directionY[count] = direction.y;
+	directionZ[count] = direction.z;
+	inverseDirectionX[count] = inverseDirection.x;
+	inverseDirectionY[count] = inverseDirection.y;
+	inverseDirectionZ[count] = inverseDirection.z;
+
+	++count;
+	return true;
+}
+
+Ray RayPacket::GetRay(int index) const
+{
+	return Ray(
+		glm::vec3(originX[index], originY[index], originZ[index]),
+		glm::vec3(directionX[index], directionY[index], directionZ[index])
+	);
+}
+
+// Lane groups: the tests are written once against these operations and instanced for each width.
+// A mask holds the lanes that pass a comparison, Bits turns it into one bit per lane and Select
+// picks a where it is set and b elsewhere. MinLane is the smallest value of the lanes.
+
+struct ScalarRayLanes
+{
+	typedef float Type;
+	typedef bool Mask;
+	static const int size = 1;
+
+	static inline Type Load(const float* p) { return *p; }
+	static inline void Store(float* p, Type a) { *p = a; }
+	static inline Type Set(float a) { return a; }
+	static inline Type Add(Type a, Type b) { return a + b; }
+	static inline Type Sub(Type a, Type b) { return a - b; }
+	static inline Type Mul(Type a, Type b) { return a * b; }
+	static inline Type Div(Type a, Type b) { return a / b; }
+	static inline Type Min(Type a, Type b) { return a < b ? a : b; }
+	static inline Type Max(Type a, Type b) { return a > b ? a : b; }
+	static inline Mask Less(Type a, Type b) { return a < b; }
+	static inline Mask LessEqual(Type a, Type b) { return a <= b; }
+	static inline Mask And(Mask a, Mask b) { return a && b; }
+	static inline Type Select(Mask m, Type a, Type b) { return m ? a : b; }
+	static inline float MinLane(Type a) { return a; }
+	static inline int Bits(Mask a) { return a ? 1 : 0; }
+};
+
+#ifdef RAY_PACKET_AVX
+
+struct AVXRayLanes
+{
+	typedef __m256 Type;
+	typedef __m256 Mask;
+	static const int size = 8;
+
+	static inline Type Load(const float* p) { return _mm256_loadu_ps(p); }
+	static inline void Store(float* p, Type a) { _mm256_storeu_ps(p, a); }
+	static inline Type Set(float a) { return _mm256_set1_ps(a); }
+	static inline Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+	static inline Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+	static inline Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+	static inline Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+	static inline Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+	static inline Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+	static inline Mask Less(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static inline Mask LessEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static inline Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+	static inline Type Select(Mask m, Type a, Type b) { return _mm256_blendv_ps(b, a, m); }
+
+	static inline float MinLane(Type a)
+	{
+		__m128 m = _mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+		m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+		return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+	}
+	static inline int Bits(Mask a) { return _mm256_movemask_ps(a); }
+};
+
+typedef AVXRayLanes RayLanes;
+
+#elif defined(RAY_PACKET_SSE)
+
+struct SSERayLanes
+{
+	typedef __m128 Type;
+	typedef __m128 Mask;
+	static const int size = 4;
+
+	static inline Type Load(const float* p) { return _mm_loadu_ps(p); }
+	static inline void Store(float* p, Type a) { _mm_storeu_ps(p, a); }
+	static inline Type Set(float a) { return _mm_set1_ps(a); }
+	static inline Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+	static inline Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+	static inline Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+	static inline Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+	static inline Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+	static inline Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+	static inline Mask Less(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+	static inline Mask LessEqual(Type a, Type b) { return _mm_cmple_ps(a, b); }
+	static inline Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+	static inline Type Select(Mask m, Type a, Type b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+	static inline float MinLane(Type a)
+	{
+		__m128 m = _mm_min_ps(a, _mm_movehl_ps(a, a));
+		return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+	}
+	static inline int Bits(Mask a) { return _mm_movemask_ps(a); }
+};
+
+typedef SSERayLanes RayLanes;
+
+#else
+
+typedef ScalarRayLanes RayLanes;
+
+#endif
+
+// Model of a scene with the matrices the packets need, computed once per call instead of once per
+// packet. tested holds the number of the last packet that was cast against it.
+struct PacketModel
+{
+	const Model* model;
+	glm::mat4 inverseWorld;
+	glm::mat3 normalMatrix; // Transforms the normals of the mesh to world space
+	unsigned int tested;
+};
+
+// Models of the scene, sorted by address so that the leaves of the octree find theirs with a
+// binary search. A model in several leaves is only cast once per packet, without clearing or
+// allocating anything between packets.
+struct PacketScene
+{
+	std::vector<PacketModel> models;
+	unsigned int packet = 0; // Number of the packet being cast
+
+	PacketScene(const Scene& scene)
+	{
+		std::vector<const Model*> sorted;
+
+		// The octree is not updated when models are added or removed, so it is the one to read
+		if (scene.octree != 0) AddOctreeModels(scene.octree, sorted);
+		else sorted.assign(scene.objects.begin(), scene.objects.end());
+
+		std::sort(sorted.begin(), sorted.end());
+		sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+		models.resize(sorted.size());
+
+		for (int i = 0; i < (int)sorted.size(); ++i)
+		{
+			glm::mat4 world = GetWorldMatrix(*sorted[i]);
+
+			models[i].model = sorted[i];
+			models[i].inverseWorld = glm::inverse(world);
+			models[i].normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+			models[i].tested = 0;
+		}
+	}
+
+	static void AddOctreeModels(const OctreeNode* node, std::vector<const Model*>& outModels)
+	{
+		outModels.insert(outModels.end(), node->models.begin(), node->models.end());
+
+		if (node->children != 0)
+			for (int i = 0; i < 8; ++i)
+				AddOctreeModels(&node->children[i], outModels);
+	}
+
+	PacketModel* Find(const Model* model)
+	{
+		auto it = std::lower_bound(models.begin(), models.end(), model, [](const PacketModel& a, const Model* b) { return a.model < b; });
+		return it != models.end() && it->model == model ? &*it : 0;
+	}
+};
+
+// Closest hits of the rays of a packet so far, FLT_MAX where there is none. The lanes beyond the
+// rays of the packet start behind their origin, so that they fail every test.
+struct PacketHits
+{
+	alignas(32) float t[RAY_PACKET_SIZE];
+	int triangles[RAY_PACKET_SIZE];
+	const PacketModel* models[RAY_PACKET_SIZE];
+
+	PacketHits(int count)
+	{
+		for (int i = 0; i < RAY_PACKET_SIZE; ++i)
+		{
+			t[i] = i < count ? FLT_MAX : -1.f;
+			triangles[i] = -1;
+			models[i] = 0;
+		}
+	}
+};
+
+// Lanes of mask whose ray enters the box before its closest hit, with the entry distances of the
+// lanes in outEntry, FLT_MAX for the ones that miss it, and the nearest of them in outNearest
+template <class L>
+static inline int SlabLanes(const glm::vec3& min, const glm::vec3& max, const RayPacket& packet, const float* tMax, int mask, float* outEntry, float& outNearest)
+{
+	typedef typename L::Type T;
+	typedef typename L::Mask M;
+
+	const T minX = L::Set(min.x), minY = L::Set(min.y), minZ = L::Set(min.z);
+	const T maxX = L::Set(max.x), maxY = L::Set(max.y), maxZ = L::Set(max.z);
+	const T zero = L::Set(0.f);
+
+	int result = 0;
+	outNearest = FLT_MAX;
+
+	for (int g = 0; g < RAY_PACKET_SIZE; g += L::size)
+	{
+		if (((mask >> g) & ((1 << L::size) - 1)) == 0)
+		{
+			L::Store(&outEntry[g], L::Set(FLT_MAX));
+			continue;
+		}
+
+		T ox = L::Load(&packet.originX[g]), oy = L::Load(&packet.originY[g]), oz = L::Load(&packet.originZ[g]);
+		T ix = L::Load(&packet.inverseDirectionX[g]), iy = L::Load(&packet.inverseDirectionY[g]), iz = L::Load(&packet.inverseDirectionZ[g]);
+
+		T t1x = L::Mul(L::Sub(minX, ox), ix), t2x = L::Mul(L::Sub(maxX, ox), ix);
+		T t1y = L::Mul(L::Sub(minY, oy), iy), t2y = L::Mul(L::Sub(maxY, oy), iy);
+		T t1z = L::Mul(L::Sub(minZ, oz), iz), t2z = L::Mul(L::Sub(maxZ, oz), iz);
+
+		T entry = L::Max(L::Max(L::Min(t1x, t2x), L::Min(t1y, t2y)), L::Max(L::Min(t1z, t2z), zero));
+		T exit = L::Min(L::Min(L::Max(t1x, t2x), L::Max(t1y, t2y)), L::Min(L::Max(t1z, t2z), L::Load(&tMax[g])));
+
+		M hit = L::LessEqual(entry, exit);
+		entry = L::Select(hit, entry, L::Set(FLT_MAX));
+
+		L::Store(&outEntry[g], entry);
+		outNearest = std::min(outNearest, L::MinLane(entry));
+		result |= L::Bits(hit) << g;
+	}
+
+	return result & mask;
+}
+
+// Lanes of mask whose entry distance is not beyond their closest hit
+template <class L>
+static inline int CloserLanes(const float* entry, const float* tMax, int mask)
+{
+	int result = 0;
+
+	for (int g = 0; g < RAY_PACKET_SIZE; g += L::size)
+		if (((mask >> g) & ((1 << L::size) - 1)) != 0)
+			result |= L::Bits(L::LessEqual(L::Load(&entry[g]), L::Load(&tMax[g]))) << g;
+
+	return result & mask;
+}
+
+// Möller–Trumbore test of the lanes of mask against the triangle. Only the front face counts, as
+// in Raycast(Triangle, Ray). Returns the lanes that hit it before their closest hit, with their
+// distances in outT.
+template <class L>
+static inline int TriangleLanes(const BVHTriangle& triangle, const RayPacket& packet, const float* tMax, int mask, float* outT)
+{
+	typedef typename L::Type T;
+	typedef typename L::Mask M;
+
+	const T e1x = L::Set(triangle.edge1.x), e1y = L::Set(triangle.edge1.y), e1z = L::Set(triangle.edge1.z);
+	const T e2x = L::Set(triangle.edge2.x), e2y = L::Set(triangle.edge2.y), e2z = L::Set(triangle.edge2.z);
+	const T ax = L::Set(triangle.a.x), ay = L::Set(triangle.a.y), az = L::Set(triangle.a.z);
+	const T zero = L::Set(0.f);
+	const T one = L::Set(1.f);
+	const T minimum = L::Set(-BVH_EDGE_EPSILON);
+	const T maximum = L::Set(1.f + BVH_EDGE_EPSILON);
+
+	int result = 0;
+
+	for (int g = 0; g < RAY_PACKET_SIZE; g += L::size)
+	{
+		if (((mask >> g) & ((1 << L::size) - 1)) == 0) continue;
+
+		T dx = L::Load(&packet.directionX[g]), dy = L::Load(&packet.directionY[g]), dz = L::Load(&packet.directionZ[g]);
+
+		// p = d x e2, det = e1 . p
+		T px = L::Sub(L::Mul(dy, e2z), L::Mul(dz, e2y));
+		T py = L::Sub(L::Mul(dz, e2x), L::Mul(dx, e2z));
+		T pz = L::Sub(L::Mul(dx, e2y), L::Mul(dy, e2x));
+		T det = L::Add(L::Add(L::Mul(e1x, px), L::Mul(e1y, py)), L::Mul(e1z, pz));
+		T inverseDet = L::Div(one, det);
+
+		T sx = L::Sub(L::Load(&packet.originX[g]), ax);
+		T sy = L::Sub(L::Load(&packet.originY[g]), ay);
+		T sz = L::Sub(L::Load(&packet.originZ[g]), az);
+		T u = L::Mul(L::Add(L::Add(L::Mul(sx, px), L::Mul(sy, py)), L::Mul(sz, pz)), inverseDet);
+
+		// q = s x e1
+		T qx = L::Sub(L::Mul(sy, e1z), L::Mul(sz, e1y));
+		T qy = L::Sub(L::Mul(sz, e1x), L::Mul(sx, e1z));
+		T qz = L::Sub(L::Mul(sx, e1y), L::Mul(sy, e1x));
+		T v = L::Mul(L::Add(L::Add(L::Mul(dx, qx), L::Mul(dy, qy)), L::Mul(dz, qz)), inverseDet);
+		T t = L::Mul(L::Add(L::Add(L::Mul(e2x, qx), L::Mul(e2y, qy)), L::Mul(e2z, qz)), inverseDet);
+
+		M hit = L::And(L::Less(zero, det), L::LessEqual(minimum, u));
+		hit = L::And(hit, L::LessEqual(minimum, v));
+		hit = L::And(hit, L::LessEqual(L::Add(u, v), maximum));
+		hit = L::And(hit, L::LessEqual(zero, t));
+		hit = L::And(hit, L::LessEqual(t, L::Load(&tMax[g])));
+
+		L::Store(&outT[g], t);
+		result |= L::Bits(hit) << g;
+	}
+
+	return result & mask;
+}
+
+static inline void TestTriangle(const BVHTriangle& triangle, const RayPacket& packet, int mask, PacketHits& hits, const PacketModel* model)
+{
+	alignas(32) float t[RAY_PACKET_SIZE];
+	int hitMask = TriangleLanes<RayLanes>(triangle, packet, hits.t, mask, t);
+
+	for (int i = 0; hitMask != 0; ++i, hitMask >>= 1)
+	{
+		if ((hitMask & 1) == 0) continue;
+
+		hits.t[i] = t[i];
+		hits.triangles[i] = triangle.index;
+		hits.models[i] = model;
+	}
+}
+
+// Node of the BVH reached by some lanes of a packet, with their entry distances
+struct PacketNode
+{
+	alignas(32) float entry[RAY_PACKET_SIZE];
+	float nearest; // FLT_MAX if no lane reaches it
+	int index;
+	int mask;
+};
+
+// Packet traversal of the BVH of the mesh, or of every triangle if it has none. The distances of
+// hits are kept along the rays of the packet, so the closest hits of other meshes cull this one.
+// As in RaycastBVH, both children are tested at their parent and the nearest one is visited first.
+// The other one is pushed with the entry distances of its lanes, which drop the lanes that found a
+// closer hit by the time it is popped.
+static void TraverseMesh(const Mesh& mesh, const RayPacket& packet, int mask, PacketHits& hits, const PacketModel* model)
+{
+	if (mesh.accelerator == 0)
+	{
+		for (int i = 0; i < (int)mesh.GetNumTriangles(); ++i)
+			TestTriangle(mesh.GetBVHTriangle(i), packet, mask, hits, model);
+
+		return;
+	}
+
+	const BVH& bvh = *mesh.accelerator;
+
+	PacketNode stack[BVH_STACK_SIZE + 1]; // The children of a node are tested in place, above the top
+	int size = 0;
+
+	PacketNode current;
+	current.index = 0;
+	current.mask = SlabLanes<RayLanes>(bvh.nodes[0].min, bvh.nodes[0].max, packet, hits.t, mask, current.entry, current.nearest);
+
+	while (current.mask != 0)
+	{
+		const BVHNode& node = bvh.nodes[current.index];
+
+		if (node.IsLeaf())
+		{
+			for (int i = node.first; i < node.first + node.count; ++i)
+				TestTriangle(bvh.leafTriangles[i], packet, current.mask, hits, model);
+		}
+		else
+		{
+			PacketNode* nearChild = &stack[size];
+			PacketNode* farChild = &stack[size + 1];
+
+			for (int i = 0; i < 2; ++i)
+			{
+				const BVHNode& child = bvh.nodes[node.first + i];
+				PacketNode* test = i == 0 ? nearChild : farChild;
+
+				test->index = node.first + i;
+				test->mask = SlabLanes<RayLanes>(child.min, child.max, packet, hits.t, current.mask, test->entry, test->nearest);
+			}
+
+			if (farChild->nearest < nearChild->nearest)
+				std::swap(nearChild, farChild);
+
+			if (nearChild->mask != 0)
+			{
+				current = *nearChild;
+				if (farChild->mask != 0) stack[size++] = *farChild;
+
+				continue;
+			}
+		}
+
+		// The hits found since a node was pushed can leave it without lanes
+		current.mask = 0;
+
+		while (size > 0 && current.mask == 0)
+		{
+			current = stack[--size];
+			current.mask = CloserLanes<RayLanes>(current.entry, hits.t, current.mask);
+		}
+	}
+}
+
+void Raycast(const Mesh& mesh, const RayPacket& packet, RaycastResult* outResults)
+{
+	PacketHits hits(packet.count);
+	TraverseMesh(mesh, packet, (1 << packet.count) - 1, hits, 0);
+
+	for (int i = 0; i < packet.count; ++i)
+	{
+		RaycastResult* result = &outResults[i];
+		ResetRaycastResult(result);
+
+		if (hits.triangles[i] < 0) continue;
+
+		Ray ray = packet.GetRay(i);
+
+		result->t = hits.t[i];
+		result->hit = true;
+		result->point = ray.origin + ray.direction * hits.t[i];
+		result->normal = FromTriangle(mesh.GetTriangle(hits.triangles[i])).normal;
+		result->triangle = hits.triangles[i];
+	}
+}
+
+// Casts the packet against a model, in the space of its mesh
+static void TraverseModel(const PacketModel& model, const RayPacket& packet, int mask, PacketHits& hits)
+{
+	if (model.model->GetMesh() == 0) return;
+
+	RayPacket local;
+
+	for (int i = 0; i < packet.count; ++i)
+	{
+		local.Add(
+			MultiplyPoint(glm::vec3(packet.originX[i], packet.originY[i], packet.originZ[i]), model.inverseWorld),
+			MultiplyVector(glm::vec3(packet.directionX[i], packet.directionY[i], packet.directionZ[i]), model.inverseWorld)
+		);
+	}
+
+	TraverseMesh(*model.model->GetMesh(), local, mask, hits, &model);
+}
+
+// Same order as Raycast(OctreeNode*, Ray), a model in several leaves is only cast once
+static void TraverseOctree(const OctreeNode* node, const RayPacket& packet, int mask, PacketHits& hits, PacketScene& scene)
+{
+	// SplitTree gives every split node 8 children, most of them empty
+	if (node->children == 0 && node->models.empty()) return;
+
+	glm::vec3 min = GetMin(node->bounds);
+	glm::vec3 max = GetMax(node->bounds);
+
+	alignas(32) float entry[RAY_PACKET_SIZE];
+	float nearest;
+	mask = SlabLanes<RayLanes>(min, max, packet, hits.t, mask, entry, nearest);
+	if (mask == 0) return;
+
+	if (node->children != 0)
+	{
+		for (int i = 0; i < 8; ++i)
+			TraverseOctree(&node->children[i], packet, mask, hits, scene);
+
+		return;
+	}
+
+	for (const Model* model : node->models)
+	{
+		PacketModel* packetModel = scene.Find(model);
+		if (packetModel->tested == scene.packet) continue;
+
+		packetModel->tested = scene.packet;
+		TraverseModel(*packetModel, packet, (1 << packet.count) - 1, hits);
+	}
+}
+
+static void Raycast(const Scene& scene, PacketScene& packetScene, const RayPacket& packet, RaycastResult* outResults, Model** outModels)
+{
+	PacketHits hits(packet.count);
+	int mask = (1 << packet.count) - 1;
+
+	++packetScene.packet;
+
+	if (scene.octree != 0)
+	{
+		TraverseOctree(scene.octree, packet, mask, hits, packetScene);
+	}
+	else
+	{
+		for (const PacketModel& model : packetScene.models)
+			TraverseModel(model, packet, mask, hits);
+	}
+
+	for (int i = 0; i < packet.count; ++i)
+	{
+		RaycastResult* result = &outResults[i];
+		ResetRaycastResult(result);
+
+		if (outModels != 0) outModels[i] = hits.models[i] != 0 ? const_cast<Model*>(hits.models[i]->model) : 0;
+
+		if (hits.triangles[i] < 0) continue;
+
+		Ray ray = packet.GetRay(i);
+		glm::vec3 normal = FromTriangle(hits.models[i]->model->GetMesh()->GetTriangle(hits.triangles[i])).normal;
+
+		result->t = hits.t[i];
+		result->hit = true;
+		result->point = ray.origin + ray.direction * hits.t[i];
+		result->normal = glm::normalize(hits.models[i]->normalMatrix * normal);
+		result->triangle = hits.triangles[i];
+	}
+}
+
+void Raycast(const Scene& scene, const RayPacket& packet, RaycastResult* outResults, Model** outModels)
+{
+	PacketScene packetScene(scene);
+	Raycast(scene, packetScene, packet, outResults, outModels);
+}
+
+void Raycast(const Scene& scene, const std::vector<Ray>& rays, std::vector<RaycastResult>& outResults, std::vector<Model*>& outModels)
+{
+	outResults.resize(rays.size());
+	outModels.resize(rays.size());
+
+	PacketScene packetScene(scene);
+	RayPacket packet;
+
+	for (int first = 0; first < (int)rays.size(); first += RAY_PACKET_SIZE)
+	{
+		packet.Clear();
+
+		for (int i = first; i < first + RAY_PACKET_SIZE && i < (int)rays.size(); ++i)
+			packet.Add(rays[i]);
+
+		Raycast(scene, packetScene, packet, &outResults[first], &outModels[first]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <vector>
+
+#define RAY_PACKET_SIZE 8 // Rays cast together, one AVX group or two SSE groups
+
+// Rays cast together against a mesh or a scene, stored as a structure of arrays so that the slab
+// and triangle tests run on all of them at once. A packet visits every node that any of its rays
+// reaches, so it pays when the rays are coherent: close origins and directions, as the pixels of
+// a tile or the beams of a sensor.
+struct RayPacket
+{
+	alignas(32) float originX[RAY_PACKET_SIZE];
+	alignas(32) float originY[RAY_PACKET_SIZE];
+	alignas(32) float originZ[RAY_PACKET_SIZE];
+	alignas(32) float directionX[RAY_PACKET_SIZE];
+	alignas(32) float directionY[RAY_PACKET_SIZE];
+	alignas(32) float directionZ[RAY_PACKET_SIZE];
+	alignas(32) float inverseDirectionX[RAY_PACKET_SIZE];
+	alignas(32) float inverseDirectionY[RAY_PACKET_SIZE];
+	alignas(32) float inverseDirectionZ[RAY_PACKET_SIZE];
+
+	int count;
+
+	inline RayPacket() { Clear(); }
+
+	void Clear();
+
+	bool Add(const Ray& ray); // False if the packet is full
+
+	// The directions are not normalized, so that the distances of a transformed packet are still
+	// the distances of the original rays. False if the packet is full.
+	bool Add(const glm::vec3& origin, const glm::vec3& direction);
+
+	Ray GetRay(int index) const;
+};
+
+// Closest hit of each ray of the packet with the mesh, in the space of the mesh. outResults holds
+// packet.count results, with the index of the triangle hit.
+void Raycast(const Mesh& mesh, const RayPacket& packet, RaycastResult* outResults);
+
+// Closest hit of each ray of the packet with the models of the scene, in world space, through the
+// octree if the scene has one and the BVH of each mesh. outModels, if given, receives the model
+// hit by each ray or 0.
+void Raycast(const Scene& scene, const RayPacket& packet, RaycastResult* outResults, Model** outModels = 0);
+
+// Any number of rays, cast in packets of consecutive rays
+void Raycast(const Scene& scene, const std::vector<Ray>& rays, std::vector<RaycastResult>& outResults, std::vector<Model*>& outModels);
\ No newline at end of file
@@ -1,34 +1,12 @@
 #include "RigidBody.h"
 
-#ifndef ROTATIONAL_EULER
+#include <iostream>
 
-RigidBody::RotationalState RigidBody::RotationDerivative(const RigidBody::RotationalState& state)
+RigidBody::RigidBody() : PhysicsObject(RIGID_BODY)
 {
-	// Compute quaternion derivative
-	glm::quat omegaQuat = glm::quat(0.0f, state.w);
-	glm::quat dq = 0.5f * state.q * omegaQuat;
-
-	// Compute angular acceleration
-	glm::vec3 alpha;
-	alpha.x = (torque.x + (I2 - I3) * state.w.y * state.w.z) / I1;
-	alpha.y = (torque.y + (I3 - I1) * state.w.x * state.w.z) / I2;
-	alpha.z = (torque.z + (I1 - I2) * state.w.x * state.w.y) / I3;
-
-	return { dq, alpha };
+	SetIntegrator(RK4_INTEGRATOR, RK4_INTEGRATOR);
 }
 
-#endif // ROTATIONAL_EULER
-
-#ifndef TRANSLATIONAL_EULER
-RigidBody::TranslationalState RigidBody::TranslationDerivative(const RigidBody::TranslationalState& state)
-{
-	glm::vec3 acceleration = force / mass;
-	return { state.velocity, acceleration };
-}
-#endif // TRANSLATIONAL_EULER
-
-RigidBody::RigidBody() : PhysicsObject(RIGID_BODY) {};
-
 RigidBody::RigidBody(
 	float mass,
 	float I1, float I2, float I3
@@ -36,148 +14,178 @@ RigidBody::RigidBody(
 	mass(mass),
 	I1(I1), I2(I2), I3(I3),
 
+	inverseMass(1.f / mass),
+	inverseInertia(1.f / glm::vec3(I1, I2, I3)),
+
 	position(glm::vec3(0.f)),
 	orientation(glm::quat(1.f, 0.f, 0.f, 0.f)),
 
 	velocity(glm::vec3(0.f)),
 	angularVelocity(glm::vec3(0.f)),
 
+	previousPosition(glm::vec3(0.f)),
+	previousOrientation(glm::quat(1.f, 0.f, 0.f, 0.f)),
+
 	force(glm::vec3(0.f)),
 	torque(glm::vec3(0.f)),
 	PhysicsObject(RIGID_BODY)
-{}
-
-#ifdef TRANSLATIONAL_EULER
-
-void RigidBody::UpdateTranslation(float deltaTime)
 {
-	glm::vec3 acceleration = force / mass;
-	velocity += acceleration * deltaTime;
-	position += velocity * deltaTime;
-
-	force = glm::vec3(0.f);
+	SetIntegrator(RK4_INTEGRATOR, RK4_INTEGRATOR);
 }
 
-#endif // TRANSLATIONAL_EULER
+RigidBody::RigidBody(const RigidBody& other) :
+	PhysicsObject(RIGID_BODY),
 
-#ifdef TRANSLATIONAL_RK4
+	force(other.GetForce()),
+	torque(other.GetTorque()),
 
-void RigidBody::UpdateTranslation(float deltaTime)
-{
-	TranslationalState y0 = { position, velocity };
-
-	TranslationalState k1 = TranslationDerivative(y0);
+	mass(other.mass),
+	I1(other.I1), I2(other.I2), I3(other.I3),
 
-	TranslationalState y1 = { position + k1.position * (deltaTime * 0.5f), velocity + k1.velocity * (deltaTime * 0.5f) };
-	TranslationalState k2 = TranslationDerivative(y1);
+	damping(other.damping),
+	angularDamping(other.angularDamping),
 
-	TranslationalState y2 = { position + k2.position * (deltaTime * 0.5f), velocity + k2.velocity * (deltaTime * 0.5f) };
-	TranslationalState k3 = TranslationDerivative(y2);
+	position(other.GetPosition()),
+	orientation(other.GetOrientation()),
+	velocity(other.GetVelocity()),
+	angularVelocity(other.GetLocalAngularVelocity()),
 
-	TranslationalState y3 = { position + k3.position * deltaTime, velocity + k3.velocity * deltaTime };
-	TranslationalState k4 = TranslationDerivative(y3);
+	inverseMass(other.inverseMass),
+	inverseInertia(other.inverseInertia),
 
-	position += (1.0f / 6.0f) * (k1.position + 2.0f * k2.position + 2.0f * k3.position + k4.position) * deltaTime;
-	velocity += (1.0f / 6.0f) * (k1.velocity + 2.0f * k2.velocity + 2.0f * k3.velocity + k4.velocity) * deltaTime;
+	collider(other.collider),
 
-	force = glm::vec3(0.f);
-}
+	awake(other.awake),
+	restingFrames(other.restingFrames),
 
-#endif // TRANSLATIONAL_RK4
+	previousPosition(other.previousPosition),
+	previousOrientation(other.previousOrientation),
 
-#ifdef ROTATIONAL_EULER
-void RigidBody::UpdateRotation(float deltaTime)
+	translationIntegrator(other.translationIntegrator),
+	rotationIntegrator(other.rotationIntegrator),
+	integrate(other.integrate)
 {
-	torque = glm::inverse(orientation) * torque;
+}
 
-	glm::vec3 angularAcceleration;
-	angularAcceleration.x = (torque.x + (I2 - I3) * angularVelocity.y * angularVelocity.z) / I1;
-	angularAcceleration.y = (torque.y + (I3 - I1) * angularVelocity.x * angularVelocity.z) / I2;
-	angularAcceleration.z = (torque.z + (I1 - I2) * angularVelocity.x * angularVelocity.y) / I3;
+RigidBody::~RigidBody()
+{
+	if (batch)
+		batch->Remove(handle);
+}
 
-	// Update orientation and angular velocity
-	angularVelocity += angularAcceleration * deltaTime;
-	//orientation += 0.5f * glm::quat(0.0f, orientation * angularVelocity) * orientation * deltaTime;
-	orientation += 0.5f * orientation * glm::quat(0.0f, angularVelocity) * deltaTime;
-	//orientation = glm::angleAxis(glm::length(angularVelocity) * deltaTime, glm::normalize(orientation * angularVelocity)) * orientation;
-	//orientation = orientation * glm::angleAxis(glm::length(angularVelocity) * deltaTime, glm::normalize(angularVelocity));
+template <class TranslationIntegrator, class RotationIntegrator>
+void RigidBody::Integrate(float deltaTime)
+{
+	TranslationIntegrator::Translate(position, velocity, force * inverseMass, deltaTime);
 
-	orientation = glm::normalize(orientation);
+	// The torque goes to principal inertia axises coordinates
+	RotationIntegrator::Rotate(orientation, angularVelocity, glm::vec3(I1, I2, I3), inverseInertia, glm::inverse(orientation) * torque, deltaTime);
+	transformDirty = true;
 
+	force = glm::vec3(0.f);
 	torque = glm::vec3(0.f);
 }
 
-#endif // ROTATIONAL_EULER
-
-#ifdef ROTATIONAL_RK4
-
-void RigidBody::UpdateRotation(float deltaTime)
+template <class TranslationIntegrator>
+RigidBody::IntegrateFunction RigidBody::GetIntegrateFunction(int rotationIntegrator)
 {
-	// Transform torque to principal inertia axises coordinates
-	torque = glm::inverse(orientation) * torque;
-
-	// RK4 integration
-	RotationalState y0 = { orientation, angularVelocity };
-
-	RotationalState k1 = RotationDerivative(y0);
+	switch (rotationIntegrator)
+	{
+	case SEMI_IMPLICIT_EULER_INTEGRATOR:
+		return &RigidBody::Integrate<TranslationIntegrator, SemiImplicitEulerIntegrator>;
 
-	RotationalState y1 = { orientation + k1.q * (deltaTime * 0.5f), angularVelocity + k1.w * (deltaTime * 0.5f) };
-	RotationalState k2 = RotationDerivative(y1);
+	case RK4_INTEGRATOR:
+		return &RigidBody::Integrate<TranslationIntegrator, RK4Integrator>;
 
-	RotationalState y2 = { orientation + k2.q * (deltaTime * 0.5f), angularVelocity + k2.w * (deltaTime * 0.5f) };
-	RotationalState k3 = RotationDerivative(y2);
+	case SYMPLECTIC_INTEGRATOR:
+		return &RigidBody::Integrate<TranslationIntegrator, SymplecticIntegrator>;
+	}
 
-	RotationalState y3 = { orientation + k3.q * deltaTime, angularVelocity + k3.w * deltaTime };
-	RotationalState k4 = RotationDerivative(y3);
-
-	orientation += (1.0f / 6.0f) * (k1.q + 2.0f * k2.q + 2.0f * k3.q + k4.q) * deltaTime;
-	angularVelocity += (1.0f / 6.0f) * (k1.w + 2.0f * k2.w + 2.0f * k3.w + k4.w) * deltaTime;
-
-	orientation = glm::normalize(orientation);
-
-	torque = glm::vec3(0.f);
+	return nullptr;
 }
 
-#endif // ROTATIONAL_RK4
-
 void RigidBody::Update(float deltaTime)
 {
-	// TRASLATION:
+	if (batch)
+	{
+		int index = batch->GetIndex(handle);
+		if (IsBatchIntegrated())
+		{
+			batch->Integrate(deltaTime, index, index + 1);
+			return;
+		}
+
+		// The other integrators work on the members
+		position = batch->GetPosition(index);
+		orientation = batch->GetOrientation(index);
+		velocity = batch->GetVelocity(index);
+		angularVelocity = batch->GetAngularVelocity(index);
+		force = batch->GetForce(index);
+		torque = batch->GetTorque(index);
+	}
+
 	force -= velocity * damping;
-	UpdateTranslation(deltaTime);
+	torque -= orientation * angularVelocity * angularDamping;
 
-	// ROTATION:
-	torque -= GetAngularVelocity() * angularDamping;
-	UpdateRotation(deltaTime);
+	(this->*integrate)(deltaTime);
 
+	if (batch)
+	{
+		int index = batch->GetIndex(handle);
+		batch->SetPosition(index, position);
+		batch->SetOrientation(index, orientation);
+		batch->SetVelocity(index, velocity);
+		batch->SetAngularVelocity(index, angularVelocity);
+		batch->SetForce(index, force);
+		batch->SetTorque(index, torque);
+	}
 }
 
 void RigidBody::ApplyAcceleration(glm::vec3 acceleration)
 {
-	force += acceleration * mass;
+	StoreForce(GetForce() + acceleration * mass);
 }
 
+// External forces wake the body up, but not accelerations: these are fields like the gravity,
+// which are applied every step and would keep everything awake
 void RigidBody::ApplyForce(glm::vec3 newForce, glm::vec3 point)
 {
-	force += newForce;
+	awake = true;
+	StoreForce(GetForce() + newForce);
 	ApplyTorque(glm::cross(point, newForce));
 }
 
 void RigidBody::ApplyTorque(glm::vec3 newTorque)
 {
-	torque += newTorque;
+	awake = true;
+	StoreTorque(GetTorque() + newTorque);
 }
 
 void RigidBody::ApplyImpulse(glm::vec3 impulse, glm::vec3 point)
 {
-	velocity += impulse;
-	angularVelocity += glm::cross(point/* - position*/, impulse);
+	// point is relative to the center of mass in world axes, as in ApplyForce
+	awake = true;
+	StoreVelocity(GetVelocity() + impulse * inverseMass);
+
+	glm::vec3 localAngularImpulse = glm::inverse(GetOrientation()) * glm::cross(point, impulse);
+	StoreLocalAngularVelocity(GetLocalAngularVelocity() + localAngularImpulse * inverseInertia);
+}
+
+void RigidBody::ApplyPositionImpulse(glm::vec3 positionImpulse, glm::vec3 point)
+{
+	awake = true;
+	StorePosition(GetPosition() + positionImpulse * inverseMass);
+
+	glm::quat newOrientation = GetOrientation();
+	glm::vec3 localRotation = glm::inverse(newOrientation) * glm::cross(point, positionImpulse) * inverseInertia;
+	newOrientation += 0.5f * newOrientation * glm::quat(0.f, localRotation);
+	StoreOrientation(glm::normalize(newOrientation));
 }
 
 void RigidBody::ResetForces()
 {
-	force = glm::vec3(0.0f);
-	torque = glm::vec3(0.0f);
+	StoreForce(glm::vec3(0.0f));
+	StoreTorque(glm::vec3(0.0f));
 }
 
 //void RigidBody::SolveConstraints(const std::vector<OBB>& constraints)
@@ -194,6 +202,8 @@ void RigidBody::ResetForces()
 void RigidBody::SetMass(float mass)
 {
 	this->mass = mass;
+	inverseMass = 1.f / mass;
+	StoreParameters();
 }
 
 void RigidBody::SetInertiaTensor(float I1, float I2, float I3)
@@ -201,41 +211,115 @@ void RigidBody::SetInertiaTensor(float I1, float I2, float I3)
 	this->I1 = I1;
 	this->I2 = I2;
 	this->I3 = I3;
+	inverseInertia = 1.f / glm::vec3(I1, I2, I3);
+	transformDirty = true;
+	StoreParameters();
 }
 
 void RigidBody::SetDamping(float damping)
 {
 	this->damping = damping;
+	StoreParameters();
 }
 
 void RigidBody::SetAngularDamping(float angularDamping)
 {
 	this->angularDamping = angularDamping;
+	StoreParameters();
+}
+
+void RigidBody::SetCollider(const Collider& collider)
+{
+	this->collider = collider;
+}
+
+RigidBody::IntegrateFunction RigidBody::GetIntegrateFunction(int translationIntegrator, int rotationIntegrator)
+{
+	switch (translationIntegrator)
+	{
+	case SEMI_IMPLICIT_EULER_INTEGRATOR:
+		return GetIntegrateFunction<SemiImplicitEulerIntegrator>(rotationIntegrator);
+
+	case VELOCITY_VERLET_INTEGRATOR:
+		return GetIntegrateFunction<VelocityVerletIntegrator>(rotationIntegrator);
+
+	case RK4_INTEGRATOR:
+		return GetIntegrateFunction<RK4Integrator>(rotationIntegrator);
+	}
+
+	return nullptr;
+}
+
+bool RigidBody::SetIntegrator(int translationIntegrator, int rotationIntegrator)
+{
+	IntegrateFunction function = GetIntegrateFunction(translationIntegrator, rotationIntegrator);
+
+	if (function == nullptr)
+	{
+		std::cout << "The integrators " << translationIntegrator << " (translation) and " << rotationIntegrator << " (rotation) are not valid." << std::endl;
+		return false;
+	}
+
+	this->translationIntegrator = translationIntegrator;
+	this->rotationIntegrator = rotationIntegrator;
+	integrate = function;
+	return true;
+}
+
+bool RigidBody::IsValidIntegrator(int translationIntegrator, int rotationIntegrator)
+{
+	return GetIntegrateFunction(translationIntegrator, rotationIntegrator) != nullptr;
 }
 
+// Setting the transform by hand is a teleport, so nothing is interpolated
 void RigidBody::SetPosition(const glm::vec3& position)
 {
-	this->position = position;
+	StorePosition(position);
+	this->previousPosition = position;
+	awake = true;
 }
 
 void RigidBody::SetOrientation(const glm::quat& orientation)
 {
-	this->orientation = orientation;
+	StoreOrientation(orientation);
+	this->previousOrientation = orientation;
+	awake = true;
 }
 
 void RigidBody::SetVelocity(const glm::vec3& velocity)
 {
-	this->velocity = velocity;
+	StoreVelocity(velocity);
+	awake = true;
 }
 
 void RigidBody::SetLocalAngularVelocity(const glm::vec3& localAngularVelocity)
 {
-	this->angularVelocity = localAngularVelocity;
+	StoreLocalAngularVelocity(localAngularVelocity);
+	awake = true;
 }
 
 void RigidBody::SetAngularVelocity(const glm::vec3& angularVelocity)
 {
-	this->angularVelocity = glm::inverse(orientation) * angularVelocity;
+	StoreLocalAngularVelocity(glm::inverse(GetOrientation()) * angularVelocity);
+	awake = true;
+}
+
+void RigidBody::SetAwake(bool awake)
+{
+	this->awake = awake;
+	restingFrames = 0;
+
+	if (!awake)
+	{
+		StoreVelocity(glm::vec3(0.f));
+		StoreLocalAngularVelocity(glm::vec3(0.f));
+		ResetForces();
+	}
+}
+
+void RigidBody::SetRestingFrames(int restingFrames)
+{
+	this->restingFrames = restingFrames;
 }
 
 float RigidBody::GetMass() const
@@ -263,6 +347,26 @@ glm::vec3 RigidBody::GetInertiaDiag() const
 	return glm::vec3(I1, I2, I3);
 }
 
+float RigidBody::GetInverseMass() const
+{
+	return inverseMass;
+}
+
+glm::vec3 RigidBody::GetInverseInertiaDiag() const
+{
+	return inverseInertia;
+}
+
+int RigidBody::GetTranslationIntegrator() const
+{
+	return translationIntegrator;
+}
+
+int RigidBody::GetRotationIntegrator() const
+{
+	return rotationIntegrator;
+}
+
 float RigidBody::GetDamping() const
 {
 	return damping;
@@ -275,43 +379,132 @@ float RigidBody::GetAngularDamping() const
 
 glm::vec3 RigidBody::GetPosition() const
 {
-	return position;
+	return batch ? batch->GetPosition(batch->GetIndex(handle)) : position;
 }
 
 glm::quat RigidBody::GetOrientation() const
 {
-	return orientation;
+	return batch ? batch->GetOrientation(batch->GetIndex(handle)) : orientation;
 }
 
 glm::vec3 RigidBody::GetVelocity() const
 {
-	return velocity;
+	return batch ? batch->GetVelocity(batch->GetIndex(handle)) : velocity;
 }
 
 glm::vec3 RigidBody::GetLocalAngularVelocity() const
 {
-	return angularVelocity;
+	return batch ? batch->GetAngularVelocity(batch->GetIndex(handle)) : angularVelocity;
 }
 
 glm::vec3 RigidBody::GetAngularVelocity() const
 {
-	return orientation * angularVelocity;
+	return GetOrientation() * GetLocalAngularVelocity();
 }
 
 glm::vec3 RigidBody::GetForce() const
 {
-	return force;
+	return batch ? batch->GetForce(batch->GetIndex(handle)) : force;
 }
 
 glm::vec3 RigidBody::GetTorque() const
 {
-	return torque;
+	return batch ? batch->GetTorque(batch->GetIndex(handle)) : torque;
+}
+
+void RigidBody::StorePosition(const glm::vec3& position)
+{
+	if (batch) batch->SetPosition(batch->GetIndex(handle), position);
+	else this->position = position;
+}
+
+void RigidBody::StoreOrientation(const glm::quat& orientation)
+{
+	if (batch) batch->SetOrientation(batch->GetIndex(handle), orientation);
+	else this->orientation = orientation;
+
+	transformDirty = true;
+}
+
+void RigidBody::StoreVelocity(const glm::vec3& velocity)
+{
+	if (batch) batch->SetVelocity(batch->GetIndex(handle), velocity);
+	else this->velocity = velocity;
 }
 
+void RigidBody::StoreLocalAngularVelocity(const glm::vec3& localAngularVelocity)
+{
+	if (batch) batch->SetAngularVelocity(batch->GetIndex(handle), localAngularVelocity);
+	else angularVelocity = localAngularVelocity;
+}
+
+void RigidBody::StoreForce(const glm::vec3& force)
+{
+	if (batch) batch->SetForce(batch->GetIndex(handle), force);
+	else this->force = force;
+}
+
+void RigidBody::StoreTorque(const glm::vec3& torque)
+{
+	if (batch) batch->SetTorque(batch->GetIndex(handle), torque);
+	else this->torque = torque;
+}
+
+void RigidBody::StoreParameters()
+{
+	if (batch) batch->UpdateParameters(batch->GetIndex(handle));
+}
 
 glm::vec3 RigidBody::GetWorldAngularMomentum() const
 {
-	return orientation * (GetDiagInertiaTensor() * angularVelocity);
+	return GetOrientation() * (GetDiagInertiaTensor() * GetLocalAngularVelocity());
+}
+
+const Collider& RigidBody::GetCollider() const
+{
+	return collider;
+}
+
+bool RigidBody::HasCollider() const
+{
+	return collider.type != NO_COLLIDER;
+}
+
+bool RigidBody::IsAwake() const
+{
+	return awake;
+}
+
+int RigidBody::GetRestingFrames() const
+{
+	return restingFrames;
+}
+
+float RigidBody::GetKineticEnergy() const
+{
+	glm::vec3 w = GetLocalAngularVelocity();
+	return 0.5f * mass * glm::length2(GetVelocity()) + 0.5f * (I1 * w.x * w.x + I2 * w.y * w.y + I3 * w.z * w.z);
+}
+
+AABB RigidBody::GetBounds() const
+{
+	return ::GetBounds(collider, GetPosition(), GetOrientation());
+}
+
+void RigidBody::SaveState()
+{
+	previousPosition = GetPosition();
+	previousOrientation = GetOrientation();
+}
+
+glm::vec3 RigidBody::GetInterpolatedPosition(float interpolation) const
+{
+	return glm::mix(previousPosition, GetPosition(), interpolation);
+}
+
+glm::quat RigidBody::GetInterpolatedOrientation(float interpolation) const
+{
+	return glm::slerp(previousOrientation, GetOrientation(), interpolation);
 }
 
 glm::mat3 RigidBody::GetDiagInertiaTensor() const
@@ -325,14 +518,37 @@ glm::mat3 RigidBody::GetDiagInertiaTensor() const
 
 glm::mat3 RigidBody::GetWorldInertiaTensor() const
 {
-	glm::mat3 rotation = glm::mat3_cast(orientation);
+	const glm::mat3& rotation = GetRotationMatrix();
 
 	return rotation * GetDiagInertiaTensor() * glm::transpose(rotation);
 }
 
+void RigidBody::UpdateTransform() const
+{
+	rotation = glm::mat3_cast(GetOrientation());
+
+	// R * diag(1 / I) * R^T, scaling the columns of R before the product
+	glm::mat3 scaled(rotation[0] * inverseInertia.x, rotation[1] * inverseInertia.y, rotation[2] * inverseInertia.z);
+	worldInverseInertia = scaled * glm::transpose(rotation);
+
+	transformDirty = false;
+}
+
+const glm::mat3& RigidBody::GetRotationMatrix() const
+{
+	if (transformDirty) UpdateTransform();
+	return rotation;
+}
+
+const glm::mat3& RigidBody::GetWorldInverseInertiaTensor() const
+{
+	if (transformDirty) UpdateTransform();
+	return worldInverseInertia;
+}
+
 glm::vec3 RigidBody::TransformPointToWorld(glm::vec3 rigidBodyPoint) const
 {
-	return position + orientation * rigidBodyPoint;
+	return GetPosition() + GetOrientation() * rigidBodyPoint;
 }
 
 
@@ -363,8 +579,8 @@ RigidBody MergeRigidBodies(
 
 	// Translation parameters
 	mergedBody.mass = bodyA.mass + bodyB.mass;
-	mergedBody.position = (bodyA.position * bodyA.mass + bodyB.position * bodyB.mass) / mergedBody.mass;
-	mergedBody.velocity = (bodyA.velocity * bodyA.mass + bodyB.velocity * bodyB.mass) / mergedBody.mass;
+	mergedBody.position = (bodyA.GetPosition() * bodyA.mass + bodyB.GetPosition() * bodyB.mass) / mergedBody.mass;
+	mergedBody.velocity = (bodyA.GetVelocity() * bodyA.mass + bodyB.GetVelocity() * bodyB.mass) / mergedBody.mass;
 
 	// Rotation parameters
 	glm::mat3 diagInertiaTensorA = glm::mat3(
@@ -380,15 +596,15 @@ RigidBody MergeRigidBodies(
 	);
 
 	// Calculate world inertia tensors
-	glm::mat3 rotationA = glm::mat3_cast(bodyA.orientation);
-	glm::mat3 rotationB = glm::mat3_cast(bodyB.orientation);
+	glm::mat3 rotationA = glm::mat3_cast(bodyA.GetOrientation());
+	glm::mat3 rotationB = glm::mat3_cast(bodyB.GetOrientation());
 
 	glm::mat3 inertiaTensorA = rotationA * diagInertiaTensorA * glm::transpose(rotationA);
 	glm::mat3 inertiaTensorB = rotationB * diagInertiaTensorB * glm::transpose(rotationB);
 	
 	// Apply Steiner's theorem
-	glm::vec3 relPosA = bodyA.position - mergedBody.position;
-	glm::vec3 relPosB = bodyB.position - mergedBody.position;
+	glm::vec3 relPosA = bodyA.GetPosition() - mergedBody.position;
+	glm::vec3 relPosB = bodyB.GetPosition() - mergedBody.position;
 
 	glm::mat3 shiftedInertiaTensorA = inertiaTensorA + bodyA.mass * (glm::mat3(glm::dot(relPosA, relPosA)) - glm::outerProduct(relPosA, relPosA));
 	glm::mat3 shiftedInertiaTensorB = inertiaTensorB + bodyB.mass * (glm::mat3(glm::dot(relPosB, relPosB)) - glm::outerProduct(relPosB, relPosB));
@@ -406,19 +622,22 @@ RigidBody MergeRigidBodies(
 	principalInertiaAxises[2] = glm::normalize(principalInertiaAxises[2]);*/
 
 	// Calculate the new inertia tensor
-	mergedBody.I1 = inertiaValues.x;
-	mergedBody.I2 = inertiaValues.y;
-	mergedBody.I3 = inertiaValues.z;
+	mergedBody.SetMass(mergedBody.mass);
+	mergedBody.SetInertiaTensor(inertiaValues.x, inertiaValues.y, inertiaValues.z);
 
 	// Calculate the new orientation
 	mergedBody.orientation = glm::normalize(glm::quat(principalInertiaAxises));
+	mergedBody.transformDirty = true;
+
+	mergedBody.previousPosition = mergedBody.position;
+	mergedBody.previousOrientation = mergedBody.orientation;
 
 	// Calculate the new angular velocity
 	glm::vec3 angularMomentumA = bodyA.GetWorldAngularMomentum();
 	glm::vec3 angularMomentumB = bodyB.GetWorldAngularMomentum();
 
-	glm::vec3 shiftedAngularMomentumA = angularMomentumA + glm::cross(relPosA, bodyA.mass * bodyA.velocity);
-	glm::vec3 shiftedAngularMomentumB = angularMomentumB + glm::cross(relPosB, bodyB.mass * bodyB.velocity);
+	glm::vec3 shiftedAngularMomentumA = angularMomentumA + glm::cross(relPosA, bodyA.mass * bodyA.GetVelocity());
+	glm::vec3 shiftedAngularMomentumB = angularMomentumB + glm::cross(relPosB, bodyB.mass * bodyB.GetVelocity());
 
 	glm::vec3 mergedAngularMomentum = shiftedAngularMomentumA + shiftedAngularMomentumB;
 
@@ -2,19 +2,15 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include "PhysicsObject.h"
+#include "Collider.h"
+#include "Integrators.h"
+#include "RigidBodyBatch.h"
 
-//#define ROTATIONAL_EULER
-//#define TRANSLATIONAL_EULER
-
-#ifndef ROTATIONAL_EULER
-#define ROTATIONAL_RK4
-#endif // ROTATIONAL_EULER
-
-#ifndef TRANSLATIONAL_EULER
-#define TRANSLATIONAL_RK4
-#endif // TRANSLATIONAL_EULER
-
+// While a rigid body is stored in a RigidBodyBatch its position, orientation, velocities, force
+// and torque live there, and the body is a view over its slot. Otherwise it keeps its own state,
+// which is copied into the batch when it is added to one and copied back when it is removed.
 class RigidBody : public PhysicsObject
 {
 protected:
@@ -32,37 +28,59 @@ protected:
 	glm::vec3 velocity;
 	glm::vec3 angularVelocity; // object space
 
+	// Derived quantities. The inverses only change with the mass and the inertia, the matrices
+	// depend on the orientation and are rebuilt on demand after it changes.
+	float inverseMass = 0.f;
+	glm::vec3 inverseInertia = glm::vec3(0.f);
+	mutable glm::mat3 rotation;
+	mutable glm::mat3 worldInverseInertia;
+	mutable bool transformDirty = true;
+
+	void UpdateTransform() const;
+
+	Collider collider;
+
+	// Sleeping bodies are skipped by the physics system until something wakes them up
+	bool awake = true;
+	int restingFrames = 0; // Consecutive frames with low kinetic energy
+
+	// State before the last fixed step, only used to interpolate the rendering
+	glm::vec3 previousPosition;
+	glm::quat previousOrientation;
+
 	friend RigidBody MergeRigidBodies(
 		const RigidBody& bodyA,
 		const RigidBody& bodyB
 	);
 
-#ifndef ROTATIONAL_EULER
-
-	struct RotationalState
-	{
-		glm::quat q;
-		glm::vec3 w;
-	};
+	RigidBodyBatch* batch = nullptr;
+	RigidBodyHandle handle;
 
-	RotationalState RotationDerivative(const RotationalState& state);
+	friend class RigidBodyBatch;
 
-#endif // ROTATIONAL_EULER
+	// Write the state wherever it lives
+	void StorePosition(const glm::vec3& position);
+	void StoreOrientation(const glm::quat& orientation);
+	void StoreVelocity(const glm::vec3& velocity);
+	void StoreLocalAngularVelocity(const glm::vec3& localAngularVelocity);
+	void StoreForce(const glm::vec3& force);
+	void StoreTorque(const glm::vec3& torque);
+	void StoreParameters(); // Mass, inertia and damping, into the batch
 
-#ifndef TRANSLATIONAL_EULER
+	// Integrators chosen at runtime, each pair is a different instance of Integrate
+	typedef void (RigidBody::*IntegrateFunction)(float deltaTime);
 
-	struct TranslationalState
-	{
-		glm::vec3 position;
-		glm::vec3 velocity;
-	};
+	int translationIntegrator = RK4_INTEGRATOR;
+	int rotationIntegrator = RK4_INTEGRATOR;
+	IntegrateFunction integrate;
 
-	TranslationalState TranslationDerivative(const TranslationalState& state);
+	template <class TranslationIntegrator, class RotationIntegrator>
+	void Integrate(float deltaTime);
 
-#endif // TRANSLATIONAL_EULER
+	template <class TranslationIntegrator>
+	static IntegrateFunction GetIntegrateFunction(int rotationIntegrator);
 
-	void UpdateTranslation(float deltaTime);
-	void UpdateRotation(float deltaTime);
+	static IntegrateFunction GetIntegrateFunction(int translationIntegrator, int rotationIntegrator); // nullptr if not valid
 
 public:
 	RigidBody();
@@ -72,6 +90,10 @@ public:
 		float I1, float I2, float I3
 	);
 
+	RigidBody(const RigidBody& other); // The copy does not belong to any batch
+
+	~RigidBody(); // Removes the body from its batch
+
 	void Update(float deltaTime);
 
 	void ApplyAcceleration(glm::vec3 acceleration);
@@ -82,6 +104,9 @@ public:
 
 	void ApplyImpulse(glm::vec3 impulse, glm::vec3 point);
 
+	// Moves and turns the body as ApplyImpulse changes its velocities
+	void ApplyPositionImpulse(glm::vec3 positionImpulse, glm::vec3 point);
+
 	void ResetForces();
 
 	//void SolveConstraints(const std::vector<OBB>& constraints);
@@ -94,21 +119,43 @@ public:
 	void SetDamping(float damping);
 	void SetAngularDamping(float angularDamping);
 
+	void SetCollider(const Collider& collider);
+
+	// SEMI_IMPLICIT_EULER_INTEGRATOR, VELOCITY_VERLET_INTEGRATOR or RK4_INTEGRATOR for the translation,
+	// SEMI_IMPLICIT_EULER_INTEGRATOR, RK4_INTEGRATOR or SYMPLECTIC_INTEGRATOR for the rotation
+	bool SetIntegrator(int translationIntegrator, int rotationIntegrator);
+	static bool IsValidIntegrator(int translationIntegrator, int rotationIntegrator);
+
+	// True if the integrators are the ones of the SIMD kernel of RigidBodyBatch
+	inline bool IsBatchIntegrated() const { return translationIntegrator == SEMI_IMPLICIT_EULER_INTEGRATOR && rotationIntegrator == SEMI_IMPLICIT_EULER_INTEGRATOR; }
+
 	void SetPosition(const glm::vec3& position);
 	void SetOrientation(const glm::quat& orientation);
 	void SetVelocity(const glm::vec3& velocity);
 	void SetLocalAngularVelocity(const glm::vec3& localAngularVelocity);
 	void SetAngularVelocity(const glm::vec3& angularVelocity);
 
+	void SetAwake(bool awake); // Putting a body to sleep stops it
+	void SetRestingFrames(int restingFrames);
+
 	float GetMass() const;
 	float GetI1() const;
 	float GetI2() const;
 	float GetI3() const;
 	glm::vec3 GetInertiaDiag() const;
 
+	float GetInverseMass() const;
+	glm::vec3 GetInverseInertiaDiag() const;
+
 	float GetDamping() const;
 	float GetAngularDamping() const;
 
+	int GetTranslationIntegrator() const;
+	int GetRotationIntegrator() const;
+
+	inline RigidBodyBatch* GetBatch() const { return batch; }
+	inline RigidBodyHandle GetHandle() const { return handle; }
+
 	glm::vec3 GetPosition() const;
 	glm::quat GetOrientation() const;
 	glm::vec3 GetVelocity() const;
@@ -120,9 +167,27 @@ public:
 
 	glm::vec3 GetWorldAngularMomentum() const;
 
+	bool IsAwake() const;
+	int GetRestingFrames() const;
+	float GetKineticEnergy() const;
+
+	const Collider& GetCollider() const;
+	bool HasCollider() const;
+	AABB GetBounds() const; // World bounds of the collider
+
+	void SaveState(); // Stores the current transform as the previous one
+
+	// Blend between the previous and the current transform (0 = previous, 1 = current)
+	glm::vec3 GetInterpolatedPosition(float interpolation) const;
+	glm::quat GetInterpolatedOrientation(float interpolation) const;
+
 	glm::mat3 GetDiagInertiaTensor() const;
 	glm::mat3 GetWorldInertiaTensor() const;
 
+	// Cached until the orientation changes
+	const glm::mat3& GetRotationMatrix() const;
+	const glm::mat3& GetWorldInverseInertiaTensor() const;
+
 
 	glm::vec3 TransformPointToWorld(glm::vec3 rigidBodyPoint) const;
 };
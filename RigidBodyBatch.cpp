@@ -0,0 +1,385 @@
+#include "RigidBodyBatch.h"
+#include "RigidBody.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__AVX__)
+#define RIGID_BODY_BATCH_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RIGID_BODY_BATCH_SSE
+#include <emmintrin.h>
+#endif
+
+// Lane groups: the kernel is written once against these operations and instanced for each width
+
+struct ScalarLanes
+{
+	typedef float Type;
+	static const int size = 1;
+
+	static inline Type Load(const float* p) { return *p; }
+	static inline void Store(float* p, Type a) { *p = a; }
+	static inline Type Set(float a) { return a; }
+	static inline Type Add(Type a, Type b) { return a + b; }
+	static inline Type Sub(Type a, Type b) { return a - b; }
+	static inline Type Mul(Type a, Type b) { return a * b; }
+	static inline Type InverseSqrt(Type a) { return 1.f / sqrtf(a); }
+};
+
+#ifdef RIGID_BODY_BATCH_AVX
+
+struct AVXLanes
+{
+	typedef __m256 Type;
+	static const int size = 8;
+
+	static inline Type Load(const float* p) { return _mm256_load_ps(p); }
+	static inline void Store(float* p, Type a) { _mm256_store_ps(p, a); }
+	static inline Type Set(float a) { return _mm256_set1_ps(a); }
+	static inline Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+	static inline Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+	static inline Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+	static inline Type InverseSqrt(Type a) { return _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_sqrt_ps(a)); }
+};
+
+#endif // RIGID_BODY_BATCH_AVX
+
+#if defined(RIGID_BODY_BATCH_AVX) || defined(RIGID_BODY_BATCH_SSE)
+
+struct SSELanes
+{
+	typedef __m128 Type;
+	static const int size = 4;
+
+	static inline Type Load(const float* p) { return _mm_load_ps(p); }
+	static inline void Store(float* p, Type a) { _mm_store_ps(p, a); }
+	static inline Type Set(float a) { return _mm_set1_ps(a); }
+	static inline Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+	static inline Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+	static inline Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+	static inline Type InverseSqrt(Type a) { return _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(a)); }
+};
+
+#endif
+
+// Same steps as RigidBody::Update with SemiImplicitEulerIntegrator for both the translation and
+// the rotation, for L::size bodies per iteration
+template <class L>
+static void IntegrateLanes(RigidBodyBatch& batch, int& i, int end, float deltaTime)
+{
+	typedef typename L::Type T;
+
+	const T dt = L::Set(deltaTime);
+	const T halfDt = L::Set(0.5f * deltaTime);
+	const T two = L::Set(2.f);
+	const T zero = L::Set(0.f);
+
+	for (; i + L::size <= end; i += L::size)
+	{
+		// Translation, with the damping as a force
+		T inverseMass = L::Load(&batch.inverseMasses[i]);
+		T damping = L::Load(&batch.dampings[i]);
+
+		T vx = L::Load(&batch.velocityX[i]);
+		T vy = L::Load(&batch.velocityY[i]);
+		T vz = L::Load(&batch.velocityZ[i]);
+
+		T scale = L::Mul(inverseMass, dt);
+		vx = L::Add(vx, L::Mul(L::Sub(L::Load(&batch.forceX[i]), L::Mul(damping, vx)), scale));
+		vy = L::Add(vy, L::Mul(L::Sub(L::Load(&batch.forceY[i]), L::Mul(damping, vy)), scale));
+		vz = L::Add(vz, L::Mul(L::Sub(L::Load(&batch.forceZ[i]), L::Mul(damping, vz)), scale));
+
+		L::Store(&batch.positionX[i], L::Add(L::Load(&batch.positionX[i]), L::Mul(vx, dt)));
+		L::Store(&batch.positionY[i], L::Add(L::Load(&batch.positionY[i]), L::Mul(vy, dt)));
+		L::Store(&batch.positionZ[i], L::Add(L::Load(&batch.positionZ[i]), L::Mul(vz, dt)));
+
+		L::Store(&batch.velocityX[i], vx);
+		L::Store(&batch.velocityY[i], vy);
+		L::Store(&batch.velocityZ[i], vz);
+
+		// Torque to object space: rotation by the conjugate, t' = t + 2 u x (u x t + s t) with u = -q.xyz
+		T qw = L::Load(&batch.orientationW[i]);
+		T qx = L::Load(&batch.orientationX[i]);
+		T qy = L::Load(&batch.orientationY[i]);
+		T qz = L::Load(&batch.orientationZ[i]);
+
+		T ux = L::Sub(zero, qx);
+		T uy = L::Sub(zero, qy);
+		T uz = L::Sub(zero, qz);
+
+		T tx = L::Load(&batch.torqueX[i]);
+		T ty = L::Load(&batch.torqueY[i]);
+		T tz = L::Load(&batch.torqueZ[i]);
+
+		T cx = L::Add(L::Sub(L::Mul(uy, tz), L::Mul(uz, ty)), L::Mul(qw, tx));
+		T cy = L::Add(L::Sub(L::Mul(uz, tx), L::Mul(ux, tz)), L::Mul(qw, ty));
+		T cz = L::Add(L::Sub(L::Mul(ux, ty), L::Mul(uy, tx)), L::Mul(qw, tz));
+
+		T wx = L::Load(&batch.angularVelocityX[i]);
+		T wy = L::Load(&batch.angularVelocityY[i]);
+		T wz = L::Load(&batch.angularVelocityZ[i]);
+
+		// The angular damping goes against the angular velocity, also in object space
+		T angularDamping = L::Load(&batch.angularDampings[i]);
+		tx = L::Sub(L::Add(tx, L::Mul(two, L::Sub(L::Mul(uy, cz), L::Mul(uz, cy)))), L::Mul(angularDamping, wx));
+		ty = L::Sub(L::Add(ty, L::Mul(two, L::Sub(L::Mul(uz, cx), L::Mul(ux, cz)))), L::Mul(angularDamping, wy));
+		tz = L::Sub(L::Add(tz, L::Mul(two, L::Sub(L::Mul(ux, cy), L::Mul(uy, cx)))), L::Mul(angularDamping, wz));
+
+		// Euler equations
+		T I1 = L::Load(&batch.inertiaX[i]);
+		T I2 = L::Load(&batch.inertiaY[i]);
+		T I3 = L::Load(&batch.inertiaZ[i]);
+
+		T ax = L::Mul(L::Add(tx, L::Mul(L::Sub(I2, I3), L::Mul(wy, wz))), L::Load(&batch.inverseInertiaX[i]));
+		T ay = L::Mul(L::Add(ty, L::Mul(L::Sub(I3, I1), L::Mul(wx, wz))), L::Load(&batch.inverseInertiaY[i]));
+		T az = L::Mul(L::Add(tz, L::Mul(L::Sub(I1, I2), L::Mul(wx, wy))), L::Load(&batch.inverseInertiaZ[i]));
+
+		wx = L::Add(wx, L::Mul(ax, dt));
+		wy = L::Add(wy, L::Mul(ay, dt));
+		wz = L::Add(wz, L::Mul(az, dt));
+
+		L::Store(&batch.angularVelocityX[i], wx);
+		L::Store(&batch.angularVelocityY[i], wy);
+		L::Store(&batch.angularVelocityZ[i], wz);
+
+		// q += 0.5 * q * (0, w) * dt, then normalized
+		T dqw = L::Sub(zero, L::Add(L::Add(L::Mul(qx, wx), L::Mul(qy, wy)), L::Mul(qz, wz)));
+		T dqx = L::Add(L::Mul(qw, wx), L::Sub(L::Mul(qy, wz), L::Mul(qz, wy)));
+		T dqy = L::Add(L::Mul(qw, wy), L::Sub(L::Mul(qz, wx), L::Mul(qx, wz)));
+		T dqz = L::Add(L::Mul(qw, wz), L::Sub(L::Mul(qx, wy), L::Mul(qy, wx)));
+
+		qw = L::Add(qw, L::Mul(dqw, halfDt));
+		qx = L::Add(qx, L::Mul(dqx, halfDt));
+		qy = L::Add(qy, L::Mul(dqy, halfDt));
+		qz = L::Add(qz, L::Mul(dqz, halfDt));
+
+		T inverseLength = L::InverseSqrt(L::Add(L::Add(L::Mul(qw, qw), L::Mul(qx, qx)), L::Add(L::Mul(qy, qy), L::Mul(qz, qz))));
+
+		L::Store(&batch.orientationW[i], L::Mul(qw, inverseLength));
+		L::Store(&batch.orientationX[i], L::Mul(qx, inverseLength));
+		L::Store(&batch.orientationY[i], L::Mul(qy, inverseLength));
+		L::Store(&batch.orientationZ[i], L::Mul(qz, inverseLength));
+
+		// The forces only last one step
+		L::Store(&batch.forceX[i], zero);
+		L::Store(&batch.forceY[i], zero);
+		L::Store(&batch.forceZ[i], zero);
+		L::Store(&batch.torqueX[i], zero);
+		L::Store(&batch.torqueY[i], zero);
+		L::Store(&batch.torqueZ[i], zero);
+	}
+}
+
+void RigidBodyBatch::Integrate(float deltaTime, int begin, int end)
+{
+	int i = begin;
+
+	// The arrays are aligned, so the SIMD kernels start at an aligned body and use aligned loads
+	const int alignedFloats = RIGID_BODY_BATCH_ALIGNMENT / sizeof(float);
+	IntegrateLanes<ScalarLanes>(*this, i, std::min(end, (begin + alignedFloats - 1) / alignedFloats * alignedFloats), deltaTime);
+
+#if defined(RIGID_BODY_BATCH_AVX)
+	IntegrateLanes<AVXLanes>(*this, i, end, deltaTime);
+#endif
+#if defined(RIGID_BODY_BATCH_AVX) || defined(RIGID_BODY_BATCH_SSE)
+	IntegrateLanes<SSELanes>(*this, i, end, deltaTime);
+#endif
+
+	// Remaining bodies (or all of them without SIMD support)
+	IntegrateLanes<ScalarLanes>(*this, i, end, deltaTime);
+
+	// The orientations changed under the views
+	for (i = begin; i < end; ++i)
+		views[i]->transformDirty = true;
+}
+
+// Every array of the batch, for the operations that treat them all alike
+static AlignedFloats RigidBodyBatch::* const batchArrays[] = {
+	&RigidBodyBatch::positionX, &RigidBodyBatch::positionY, &RigidBodyBatch::positionZ,
+	&RigidBodyBatch::orientationW, &RigidBodyBatch::orientationX, &RigidBodyBatch::orientationY, &RigidBodyBatch::orientationZ,
+	&RigidBodyBatch::velocityX, &RigidBodyBatch::velocityY, &RigidBodyBatch::velocityZ,
+	&RigidBodyBatch::angularVelocityX, &RigidBodyBatch::angularVelocityY, &RigidBodyBatch::angularVelocityZ,
+	&RigidBodyBatch::forceX, &RigidBodyBatch::forceY, &RigidBodyBatch::forceZ,
+	&RigidBodyBatch::torqueX, &RigidBodyBatch::torqueY, &RigidBodyBatch::torqueZ,
+	&RigidBodyBatch::inverseMasses,
+	&RigidBodyBatch::inertiaX, &RigidBodyBatch::inertiaY, &RigidBodyBatch::inertiaZ,
+	&RigidBodyBatch::inverseInertiaX, &RigidBodyBatch::inverseInertiaY, &RigidBodyBatch::inverseInertiaZ,
+	&RigidBodyBatch::dampings, &RigidBodyBatch::angularDampings
+};
+
+RigidBodyHandle RigidBodyBatch::Add(RigidBody* body)
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (unsigned int)slotToIndex.size();
+		slotToIndex.push_back(0);
+		generations.push_back(0);
+	}
+
+	unsigned int index = (unsigned int)Size();
+	slotToIndex[slot] = index;
+	indexToSlot.push_back(slot);
+
+	for (AlignedFloats RigidBodyBatch::* array : batchArrays)
+		(this->*array).push_back(0.f);
+	views.push_back(body);
+
+	SetPosition(index, body->position);
+	SetOrientation(index, body->orientation);
+	SetVelocity(index, body->velocity);
+	SetAngularVelocity(index, body->angularVelocity);
+	SetForce(index, body->force);
+	SetTorque(index, body->torque);
+	UpdateParameters(index);
+
+	RigidBodyHandle handle(slot, generations[slot]);
+	body->batch = this;
+	body->handle = handle;
+
+	return handle;
+}
+
+void RigidBodyBatch::Remove(RigidBodyHandle handle)
+{
+	if (!IsValid(handle)) return;
+
+	unsigned int index = slotToIndex[handle.slot];
+	unsigned int last = (unsigned int)Size() - 1;
+
+	// Give the state back to the body so it can live outside of the batch
+	RigidBody* body = views[index];
+	body->position = GetPosition(index);
+	body->orientation = GetOrientation(index);
+	body->velocity = GetVelocity(index);
+	body->angularVelocity = GetAngularVelocity(index);
+	body->force = GetForce(index);
+	body->torque = GetTorque(index);
+	body->batch = nullptr;
+	body->handle = RigidBodyHandle();
+
+	// Swap with the last element to keep the arrays dense
+	for (AlignedFloats RigidBodyBatch::* array : batchArrays)
+	{
+		AlignedFloats& values = this->*array;
+		values[index] = values[last];
+		values.pop_back();
+	}
+
+	views[index] = views[last];
+	views.pop_back();
+
+	unsigned int movedSlot = indexToSlot[last];
+	indexToSlot[index] = movedSlot;
+	slotToIndex[movedSlot] = index;
+	indexToSlot.pop_back();
+
+	generations[handle.slot]++;
+	freeSlots.push_back(handle.slot);
+}
+
+void RigidBodyBatch::Clear()
+{
+	while (!indexToSlot.empty())
+	{
+		unsigned int slot = indexToSlot.back();
+		Remove(RigidBodyHandle(slot, generations[slot]));
+	}
+}
+
+void RigidBodyBatch::Reserve(int capacity)
+{
+	for (AlignedFloats RigidBodyBatch::* array : batchArrays)
+		(this->*array).reserve(capacity);
+
+	views.reserve(capacity);
+	indexToSlot.reserve(capacity);
+}
+
+bool RigidBodyBatch::IsValid(RigidBodyHandle handle) const
+{
+	return handle.slot < generations.size() && generations[handle.slot] == handle.generation;
+}
+
+void RigidBodyBatch::UpdateParameters(int index)
+{
+	const RigidBody* body = views[index];
+
+	inverseMasses[index] = body->inverseMass;
+
+	inertiaX[index] = body->I1;
+	inertiaY[index] = body->I2;
+	inertiaZ[index] = body->I3;
+
+	inverseInertiaX[index] = body->inverseInertia.x;
+	inverseInertiaY[index] = body->inverseInertia.y;
+	inverseInertiaZ[index] = body->inverseInertia.z;
+
+	dampings[index] = body->damping;
+	angularDampings[index] = body->angularDamping;
+}
+
+void RigidBodyBatch::SetPosition(int index, const glm::vec3& position)
+{
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+}
+
+void RigidBodyBatch::SetOrientation(int index, const glm::quat& orientation)
+{
+	orientationW[index] = orientation.w;
+	orientationX[index] = orientation.x;
+	orientationY[index] = orientation.y;
+	orientationZ[index] = orientation.z;
+}
+
+void RigidBodyBatch::SetVelocity(int index, const glm::vec3& velocity)
+{
+	velocityX[index] = velocity.x;
+	velocityY[index] = velocity.y;
+	velocityZ[index] = velocity.z;
+}
+
+void RigidBodyBatch::SetAngularVelocity(int index, const glm::vec3& angularVelocity)
+{
+	angularVelocityX[index] = angularVelocity.x;
+	angularVelocityY[index] = angularVelocity.y;
+	angularVelocityZ[index] = angularVelocity.z;
+}
+
+void RigidBodyBatch::SetForce(int index, const glm::vec3& force)
+{
+	forceX[index] = force.x;
+	forceY[index] = force.y;
+	forceZ[index] = force.z;
+}
+
+void RigidBodyBatch::SetTorque(int index, const glm::vec3& torque)
+{
+	torqueX[index] = torque.x;
+	torqueY[index] = torque.y;
+	torqueZ[index] = torque.z;
+}
+
+void RigidBodyBatch::ApplyAcceleration(const glm::vec3& acceleration)
+{
+	for (int i = 0; i < Size(); ++i)
+	{
+		// Bodies with an infinite mass do not move, and would take an infinite force
+		if (inverseMasses[i] <= 0.f) continue;
+
+		float mass = 1.f / inverseMasses[i];
+		forceX[i] += acceleration.x * mass;
+		forceY[i] += acceleration.y * mass;
+		forceZ[i] += acceleration.z * mass;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "AlignedAllocator.h"
+#include "SlotMap.h"
+
+#include <vector>
+
+class RigidBody;
+
+#define RIGID_BODY_BATCH_ALIGNMENT 32 // Enough for AVX loads
+
+// Stable reference to a rigid body stored in a RigidBodyBatch
+typedef SlotHandle RigidBodyHandle;
+
+// Allocator for the arrays of the batch, so that the kernels can use aligned loads
+typedef std::vector<float, AlignedAllocator<float, RIGID_BODY_BATCH_ALIGNMENT>> AlignedFloats;
+
+// Structure of arrays storage for rigid bodies, kept dense (swap and pop on removal) as the
+// ParticlePool. The bodies added to it become views over their slot. The ones that use
+// semi-implicit Euler for both the translation and the rotation are integrated by a SIMD kernel,
+// 8 bodies per iteration with AVX and 4 with SSE.
+class RigidBodyBatch
+{
+protected:
+	std::vector<unsigned int> slotToIndex;
+	std::vector<unsigned int> indexToSlot;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeSlots;
+
+public:
+	AlignedFloats positionX, positionY, positionZ;
+	AlignedFloats orientationW, orientationX, orientationY, orientationZ;
+	AlignedFloats velocityX, velocityY, velocityZ;
+	AlignedFloats angularVelocityX, angularVelocityY, angularVelocityZ; // object space
+	AlignedFloats forceX, forceY, forceZ;
+	AlignedFloats torqueX, torqueY, torqueZ; // world space, as in RigidBody
+	AlignedFloats inverseMasses;
+	AlignedFloats inertiaX, inertiaY, inertiaZ; // I1, I2, I3
+	AlignedFloats inverseInertiaX, inverseInertiaY, inverseInertiaZ;
+	AlignedFloats dampings, angularDampings;
+
+	std::vector<RigidBody*> views; // RigidBody objects attached to each dense index
+
+	RigidBodyBatch() = default;
+
+	RigidBodyBatch(const RigidBodyBatch&) = delete;
+	RigidBodyBatch& operator=(const RigidBodyBatch&) = delete;
+
+	RigidBodyHandle Add(RigidBody* body); // Copies the state of the body into the batch and attaches it
+
+	void Remove(RigidBodyHandle handle); // Copies the state back into the body and detaches it
+
+	void Clear();
+
+	void Reserve(int capacity);
+
+	bool IsValid(RigidBodyHandle handle) const;
+
+	inline unsigned int GetIndex(RigidBodyHandle handle) const { return slotToIndex[handle.slot]; }
+
+	inline int Size() const { return (int)positionX.size(); }
+
+	// Integrates the dense range [begin, end) with the SIMD kernel, whatever the integrators of the
+	// bodies are (see RigidBody::IsBatchIntegrated)
+	void Integrate(float deltaTime, int begin, int end);
+
+	void UpdateParameters(int index); // Copies the mass, inertia and damping of the view
+
+	inline glm::vec3 GetPosition(int index) const { return glm::vec3(positionX[index], positionY[index], positionZ[index]); }
+	inline glm::quat GetOrientation(int index) const { return glm::quat(orientationW[index], orientationX[index], orientationY[index], orientationZ[index]); }
+	inline glm::vec3 GetVelocity(int index) const { return glm::vec3(velocityX[index], velocityY[index], velocityZ[index]); }
+	inline glm::vec3 GetAngularVelocity(int index) const { return glm::vec3(angularVelocityX[index], angularVelocityY[index], angularVelocityZ[index]); }
+	inline glm::vec3 GetForce(int index) const { return glm::vec3(forceX[index], forceY[index], forceZ[index]); }
+	inline glm::vec3 GetTorque(int index) const { return glm::vec3(torqueX[index], torqueY[index], torqueZ[index]); }
+
+	void SetPosition(int index, const glm::vec3& position);
+	void SetOrientation(int index, const glm::quat& orientation);
+	void SetVelocity(int index, const glm::vec3& velocity);
+	void SetAngularVelocity(int index, const glm::vec3& angularVelocity); // object space
+	void SetForce(int index, const glm::vec3& force);
+	void SetTorque(int index, const glm::vec3& torque);
+
+	void ApplyAcceleration(const glm::vec3& acceleration); // To every body with mass
+};
\ No newline at end of file
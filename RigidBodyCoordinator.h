@@ -16,12 +16,13 @@ public:
 		orientationOffset = glm::inverse(rigidBody.GetOrientation()) * model.orientation;
 	}
 
-	inline void coordinate(Model* model, PhysicsObject* object) const
+	inline void coordinate(Model* model, PhysicsObject* object, float interpolation = 1.f) const
 	{
 		RigidBody* rigidBody = dynamic_cast<RigidBody*>(object);
 		if (!rigidBody) return;
-		model->position = rigidBody->GetPosition() + rigidBody->GetOrientation() * positionOffset;
-		model->orientation = rigidBody->GetOrientation() * orientationOffset;
+		glm::quat orientation = rigidBody->GetInterpolatedOrientation(interpolation);
+		model->position = rigidBody->GetInterpolatedPosition(interpolation) + orientation * positionOffset;
+		model->orientation = orientation * orientationOffset;
 	}
 };
 
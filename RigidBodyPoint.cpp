@@ -11,12 +11,33 @@ void RigidBodyPoint::AddForce(const glm::vec3& newForce)
 	rigidBody->ApplyForce(newForce, rigidBody->GetOrientation() * point);
 }
 
+void RigidBodyPoint::ApplyImpulse(const glm::vec3& impulse)
+{
+	rigidBody->ApplyImpulse(impulse, rigidBody->GetOrientation() * point);
+}
+
+void RigidBodyPoint::ApplyPositionImpulse(const glm::vec3& positionImpulse)
+{
+	rigidBody->ApplyPositionImpulse(positionImpulse, rigidBody->GetOrientation() * point);
+}
+
 glm::vec3 RigidBodyPoint::GetPosition() const
 {
 	return rigidBody->GetPosition() + rigidBody->GetOrientation() * point;
 }
 
+glm::vec3 RigidBodyPoint::GetInterpolatedPosition(float interpolation) const
+{
+	return rigidBody->GetInterpolatedPosition(interpolation) + rigidBody->GetInterpolatedOrientation(interpolation) * point;
+}
+
 glm::vec3 RigidBodyPoint::GetVelocity() const
 {
 	return rigidBody->GetVelocity() + rigidBody->GetOrientation() * glm::cross(rigidBody->GetLocalAngularVelocity(), point);
+}
+
+float RigidBodyPoint::GetInverseMass(const glm::vec3& direction) const
+{
+	glm::vec3 arm = glm::cross(rigidBody->GetOrientation() * point, direction);
+	return rigidBody->GetInverseMass() + glm::dot(arm, rigidBody->GetWorldInverseInertiaTensor() * arm);
 }
\ No newline at end of file
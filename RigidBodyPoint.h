@@ -13,9 +13,16 @@ public:
 
 	void AddForce(const glm::vec3& newForce) override;
 
+	void ApplyImpulse(const glm::vec3& impulse) override;
+	void ApplyPositionImpulse(const glm::vec3& positionImpulse) override;
+
 	glm::vec3 GetPosition() const override;
 
+	glm::vec3 GetInterpolatedPosition(float interpolation) const override;
+
 	glm::vec3 GetVelocity() const override;
 
+	float GetInverseMass(const glm::vec3& direction) const override; // Linear and angular
+
 	RigidBody* GetRigidBody() const { return rigidBody; }
 };
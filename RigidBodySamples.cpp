@@ -23,6 +23,7 @@ RigidBody CreateRigidBox(
 	float I3 = (1.0f / 12.0f) * mass * (w * w + h * h);
 
 	RigidBody box(mass, I1, I2, I3);
+	box.SetCollider(BoxCollider(size / 2.f));
 
 	return box;
 }
@@ -35,6 +36,7 @@ RigidBody CreateRigidSphere(
 	float I = (2.0f / 5.0f) * mass * radius * radius;
 
 	RigidBody sphere(mass, I, I, I);
+	sphere.SetCollider(SphereCollider(radius));
 
 	return sphere;
 }
@@ -47,6 +49,7 @@ RigidBody CreateVoidRigidSphere(
 	float I = (2.0f / 3.0f) * mass * radius * radius;
 
 	RigidBody sphere(mass, I, I, I);
+	sphere.SetCollider(SphereCollider(radius));
 
 	return sphere;
 }
@@ -65,6 +68,7 @@ RigidBody CreateRigidEllipsoid(
 	float I3 = (1.f / 5.f) * mass * (a * a + b * b);
 
 	RigidBody ellipsoid(mass, I1, I2, I3);
+	ellipsoid.SetCollider(BoxCollider(size)); // Bounding box of the ellipsoid
 
 	return ellipsoid;
 }
@@ -80,6 +84,7 @@ RigidBody CreateRigidCylinder(
 	float I3 = (1.f / 2.f) * mass * radius * radius;
 
 	RigidBody cylinder(mass, I1, I2, I3);
+	cylinder.SetCollider(BoxCollider(glm::vec3(radius, height / 2.f, radius))); // Bounding box along the y axis of the cylinder mesh
 
 	return cylinder;
 }
@@ -101,6 +106,7 @@ RigidBody CreateRigidVoidCylinder(
 	float I3 = (1.f / 2.f) * mass * effRadiusSq;
 
 	RigidBody cylinder(mass, I1, I2, I3);
+	cylinder.SetCollider(BoxCollider(glm::vec3(outerRadius, height / 2.f, outerRadius)));
 
 	return cylinder;
 }
@@ -116,6 +122,7 @@ RigidBody CreateRigidCone(
 	float I3 = (3.f / 10.f) * mass * radius * radius;
 
 	RigidBody cone(mass, I1, I2, I3);
+	cone.SetCollider(BoxCollider(glm::vec3(radius, height / 2.f, radius)));
 
 	return cone;
 }
@@ -0,0 +1,446 @@
+#include "Rope.h"
+
+#include <glm/gtx/norm.hpp>
+
+#include <iostream>
+#include <cfloat>
+
+Rope::Rope() : PhysicsObject(ROPE) {}
+
+Rope::Rope(const glm::vec3& start, const glm::vec3& end, int numParticles, float mass) : PhysicsObject(ROPE)
+{
+	if (numParticles < 2)
+	{
+		std::cout << "A rope needs at least two particles." << std::endl;
+		numParticles = 2;
+	}
+
+	segmentLength = glm::length(end - start) / (float)(numParticles - 1);
+	float particleMass = mass / (float)numParticles;
+
+	// The pool keeps pointers to the particles, so the vector must not reallocate
+	particles.reserve(numParticles);
+	particlePool.Reserve(numParticles);
+
+	for (int i = 0; i < numParticles; ++i)
+	{
+		particles.emplace_back(particleMass);
+		particles.back().SetPosition(start + (end - start) * ((float)i / (float)(numParticles - 1)));
+		particlePool.Add(&particles.back());
+		particles.back().SetMass(particleMass);
+	}
+
+	SetDamping(DEFAULT_ROPE_DAMPING);
+}
+
+void Rope::Update(float deltaTime, int substeps)
+{
+	Integrate(deltaTime, substeps);
+	ApplyAttachmentImpulses();
+}
+
+void Rope::Integrate(float deltaTime, int substeps)
+{
+	ParticlePool& pool = particlePool;
+	int numParticles = pool.Size();
+	if (numParticles == 0) return;
+
+	if (substeps > 1)
+		externalForces = pool.forces;
+
+	// The points were already moved over the whole step, the attached ends start where the points
+	// were and move with them, so that they arrive together if the rope does not pull
+	int endParticles[2] = { 0, numParticles - 1 };
+	for (int end = ROPE_START; end <= ROPE_END; ++end)
+	{
+		attachmentImpulses[end] = glm::vec3(0.f);
+		attachmentPositionImpulses[end] = glm::vec3(0.f);
+
+		if (attachments[end] == nullptr) continue;
+
+		int i = endParticles[end];
+		glm::vec3 velocity = attachments[end]->GetVelocity();
+		pool.positions[i] = attachments[end]->GetPosition() - velocity * deltaTime;
+		pool.velocities[i] = velocity;
+	}
+
+	float substepDeltaTime = deltaTime / substeps;
+	for (int substep = 0; substep < substeps; ++substep)
+	{
+		if (substep > 0)
+			pool.forces = externalForces;
+
+		Step(substepDeltaTime, substeps - substep);
+	}
+
+	impulseDeltaTime = deltaTime;
+}
+
+void Rope::Step(float deltaTime, int remainingSteps)
+{
+	ParticlePool& pool = particlePool;
+	int numParticles = pool.Size();
+
+	startPositions.resize(numParticles);
+	weights.resize(numParticles);
+
+	// The attached ends keep the velocity they had, the forces of the points already acted on them
+	int endParticles[2] = { 0, numParticles - 1 };
+	glm::vec3 endVelocities[2] = { pool.velocities[endParticles[0]], pool.velocities[endParticles[1]] };
+
+	// Prediction with the external forces, as in the XPBD solver of the cloth
+	for (int i = 0; i < numParticles; ++i)
+	{
+		float active = (pool.fixed[i] | !pool.awake[i]) ? 0.f : 1.f;
+		weights[i] = active * pool.inverseMasses[i];
+		startPositions[i] = pool.positions[i];
+
+		glm::vec3 acceleration = (pool.forces[i] - pool.dampings[i] * pool.velocities[i]) * pool.inverseMasses[i];
+		pool.velocities[i] += (active * deltaTime) * acceleration;
+		pool.positions[i] += (active * deltaTime) * pool.velocities[i];
+
+		pool.forces[i] = glm::vec3(0.f);
+	}
+
+	// and weigh what the points resist a pull along the end segments
+	int endNeighbours[2] = { std::min(1, numParticles - 1), std::max(numParticles - 2, 0) };
+	for (int end = ROPE_START; end <= ROPE_END; ++end)
+	{
+		if (attachments[end] == nullptr) continue;
+
+		int i = endParticles[end];
+		pool.velocities[i] = endVelocities[end];
+		pool.positions[i] = startPositions[i] + endVelocities[end] * deltaTime;
+
+		glm::vec3 direction = startPositions[endNeighbours[end]] - startPositions[i];
+		float length = glm::length(direction);
+		weights[i] = length > 0.f ? attachments[end]->GetInverseMass(direction / length) : 0.f;
+	}
+
+	int numSegments = GetNumSegments();
+	double alpha = compliance / ((double)deltaTime * deltaTime);
+	lambdas.assign(numSegments, 0.0);
+
+	SolveSegments(startPositions, alpha);
+
+	for (int iteration = 0; iteration < iterations; ++iteration)
+		if (!ProjectSegments(alpha))
+			break;
+
+	float inverseDeltaTime = 1.f / deltaTime;
+	for (int i = 0; i < numParticles; ++i)
+		if (weights[i] != 0.f)
+			pool.velocities[i] = (pool.positions[i] - startPositions[i]) * inverseDeltaTime;
+
+	// Impulse of the end segments on the attached particles, lambda * grad(C) / h. It also moves the
+	// points in the rest of the step.
+	if (numSegments == 0) return;
+
+	glm::vec3 corrections[2] = {
+		-directions[0] * (float)lambdas[0],
+		directions[numSegments - 1] * (float)lambdas[numSegments - 1]
+	};
+
+	for (int end = ROPE_START; end <= ROPE_END; ++end)
+	{
+		if (attachments[end] == nullptr) continue;
+
+		attachmentImpulses[end] += corrections[end] * inverseDeltaTime;
+		attachmentPositionImpulses[end] += corrections[end] * (float)remainingSteps;
+	}
+}
+
+float Rope::GetStableTimeStep(float deltaTime) const
+{
+	const ParticlePool& pool = particlePool;
+	int numParticles = pool.Size();
+
+	// Speed of each particle over the step, the attached ends move with their points
+	motions.resize(numParticles);
+	for (int i = 0; i < numParticles; ++i)
+	{
+		if (pool.fixed[i] || !pool.awake[i])
+		{
+			motions[i] = glm::vec3(0.f);
+			continue;
+		}
+
+		glm::vec3 acceleration = (pool.forces[i] - pool.dampings[i] * pool.velocities[i]) * pool.inverseMasses[i];
+		motions[i] = pool.velocities[i] + acceleration * deltaTime;
+	}
+
+	if (numParticles > 0 && attachments[ROPE_START] != nullptr)
+		motions[0] = attachments[ROPE_START]->GetVelocity();
+	if (numParticles > 0 && attachments[ROPE_END] != nullptr)
+		motions[numParticles - 1] = attachments[ROPE_END]->GetVelocity();
+
+	// Only the relative motion across a segment turns it, the rest is linear
+	float maxSpeed = 0.f;
+	for (int i = 0; i + 1 < numParticles; ++i)
+	{
+		glm::vec3 difference = pool.positions[i + 1] - pool.positions[i];
+		float length = glm::length(difference);
+		glm::vec3 direction = length > 0.f ? difference / length : glm::vec3(0.f);
+
+		glm::vec3 motion = motions[i + 1] - motions[i];
+		maxSpeed = std::max(maxSpeed, glm::length(motion - direction * glm::dot(motion, direction)));
+	}
+
+	return maxSpeed > 0.f ? ROPE_STEP_MOTION * segmentLength / maxSpeed : FLT_MAX;
+}
+
+void Rope::SolveSegments(const std::vector<glm::vec3>& linearization, double alpha)
+{
+	int numSegments = GetNumSegments();
+	std::vector<glm::vec3>& position = particlePool.positions;
+
+	directions.resize(numSegments);
+	diagonal.resize(numSegments);
+	upper.resize(numSegments);
+	rhs.resize(numSegments);
+
+	// (J W J^T + alpha) dLambda = -C - alpha lambda, with C(x) = C(y) + J (x - y) at the
+	// linearization y. Segment i only shares a particle with i - 1 and i + 1, so the matrix is
+	// tridiagonal.
+	for (int i = 0; i < numSegments; ++i)
+	{
+		glm::vec3 difference = linearization[i + 1] - linearization[i];
+		float length = glm::length(difference);
+		directions[i] = length > 0.f ? difference / length : glm::vec3(0.f);
+
+		glm::vec3 displacement = (position[i + 1] - linearization[i + 1]) - (position[i] - linearization[i]);
+		diagonal[i] = (double)weights[i] + weights[i + 1] + alpha;
+		rhs[i] = (double)segmentLength - length - glm::dot(directions[i], displacement) - alpha * lambdas[i];
+	}
+
+	for (int i = 0; i + 1 < numSegments; ++i)
+		upper[i] = -(double)weights[i + 1] * glm::dot(directions[i], directions[i + 1]);
+
+	// Thomas algorithm. The forward sweep leaves the ratios of the eliminated upper diagonal in
+	// the diagonal, the segments between two fixed particles do not move.
+	for (int i = 0; i < numSegments; ++i)
+	{
+		double pivot = diagonal[i];
+		if (i > 0)
+		{
+			pivot -= upper[i - 1] * diagonal[i - 1];
+			rhs[i] -= upper[i - 1] * rhs[i - 1];
+		}
+
+		if (pivot <= 0.0)
+		{
+			diagonal[i] = 0.0;
+			rhs[i] = 0.0;
+			continue;
+		}
+
+		diagonal[i] = i + 1 < numSegments ? upper[i] / pivot : 0.0;
+		rhs[i] /= pivot;
+	}
+
+	for (int i = numSegments - 2; i >= 0; --i)
+		rhs[i] -= diagonal[i] * rhs[i + 1];
+
+	// dx = W J^T dLambda
+	for (int i = 0; i <= numSegments; ++i)
+	{
+		if (weights[i] == 0.f) continue;
+
+		glm::vec3 correction(0.f);
+		if (i > 0) correction += directions[i - 1] * (float)rhs[i - 1];
+		if (i < numSegments) correction -= directions[i] * (float)rhs[i];
+		position[i] += weights[i] * correction;
+	}
+
+	for (int i = 0; i < numSegments; ++i)
+		lambdas[i] += rhs[i];
+}
+
+bool Rope::ProjectSegments(double alpha)
+{
+	std::vector<glm::vec3>& position = particlePool.positions;
+	projectionPositions = position;
+	projectionLambdas = lambdas;
+
+	double residual = GetResidual(alpha);
+	SolveSegments(position, alpha);
+
+	for (int step = 0; step < ROPE_LINE_SEARCH_STEPS; ++step)
+	{
+		if (GetResidual(alpha) < residual) return true;
+
+		for (int i = 0; i < (int)position.size(); ++i)
+			position[i] = 0.5f * (projectionPositions[i] + position[i]);
+		for (int i = 0; i < (int)lambdas.size(); ++i)
+			lambdas[i] = 0.5 * (projectionLambdas[i] + lambdas[i]);
+	}
+
+	if (GetResidual(alpha) < residual) return true;
+
+	position = projectionPositions;
+	lambdas = projectionLambdas;
+	return false;
+}
+
+double Rope::GetResidual(double alpha) const
+{
+	const std::vector<glm::vec3>& position = particlePool.positions;
+
+	double residual = 0.0;
+	for (int i = 0; i < GetNumSegments(); ++i)
+	{
+		double constraint = glm::length(position[i + 1] - position[i]) - (double)segmentLength + alpha * lambdas[i];
+		residual += constraint * constraint;
+	}
+	return residual;
+}
+
+void Rope::ApplyAttachmentImpulses()
+{
+	for (int end = ROPE_START; end <= ROPE_END; ++end)
+	{
+		if (attachments[end] == nullptr) continue;
+
+		attachments[end]->ApplyImpulse(attachmentImpulses[end]);
+		attachments[end]->ApplyPositionImpulse(attachmentPositionImpulses[end]);
+	}
+}
+
+void Rope::Attach(int end, ApplicationPoint* point)
+{
+	if (end != ROPE_START && end != ROPE_END)
+	{
+		std::cout << "The end " << end << " of the rope is not valid." << std::endl;
+		return;
+	}
+
+	if (point != nullptr && (point == &particles.front() || point == &particles.back()))
+	{
+		std::cout << "A rope can not be attached to itself." << std::endl;
+		return;
+	}
+
+	attachments[end] = point;
+	attachmentImpulses[end] = glm::vec3(0.f);
+	attachmentPositionImpulses[end] = glm::vec3(0.f);
+	SetAwake(true);
+}
+
+void Rope::SetSolverIterations(int newIterations)
+{
+	if (newIterations < 1)
+	{
+		std::cout << "The rope needs at least one iteration." << std::endl;
+		return;
+	}
+
+	iterations = newIterations;
+}
+
+void Rope::SetCompliance(float newCompliance)
+{
+	if (newCompliance < 0.f)
+	{
+		std::cout << "The compliance of the rope can not be negative." << std::endl;
+		return;
+	}
+
+	compliance = newCompliance;
+}
+
+void Rope::SetDamping(float newDamping)
+{
+	if (newDamping < 0.f)
+	{
+		std::cout << "The damping of the rope can not be negative." << std::endl;
+		return;
+	}
+
+	damping = newDamping;
+	for (int i = 0; i < particlePool.Size(); ++i)
+		particlePool.dampings[i] = damping * particlePool.masses[i];
+}
+
+void Rope::ApplyAcceleration(const glm::vec3& acceleration)
+{
+	for (int i = 0; i < particlePool.Size(); ++i)
+		particlePool.forces[i] += acceleration * particlePool.masses[i];
+}
+
+float Rope::GetLength() const
+{
+	float length = 0.f;
+	for (int i = 0; i < GetNumSegments(); ++i)
+		length += glm::length(particlePool.positions[i + 1] - particlePool.positions[i]);
+	return length;
+}
+
+glm::vec3 Rope::GetPosition() const
+{
+	glm::vec3 position(0.f);
+	float mass = 0.f;
+	for (int i = 0; i < particlePool.Size(); ++i)
+	{
+		position += particlePool.positions[i] * particlePool.masses[i];
+		mass += particlePool.masses[i];
+	}
+	return mass > 0.f ? position / mass : position;
+}
+
+float Rope::GetMass() const
+{
+	float mass = 0.f;
+	for (int i = 0; i < particlePool.Size(); ++i)
+		if (!particlePool.fixed[i])
+			mass += particlePool.masses[i];
+	return mass;
+}
+
+float Rope::GetKineticEnergy() const
+{
+	float energy = 0.f;
+	for (int i = 0; i < particlePool.Size(); ++i)
+		if (!particlePool.fixed[i])
+			energy += 0.5f * particlePool.masses[i] * glm::length2(particlePool.velocities[i]);
+	return energy;
+}
+
+void Rope::SetAwake(bool newAwake)
+{
+	awake = newAwake;
+	restingFrames = 0;
+	particlePool.SetAwake(newAwake);
+}
+
+bool Rope::HasParticle(const Particle* particle) const
+{
+	return particle->GetPool() == &particlePool;
+}
+
+Particle* Rope::GetParticleAt(glm::vec3 position)
+{
+	const std::vector<glm::vec3>& positions = particlePool.positions;
+
+	float minDistance = glm::length2(positions[0] - position);
+	int index = 0;
+
+	for (int i = 1; i < (int)positions.size(); ++i)
+	{
+		float distance = glm::length2(positions[i] - position);
+		if (distance < minDistance)
+		{
+			minDistance = distance;
+			index = i;
+		}
+	}
+
+	return particlePool.views[index];
+}
+
+Rope* ToRope(PhysicsObject* object)
+{
+	if (object->GetType() == ROPE)
+		return static_cast<Rope*>(object);
+
+	return nullptr;
+}
\ No newline at end of file
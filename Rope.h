@@ -0,0 +1,136 @@
+#pragma once
+
+#include "PhysicsObject.h"
+#include "Particle.h"
+#include "ApplicationPoint.h"
+
+#include <vector>
+#include <algorithm>
+
+enum
+{
+	ROPE_START, // First particle
+	ROPE_END // Last particle
+};
+
+#define DEFAULT_ROPE_ITERATIONS 2 // Projections of the stretch left by the linear solve, per step
+#define DEFAULT_ROPE_COMPLIANCE 0.f // Inextensible
+#define DEFAULT_ROPE_DAMPING 0.1f // Drag per unit of mass, the links are light
+#define ROPE_LINE_SEARCH_STEPS 4 // Halvings of a projection that does not reduce the stretch
+#define ROPE_STEP_MOTION 0.1f // Fraction of its length a segment may turn in a step, see GetStableTimeStep
+
+// Chain of particles joined by distance constraints. Every segment is solved at once (XPBD with
+// all the multipliers together): the system of a chain is tridiagonal, so a direct solve (Thomas)
+// is O(n) and the tension crosses the whole rope in a single step however many links it has.
+//
+// The constraints are first linearized at the start of the step, where they hold, and the second
+// order stretch left is projected out afterwards (Newton steps, halved until they reduce it).
+// This only converges while the segments turn a small part of their length per step: a straight
+// taut chain can not bend to first order, so a rope that bends fast takes substeps
+// (GetStableTimeStep). Very fine ropes that whip, or that hold far heavier bodies, can need more
+// substeps than the physics system allows, and then stretch until they slow down.
+//
+// Each end can be attached to an application point, usually a RigidBodyPoint. The attached
+// particle moves with the point, weighs the inverse mass of the point along the end segment, and
+// the impulse of the rope is applied back to the point at the end of the step, moving it as the
+// particle moved.
+class Rope : public PhysicsObject
+{
+protected:
+	float segmentLength = 0.f;
+	float compliance = DEFAULT_ROPE_COMPLIANCE;
+	float damping = DEFAULT_ROPE_DAMPING;
+	int iterations = DEFAULT_ROPE_ITERATIONS;
+
+	ApplicationPoint* attachments[2] = { nullptr, nullptr };
+	// Applied by ApplyAttachmentImpulses
+	glm::vec3 attachmentImpulses[2] = { glm::vec3(0.f), glm::vec3(0.f) };
+	glm::vec3 attachmentPositionImpulses[2] = { glm::vec3(0.f), glm::vec3(0.f) };
+	float impulseDeltaTime = 0.f; // Step in which the impulses were found
+
+	// The rope sleeps as a whole, as the cloths
+	bool awake = true;
+	int restingFrames = 0;
+
+	std::vector<glm::vec3> externalForces; // Kept for every substep
+
+	// Scratch of the step, per particle and per segment
+	std::vector<glm::vec3> startPositions;
+	std::vector<float> weights;
+	std::vector<glm::vec3> directions;
+	// Tridiagonal system of the segments. Its condition grows with the square of the number of
+	// segments, so it is solved in double precision.
+	std::vector<double> lambdas;
+	std::vector<double> diagonal, upper, rhs;
+	std::vector<glm::vec3> projectionPositions; // Before the current projection
+	std::vector<double> projectionLambdas;
+	mutable std::vector<glm::vec3> motions; // Of the particles, in GetStableTimeStep
+
+	void Step(float deltaTime, int remainingSteps); // remainingSteps counts this one
+
+	// Solves the segments linearized at the given positions, moves the particles and accumulates
+	// the multipliers
+	void SolveSegments(const std::vector<glm::vec3>& linearization, double alpha);
+
+	bool ProjectSegments(double alpha); // False if the stretch could not be reduced
+	double GetResidual(double alpha) const; // Sum of the squared constraints
+
+public:
+	ParticlePool particlePool; // Storage of the particles state, the particles are views over it
+	std::vector<Particle> particles; // From the start to the end of the rope
+
+	Rope();
+	Rope(const glm::vec3& start, const glm::vec3& end, int numParticles, float mass = 1.f);
+
+	void Update(float deltaTime, int substeps = 1); // Integrate and ApplyAttachmentImpulses
+
+	void Integrate(float deltaTime, int substeps = 1); // The external forces act during every substep
+
+	// Largest step in which no segment turns more than ROPE_STEP_MOTION of its length, from the
+	// current velocities and external forces
+	float GetStableTimeStep(float deltaTime) const;
+
+	// Separated from the integration, so that ropes attached to the same body can be integrated in
+	// parallel
+	void ApplyAttachmentImpulses();
+
+	void Attach(int end, ApplicationPoint* point); // ROPE_START or ROPE_END, nullptr detaches it
+	inline ApplicationPoint* GetAttachment(int end) const { return attachments[end]; }
+	inline glm::vec3 GetAttachmentImpulse(int end) const { return attachmentImpulses[end]; } // Of the last step, on the point
+	inline glm::vec3 GetAttachmentForce(int end) const { return impulseDeltaTime > 0.f ? attachmentImpulses[end] / impulseDeltaTime : glm::vec3(0.f); } // Mean of the last step
+
+	void SetSolverIterations(int iterations);
+	inline int GetSolverIterations() const { return iterations; }
+
+	void SetCompliance(float compliance); // Inverse of the stiffness of the segments, 0 is inextensible
+	inline float GetCompliance() const { return compliance; }
+
+	void SetDamping(float damping); // Per unit of mass, so it does not depend on the number of particles
+	inline float GetDamping() const { return damping; }
+
+	void ApplyAcceleration(const glm::vec3& acceleration);
+
+	inline int GetNumberOfParticles() const { return particlePool.Size(); }
+	inline int GetNumSegments() const { return std::max(particlePool.Size() - 1, 0); }
+	inline float GetSegmentLength() const { return segmentLength; }
+	float GetLength() const; // Current length along the particles
+
+	inline Particle& GetParticle(int index) { return particles[index]; }
+
+	glm::vec3 GetPosition() const; // Center of mass
+
+	float GetMass() const; // Mass of the particles that are not fixed
+	float GetKineticEnergy() const;
+
+	inline bool IsAwake() const { return awake; }
+	void SetAwake(bool awake);
+
+	inline int GetRestingFrames() const { return restingFrames; }
+	inline void SetRestingFrames(int frames) { restingFrames = frames; }
+
+	bool HasParticle(const Particle* particle) const;
+
+	Particle* GetParticleAt(glm::vec3 position); // Nearest particle
+};
+
+Rope* ToRope(PhysicsObject* object);
\ No newline at end of file
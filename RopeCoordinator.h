@@ -0,0 +1,59 @@
+#pragma once
+#include "Coordinator.h"
+#include "Rope.h"
+
+// Places the rings of a mesh from CreateRopeMesh around the particles of the rope
+class RopeCoordinator : public Coordinator
+{
+protected:
+	float radius;
+
+public:
+	RopeCoordinator(float radius) : radius(radius) {}
+
+	void coordinate(Model* model, PhysicsObject* object, float interpolation = 1.f) const
+	{
+		Rope* rope = ToRope(object);
+		if (!rope) return;
+
+		Mesh* mesh = model->GetMesh();
+
+		int numParticles = rope->GetNumberOfParticles();
+		int sectorCount = mesh->GetNumVertices() / numParticles;
+		float sectorStep = 2.f * glm::pi<float>() / sectorCount;
+
+		// The frame of each ring is the previous one projected on the plane of the new tangent, so
+		// the tube does not twist
+		glm::vec3 normal(0.f);
+
+		for (int i = 0; i < numParticles; ++i)
+		{
+			glm::vec3 position = rope->particlePool.GetInterpolatedPosition(i, interpolation);
+			glm::vec3 previous = rope->particlePool.GetInterpolatedPosition(std::max(i - 1, 0), interpolation);
+			glm::vec3 next = rope->particlePool.GetInterpolatedPosition(std::min(i + 1, numParticles - 1), interpolation);
+
+			glm::vec3 tangent = next - previous;
+			tangent = glm::length(tangent) > 0.f ? glm::normalize(tangent) : glm::vec3(0.f, 1.f, 0.f);
+
+			normal -= tangent * glm::dot(normal, tangent);
+			if (glm::length(normal) < 1E-3f)
+				normal = glm::cross(tangent, fabsf(tangent.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f));
+			normal = glm::normalize(normal);
+
+			glm::vec3 binormal = glm::cross(tangent, normal);
+
+			for (int j = 0; j < sectorCount; ++j)
+			{
+				glm::vec3 direction = std::cos(j * sectorStep) * normal + std::sin(j * sectorStep) * binormal;
+
+				mesh->vertices[i * sectorCount + j].position = position + radius * direction;
+				mesh->vertices[i * sectorCount + j].normal = direction;
+			}
+		}
+
+		// apply the changes
+		mesh->Update();
+
+		model->SetContent(mesh);
+	}
+};
\ No newline at end of file
@@ -268,11 +268,6 @@ bool AABBAABB(const AABB& aabb1, const AABB& aabb2)
 }
 
 
-struct Interval
-{
-	float min, max;
-};
-
 Interval GetInterval(const AABB& aabb, const glm::vec3& axis)
 {
 	glm::vec3 i = GetMin(aabb);
@@ -398,7 +393,7 @@ bool AABBPlane(const AABB& aabb, const Plane& plane)
 bool OverlapOnAxis(const OBB& obb1, const OBB& obb2, const glm::vec3& axis)
 {
 	Interval a = GetInterval(obb1, axis);
-	Interval b = GetInterval(obb1, axis);
+	Interval b = GetInterval(obb2, axis);
 	return ((b.min <= a.max) && (a.min <= b.max));
 }
 
@@ -1389,4 +1384,5 @@ void ResetRaycastResult(RaycastResult* outResult)
 	outResult->hit = false;
 	outResult->normal = glm::vec3(0.f, 0.f, 1.f);
 	outResult->point = glm::vec3(0.f, 0.f, 0.f);
+	outResult->triangle = -1;
 }
\ No newline at end of file
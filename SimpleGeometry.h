@@ -59,6 +59,7 @@ struct RaycastResult
 	glm::vec3 normal;
 	float t;
 	bool hit;
+	int triangle; // Of the mesh hit, -1 for the other shapes
 };
 
 void ResetRaycastResult(RaycastResult* outResult);
@@ -212,6 +213,16 @@ bool OBBPlane(const OBB& obb, const Plane& plane);
 
 bool PlanePlane(const Plane& plane1, const Plane& plane2);
 
+// Projection of a shape on an axis (SAT)
+struct Interval
+{
+	float min, max;
+};
+
+Interval GetInterval(const AABB& aabb, const glm::vec3& axis);
+
+Interval GetInterval(const OBB& obb, const glm::vec3& axis);
+
 // LINE INTERSECTIONS
 
 float Raycast(const Sphere& sphere, const Ray& ray);
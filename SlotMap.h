@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+
+#define INVALID_SLOT 0xFFFFFFFF
+
+// Stable reference to an element of a slot map. The slot never moves even when the elements
+// are compacted, and the generation detects handles to removed elements.
+struct SlotHandle
+{
+	unsigned int slot;
+	unsigned int generation;
+
+	inline SlotHandle() : slot(INVALID_SLOT), generation(0) {}
+
+	inline SlotHandle(unsigned int slot, unsigned int generation) : slot(slot), generation(generation) {}
+
+	inline bool operator==(const SlotHandle& other) const { return slot == other.slot && generation == other.generation; }
+	inline bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Dense array of elements with O(1) insertion, removal and lookup through handles. Removing
+// an element moves the last one into its place, so the dense order is not preserved.
+template <typename T>
+class SlotMap
+{
+protected:
+	std::vector<T> items;
+
+	std::vector<unsigned int> slotToIndex;
+	std::vector<unsigned int> indexToSlot;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeSlots;
+
+public:
+	SlotHandle Add(const T& item)
+	{
+		unsigned int slot;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			slot = (unsigned int)slotToIndex.size();
+			slotToIndex.push_back(0);
+			generations.push_back(0);
+		}
+
+		slotToIndex[slot] = (unsigned int)items.size();
+		indexToSlot.push_back(slot);
+		items.push_back(item);
+
+		return SlotHandle(slot, generations[slot]);
+	}
+
+	// Returns false if the handle was not valid
+	bool Remove(SlotHandle handle)
+	{
+		if (!IsValid(handle)) return false;
+
+		unsigned int index = slotToIndex[handle.slot];
+		unsigned int last = (unsigned int)items.size() - 1;
+
+		if (index != last)
+		{
+			items[index] = items[last];
+
+			unsigned int movedSlot = indexToSlot[last];
+			indexToSlot[index] = movedSlot;
+			slotToIndex[movedSlot] = index;
+		}
+
+		items.pop_back();
+		indexToSlot.pop_back();
+
+		generations[handle.slot]++;
+		freeSlots.push_back(handle.slot);
+		return true;
+	}
+
+	void Clear()
+	{
+		for (unsigned int slot : indexToSlot)
+		{
+			generations[slot]++;
+			freeSlots.push_back(slot);
+		}
+
+		items.clear();
+		indexToSlot.clear();
+	}
+
+	void Reserve(int capacity)
+	{
+		items.reserve(capacity);
+		indexToSlot.reserve(capacity);
+	}
+
+	inline bool IsValid(SlotHandle handle) const
+	{
+		return handle.slot < generations.size() && generations[handle.slot] == handle.generation;
+	}
+
+	inline unsigned int GetIndex(SlotHandle handle) const { return slotToIndex[handle.slot]; }
+	inline SlotHandle GetHandle(int index) const { return SlotHandle(indexToSlot[index], generations[indexToSlot[index]]); }
+
+	inline T& Get(SlotHandle handle) { return items[slotToIndex[handle.slot]]; }
+	inline const T& Get(SlotHandle handle) const { return items[slotToIndex[handle.slot]]; }
+
+	// Dense access, the index of an element changes when another one is removed
+	inline T& operator[](int index) { return items[index]; }
+	inline const T& operator[](int index) const { return items[index]; }
+
+	inline const std::vector<T>& GetItems() const { return items; }
+
+	inline int Size() const { return (int)items.size(); }
+	inline bool Empty() const { return items.empty(); }
+
+	inline typename std::vector<T>::iterator begin() { return items.begin(); }
+	inline typename std::vector<T>::iterator end() { return items.end(); }
+	inline typename std::vector<T>::const_iterator begin() const { return items.begin(); }
+	inline typename std::vector<T>::const_iterator end() const { return items.end(); }
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "SpatialHash.h"
+
+#include <glm/gtx/norm.hpp>
+
+void SpatialHash::Build(const std::vector<glm::vec3>& positions, float newCellSize)
+{
+	cellSize = newCellSize;
+	inverseCellSize = 1.f / newCellSize;
+
+	// About two buckets per point keeps the collisions low
+	unsigned int tableSize = 1;
+	while (tableSize < 2 * positions.size())
+		tableSize <<= 1;
+	tableMask = tableSize - 1;
+
+	bucketStarts.assign(tableSize + 1, 0);
+	entries.resize(positions.size());
+
+	if (!positions.empty())
+		min = max = positions[0];
+
+	std::vector<unsigned int> buckets(positions.size());
+	for (int i = 0; i < (int)positions.size(); ++i)
+	{
+		const glm::vec3& p = positions[i];
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+		buckets[i] = GetBucket(GetCell(p.x), GetCell(p.y), GetCell(p.z));
+		bucketStarts[buckets[i]]++;
+	}
+
+	// Counting sort: the starts end up as the first entry of each bucket
+	int start = 0;
+	for (unsigned int b = 0; b <= tableSize; ++b)
+	{
+		start += bucketStarts[b];
+		bucketStarts[b] = start;
+	}
+
+	for (int i = 0; i < (int)positions.size(); ++i)
+		entries[--bucketStarts[buckets[i]]] = i;
+}
+
+void SpatialHash::Clear()
+{
+	bucketStarts.clear();
+	entries.clear();
+	tableMask = 0;
+}
+
+int SpatialHash::FindNearest(const std::vector<glm::vec3>& positions, const glm::vec3& position, float radius) const
+{
+	int nearest = -1;
+	float minDistance = radius * radius;
+
+	ForEachNear(position, radius, [&](int i) {
+		float distance = glm::length2(positions[i] - position);
+		if (distance <= minDistance)
+		{
+			minDistance = distance;
+			nearest = i;
+		}
+	});
+
+	return nearest;
+}
\ No newline at end of file
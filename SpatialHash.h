@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Uniform grid of cubic cells hashed into a table of buckets, over a set of points given by
+// index. The table is rebuilt from scratch with a counting sort, so it suits points that move
+// every step (Teschner et al.). Different cells may share a bucket, so the queries return
+// candidates that must still be checked against the distance.
+class SpatialHash
+{
+protected:
+	float cellSize = 1.f;
+	float inverseCellSize = 1.f;
+	unsigned int tableMask = 0; // Size of the table - 1, a power of two
+	glm::vec3 min = glm::vec3(0.f); // Bounds of the points
+	glm::vec3 max = glm::vec3(0.f);
+
+	std::vector<int> bucketStarts; // Points of bucket b are entries[bucketStarts[b], bucketStarts[b + 1])
+	std::vector<int> entries;
+
+	inline unsigned int GetBucket(int x, int y, int z) const
+	{
+		return (((unsigned int)x * 92837111u) ^ ((unsigned int)y * 689287499u) ^ ((unsigned int)z * 283923481u)) & tableMask;
+	}
+
+	inline int GetCell(float coordinate) const { return (int)floorf(coordinate * inverseCellSize); }
+
+public:
+	void Build(const std::vector<glm::vec3>& positions, float cellSize);
+
+	void Clear();
+
+	inline float GetCellSize() const { return cellSize; }
+	inline bool Empty() const { return entries.empty(); }
+	inline glm::vec3 GetMin() const { return min; }
+	inline glm::vec3 GetMax() const { return max; }
+
+	// Calls function(index) once for every point in the buckets of the cells that overlap the
+	// sphere, which includes all the points inside it
+	template <typename Function>
+	void ForEachNear(const glm::vec3& position, float radius, Function function) const
+	{
+		if (entries.empty()) return;
+
+		int minX = GetCell(position.x - radius), maxX = GetCell(position.x + radius);
+		int minY = GetCell(position.y - radius), maxY = GetCell(position.y + radius);
+		int minZ = GetCell(position.z - radius), maxZ = GetCell(position.z + radius);
+
+		// Cells sharing a bucket are only visited once (for the 27 cells of a radius up to the cell size)
+		unsigned int visited[27];
+		int numVisited = 0;
+
+		for (int x = minX; x <= maxX; ++x)
+		for (int y = minY; y <= maxY; ++y)
+		for (int z = minZ; z <= maxZ; ++z)
+		{
+			unsigned int bucket = GetBucket(x, y, z);
+
+			bool repeated = false;
+			for (int i = 0; i < numVisited && !repeated; ++i)
+				repeated = visited[i] == bucket;
+			if (repeated) continue;
+			if (numVisited < 27) visited[numVisited++] = bucket;
+
+			for (int i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; ++i)
+				function(entries[i]);
+		}
+	}
+
+	// Calls function(index) for every point in the buckets of the cells that overlap the box. The
+	// box is clipped to the bounds of the points, but large boxes may still report a point more
+	// than once.
+	template <typename Function>
+	void ForEachInBox(const glm::vec3& boxMin, const glm::vec3& boxMax, Function function) const
+	{
+		if (entries.empty()) return;
+
+		glm::vec3 clippedMin = glm::max(boxMin, min);
+		glm::vec3 clippedMax = glm::min(boxMax, max);
+		if (clippedMin.x > clippedMax.x || clippedMin.y > clippedMax.y || clippedMin.z > clippedMax.z) return;
+
+		int minX = GetCell(clippedMin.x), maxX = GetCell(clippedMax.x);
+		int minY = GetCell(clippedMin.y), maxY = GetCell(clippedMax.y);
+		int minZ = GetCell(clippedMin.z), maxZ = GetCell(clippedMax.z);
+
+		for (int x = minX; x <= maxX; ++x)
+		for (int y = minY; y <= maxY; ++y)
+		for (int z = minZ; z <= maxZ; ++z)
+		{
+			unsigned int bucket = GetBucket(x, y, z);
+			for (int i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; ++i)
+				function(entries[i]);
+		}
+	}
+
+	// Closest point within the radius, -1 if there is none
+	int FindNearest(const std::vector<glm::vec3>& positions, const glm::vec3& position, float radius) const;
+};
\ No newline at end of file
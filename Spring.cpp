@@ -39,18 +39,18 @@ void Spring::applyForce()
 }
 
 
-glm::vec3 GetSpringRelativePositions(const Spring& spring)
+glm::vec3 GetSpringRelativePositions(const Spring& spring, float interpolation)
 {
-	glm::vec3 p1 = spring.p1->GetPosition();
-	glm::vec3 p2 = spring.p2->GetPosition();
+	glm::vec3 p1 = spring.p1->GetInterpolatedPosition(interpolation);
+	glm::vec3 p2 = spring.p2->GetInterpolatedPosition(interpolation);
 
 	return p2 - p1;
 }
 
-glm::vec3 GetSpringCenter(const Spring& spring)
+glm::vec3 GetSpringCenter(const Spring& spring, float interpolation)
 {
-	glm::vec3 p1 = spring.p1->GetPosition();
-	glm::vec3 p2 = spring.p2->GetPosition();
+	glm::vec3 p1 = spring.p1->GetInterpolatedPosition(interpolation);
+	glm::vec3 p2 = spring.p2->GetInterpolatedPosition(interpolation);
 	return (p1 + p2) * 0.5f;
 }
 
@@ -39,12 +39,13 @@ public:
 //	template<typename T1, typename T2>
 //	void computeForce(T1* p1, T2* p2);
 	friend class PhysicsSystem;
-	friend glm::vec3 GetSpringRelativePositions(const Spring& spring);
-	friend glm::vec3 GetSpringCenter(const Spring& spring);
+	friend glm::vec3 GetSpringRelativePositions(const Spring& spring, float interpolation);
+	friend glm::vec3 GetSpringCenter(const Spring& spring, float interpolation);
 };
 
-glm::vec3 GetSpringRelativePositions(const Spring& spring);
+// interpolation blends the previous (0) and current (1) positions of the ends
+glm::vec3 GetSpringRelativePositions(const Spring& spring, float interpolation = 1.f);
 
-glm::vec3 GetSpringCenter(const Spring& spring);
+glm::vec3 GetSpringCenter(const Spring& spring, float interpolation = 1.f);
 
 Spring* ToSpring(PhysicsObject* object);
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "SpringColoring.h"
+#include "RigidBodyPoint.h"
+
+#include <unordered_map>
+
+const void* GetForceTarget(const ApplicationPoint* point)
+{
+	if (point == nullptr) return nullptr;
+
+	switch (point->GetType())
+	{
+	case PARTICLE:
+		return point;
+
+	case RIGID_BODY_POINT:
+		// Every point of a rigid body adds its force to the same body
+		return static_cast<const RigidBodyPoint*>(point)->GetRigidBody();
+	}
+
+	return nullptr; // A plain application point ignores the forces
+}
+
+void SpringColoring::Build(const std::vector<Spring*>& springs)
+{
+	Build((int)springs.size(), [&springs](int i, const void*& target1, const void*& target2) {
+		target1 = GetForceTarget(springs[i]->GetPoint1());
+		target2 = GetForceTarget(springs[i]->GetPoint2());
+	});
+}
+
+void SpringColoring::Build(int numSprings, const std::function<void(int, const void*&, const void*&)>& getTargets)
+{
+	colors.clear();
+
+	// Colors already used by the springs attached to each object
+	std::unordered_map<const void*, std::vector<bool>> usedColors;
+	usedColors.reserve(2 * numSprings);
+
+	for (int i = 0; i < numSprings; ++i)
+	{
+		const void* target1;
+		const void* target2;
+		getTargets(i, target1, target2);
+
+		std::vector<bool>* used1 = target1 ? &usedColors[target1] : nullptr;
+		std::vector<bool>* used2 = target2 ? &usedColors[target2] : nullptr;
+
+		// Greedy: first color free in both ends
+		int color = 0;
+		while (
+			(used1 && color < used1->size() && (*used1)[color]) ||
+			(used2 && color < used2->size() && (*used2)[color])
+		)
+			color++;
+
+		if (color >= colors.size())
+			colors.resize(color + 1);
+		colors[color].push_back(i);
+
+		if (used1)
+		{
+			if (color >= used1->size()) used1->resize(color + 1, false);
+			(*used1)[color] = true;
+		}
+		if (used2)
+		{
+			if (color >= used2->size()) used2->resize(color + 1, false);
+			(*used2)[color] = true;
+		}
+	}
+
+	dirty = false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Spring.h"
+
+#include <functional>
+#include <vector>
+
+// Partition of a list of springs in colors such that two springs of the same color never write
+// their force into the same object. The springs of one color can be applied in parallel.
+class SpringColoring
+{
+protected:
+	std::vector<std::vector<int>> colors; // spring indices of each color
+	bool dirty = true;
+
+public:
+	void Build(const std::vector<Spring*>& springs);
+
+	// getTargets(i, target1, target2) gives the objects that receive the force of the spring i
+	void Build(int numSprings, const std::function<void(int, const void*&, const void*&)>& getTargets);
+
+	inline void Invalidate() { dirty = true; }
+	inline bool IsDirty() const { return dirty; }
+
+	inline int GetNumColors() const { return (int)colors.size(); }
+	inline const std::vector<int>& GetColor(int color) const { return colors[color]; }
+};
+
+// Object that receives the force applied to an application point (nullptr if none)
+const void* GetForceTarget(const ApplicationPoint* point);
\ No newline at end of file
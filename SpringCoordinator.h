@@ -5,13 +5,13 @@
 class SpringCoordinator : public Coordinator
 {
 public:
-	void coordinate(Model* model, PhysicsObject* physics) const override
+	void coordinate(Model* model, PhysicsObject* physics, float interpolation = 1.f) const override
 	{
 		Spring* spring = ToSpring(physics);
 		if (!spring) return;
 
-		glm::vec3 relativePos = GetSpringRelativePositions(*spring);
-		model->position = GetSpringCenter(*spring);
+		glm::vec3 relativePos = GetSpringRelativePositions(*spring, interpolation);
+		model->position = GetSpringCenter(*spring, interpolation);
 		model->orientation = glm::quat(glm::vec3(0.f, 1.f, 0.f), relativePos);
 		model->scale.y = glm::length(relativePos);
 	}
@@ -0,0 +1,146 @@
+#include "SweepAndPrune.h"
+
+#include <algorithm>
+
+int SweepAndPrune::AddProxy(const AABB& bounds, RigidBody* body)
+{
+	int proxy;
+	if (!freeProxies.empty())
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = (int)proxies.size();
+		proxies.push_back(SweepAndPruneProxy());
+	}
+
+	proxies[proxy].min = GetMin(bounds);
+	proxies[proxy].max = GetMax(bounds);
+	proxies[proxy].body = body;
+	proxies[proxy].active = true;
+
+	// The next sort moves it to its place
+	order.push_back(proxy);
+
+	return proxy;
+}
+
+void SweepAndPrune::RemoveProxy(int proxy)
+{
+	if (proxy < 0 || proxy >= proxies.size() || !proxies[proxy].active) return;
+
+	// Erasing it from the order would be linear, so it is skipped until the next sweep
+	proxies[proxy].active = false;
+	proxies[proxy].body = nullptr;
+	removedProxies.push_back(proxy);
+}
+
+void SweepAndPrune::RemoveInactive()
+{
+	if (removedProxies.empty()) return;
+
+	order.erase(
+		std::remove_if(order.begin(), order.end(), [this](int proxy) { return !proxies[proxy].active; }),
+		order.end()
+	);
+
+	freeProxies.insert(freeProxies.end(), removedProxies.begin(), removedProxies.end());
+	removedProxies.clear();
+}
+
+void SweepAndPrune::MoveProxy(int proxy, const AABB& bounds)
+{
+	proxies[proxy].min = GetMin(bounds);
+	proxies[proxy].max = GetMax(bounds);
+}
+
+void SweepAndPrune::ChooseAxis()
+{
+	int n = (int)order.size();
+	if (n < 2) return;
+
+	glm::vec3 sum(0.f);
+	glm::vec3 sumSq(0.f);
+	for (int proxy : order)
+	{
+		glm::vec3 center = 0.5f * (proxies[proxy].min + proxies[proxy].max);
+		sum += center;
+		sumSq += center * center;
+	}
+
+	glm::vec3 variance = sumSq - sum * sum / (float)n;
+
+	axis = 0;
+	if (variance.y > variance[axis]) axis = 1;
+	if (variance.z > variance[axis]) axis = 2;
+}
+
+void SweepAndPrune::SortOrder()
+{
+	// Insertion sort: the order of the previous frame is almost sorted
+	for (int i = 1; i < order.size(); ++i)
+	{
+		int proxy = order[i];
+		float key = proxies[proxy].min[axis];
+
+		int j = i - 1;
+		while (j >= 0 && proxies[order[j]].min[axis] > key)
+		{
+			order[j + 1] = order[j];
+			j--;
+		}
+		order[j + 1] = proxy;
+	}
+}
+
+void SweepAndPrune::FindPairs(std::vector<BroadphasePair>& outPairs)
+{
+	outPairs.clear();
+
+	RemoveInactive();
+	ChooseAxis();
+	SortOrder();
+
+	int axis1 = (axis + 1) % 3;
+	int axis2 = (axis + 2) % 3;
+
+	for (int i = 0; i < order.size(); ++i)
+	{
+		const SweepAndPruneProxy& a = proxies[order[i]];
+
+		// Only the proxies that start before this one ends can overlap it
+		for (int j = i + 1; j < order.size(); ++j)
+		{
+			const SweepAndPruneProxy& b = proxies[order[j]];
+			if (b.min[axis] > a.max[axis]) break;
+
+			if (a.max[axis1] < b.min[axis1] || b.max[axis1] < a.min[axis1]) continue;
+			if (a.max[axis2] < b.min[axis2] || b.max[axis2] < a.min[axis2]) continue;
+
+			outPairs.push_back(BroadphasePair(a.body, b.body));
+		}
+	}
+}
+
+void SweepAndPrune::Query(const AABB& bounds, std::vector<RigidBody*>& outBodies)
+{
+	outBodies.clear();
+
+	glm::vec3 min = GetMin(bounds);
+	glm::vec3 max = GetMax(bounds);
+
+	// The proxies added since the last sort are not in their place yet, so the order can not be
+	// swept and every proxy is tested
+	for (const SweepAndPruneProxy& proxy : proxies)
+	{
+		if (!proxy.active) continue;
+
+		if (proxy.max.x < min.x || max.x < proxy.min.x) continue;
+		if (proxy.max.y < min.y || max.y < proxy.min.y) continue;
+		if (proxy.max.z < min.z || max.z < proxy.min.z) continue;
+
+		outBodies.push_back(proxy.body);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Broadphase.h"
+
+struct SweepAndPruneProxy
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	RigidBody* body;
+	bool active;
+};
+
+// Sorts the bounds along the axis where the bodies are most spread and sweeps them, testing
+// only the bounds that overlap along that axis. The order is kept between frames, so the
+// insertion sort is close to linear when the bodies move little.
+class SweepAndPrune : public Broadphase
+{
+protected:
+	std::vector<SweepAndPruneProxy> proxies;
+	std::vector<int> freeProxies;
+	std::vector<int> removedProxies; // Still in the order until the next FindPairs
+	std::vector<int> order; // Proxies sorted by their minimum along the sweep axis
+	int axis = 0;
+
+	void RemoveInactive(); // Compacts the order and frees the removed proxies
+	void ChooseAxis();
+	void SortOrder();
+
+public:
+	int AddProxy(const AABB& bounds, RigidBody* body) override;
+
+	void RemoveProxy(int proxy) override;
+
+	void MoveProxy(int proxy, const AABB& bounds) override;
+
+	void FindPairs(std::vector<BroadphasePair>& outPairs) override;
+
+	void Query(const AABB& bounds, std::vector<RigidBody*>& outBodies) override;
+
+	inline int GetNumProxies() const override { return (int)(order.size() - removedProxies.size()); }
+
+	inline int GetType() const override { return SWEEP_AND_PRUNE_BROADPHASE; }
+
+	inline int GetAxis() const { return axis; }
+};
\ No newline at end of file
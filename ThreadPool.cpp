@@ -0,0 +1,192 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads) : queuedTasks(0), pendingTasks(0), stop(false)
+{
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+
+	for (int i = 0; i < numThreads; ++i)
+		queues.push_back(new WorkQueue());
+
+	// The last queue belongs to the thread that calls Run
+	for (int i = 0; i < numThreads - 1; ++i)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stop = true;
+	}
+	wakeUp.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	for (WorkQueue* queue : queues)
+		delete queue;
+}
+
+bool ThreadPool::PopTask(int queueIndex, Task& task)
+{
+	WorkQueue* queue = queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	if (queue->tasks.empty()) return false;
+
+	task = std::move(queue->tasks.back());
+	queue->tasks.pop_back();
+	queuedTasks--;
+	return true;
+}
+
+bool ThreadPool::StealTask(int queueIndex, Task& task)
+{
+	int numQueues = (int)queues.size();
+	for (int i = 1; i < numQueues; ++i)
+	{
+		WorkQueue* victim = queues[(queueIndex + i) % numQueues];
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		if (victim->tasks.empty()) continue;
+
+		task = std::move(victim->tasks.front());
+		victim->tasks.pop_front();
+		queuedTasks--;
+		return true;
+	}
+
+	return false;
+}
+
+bool ThreadPool::FindTask(int queueIndex, Task& task)
+{
+	return PopTask(queueIndex, task) || StealTask(queueIndex, task);
+}
+
+void ThreadPool::WorkerLoop(int queueIndex)
+{
+	Task task;
+
+	while (true)
+	{
+		if (FindTask(queueIndex, task))
+		{
+			task();
+			task = nullptr;
+			pendingTasks--;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this]() { return stop || queuedTasks > 0; });
+		if (stop) return;
+	}
+}
+
+void ThreadPool::Run(std::vector<Task>& tasks)
+{
+	if (tasks.empty()) return;
+
+	int numQueues = (int)queues.size();
+	int callerQueue = numQueues - 1;
+
+	if (numQueues == 1)
+	{
+		for (Task& task : tasks)
+			task();
+		tasks.clear();
+		return;
+	}
+
+	pendingTasks += (int)tasks.size();
+
+	// Deal the tasks in contiguous blocks so neighbouring chunks stay in the same thread
+	int numTasks = (int)tasks.size();
+	for (int q = 0; q < numQueues; ++q)
+	{
+		int begin = numTasks * q / numQueues;
+		int end = numTasks * (q + 1) / numQueues;
+
+		std::lock_guard<std::mutex> lock(queues[q]->mutex);
+		for (int i = begin; i < end; ++i)
+			queues[q]->tasks.push_back(std::move(tasks[i]));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queuedTasks += numTasks;
+	}
+	wakeUp.notify_all();
+
+	// The calling thread helps until every task of the batch has finished
+	Task task;
+	while (pendingTasks > 0)
+	{
+		if (FindTask(callerQueue, task))
+		{
+			task();
+			task = nullptr;
+			pendingTasks--;
+		}
+		else std::this_thread::yield();
+	}
+
+	tasks.clear();
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<float(int)>& cost, const std::function<void(int, int)>& body)
+{
+	if (count <= 0) return;
+
+	float totalCost = 0.f;
+	for (int i = 0; i < count; ++i)
+		totalCost += cost(i);
+
+	// A few chunks per thread so that stealing can balance the load
+	float targetCost = totalCost / (float)(4 * GetNumThreads());
+
+	std::vector<Task> tasks;
+	AddCostChunks(tasks, count, cost, targetCost, body);
+	Run(tasks);
+}
+
+void ThreadPool::ParallelFor(int count, int grainSize, const std::function<void(int, int)>& body)
+{
+	if (count <= 0) return;
+	if (grainSize < 1) grainSize = 1;
+
+	std::vector<Task> tasks;
+	for (int begin = 0; begin < count; begin += grainSize)
+	{
+		int end = begin + grainSize < count ? begin + grainSize : count;
+		tasks.push_back([body, begin, end]() { body(begin, end); });
+	}
+	Run(tasks);
+}
+
+void AddCostChunks(
+	std::vector<ThreadPool::Task>& tasks,
+	int count,
+	const std::function<float(int)>& cost,
+	float targetCost,
+	const std::function<void(int, int)>& body
+)
+{
+	int begin = 0;
+	float chunkCost = 0.f;
+
+	for (int i = 0; i < count; ++i)
+	{
+		chunkCost += cost(i);
+
+		if (chunkCost >= targetCost || i == count - 1)
+		{
+			int end = i + 1;
+			tasks.push_back([body, begin, end]() { body(begin, end); });
+			begin = end;
+			chunkCost = 0.f;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent work stealing thread pool. Every worker owns a queue: it takes tasks from the back
+// of its own queue and, when it runs out of work, steals from the front of the other queues.
+// The thread that calls Run also executes tasks until the whole batch is finished.
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+protected:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<WorkQueue*> queues; // one per worker plus one for the calling thread
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+
+	std::atomic<int> queuedTasks;
+	std::atomic<int> pendingTasks;
+	bool stop;
+
+	bool PopTask(int queueIndex, Task& task);
+	bool StealTask(int queueIndex, Task& task);
+	bool FindTask(int queueIndex, Task& task);
+
+	void WorkerLoop(int queueIndex);
+
+public:
+	ThreadPool(int numThreads = 0); // 0 uses all the hardware threads
+
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline int GetNumThreads() const { return (int)workers.size() + 1; } // workers plus the calling thread
+
+	void Run(std::vector<Task>& tasks); // Executes all the tasks, waits until they are done and clears the vector
+
+	// Splits [0, count) in chunks of similar total cost and runs body(begin, end) on each of them
+	void ParallelFor(int count, const std::function<float(int)>& cost, const std::function<void(int, int)>& body);
+
+	// Splits [0, count) in chunks of grainSize elements
+	void ParallelFor(int count, int grainSize, const std::function<void(int, int)>& body);
+};
+
+// Appends to tasks the chunks of [0, count) that add up to approximately targetCost each
+void AddCostChunks(
+	std::vector<ThreadPool::Task>& tasks,
+	int count,
+	const std::function<float(int)>& cost,
+	float targetCost,
+	const std::function<void(int, int)>& body
+);
\ No newline at end of file
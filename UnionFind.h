@@ -0,0 +1,48 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+// Disjoint sets over the integers [0, size), used to group the objects of the physics system in
+// islands. Union by size and path halving, so every operation is almost constant.
+class UnionFind
+{
+protected:
+	std::vector<int> parents;
+	std::vector<int> sizes;
+
+public:
+	// Every element starts in its own set. The memory is kept between calls.
+	inline void Reset(int size)
+	{
+		parents.resize(size);
+		sizes.assign(size, 1);
+		for (int i = 0; i < size; ++i)
+			parents[i] = i;
+	}
+
+	inline int Find(int element)
+	{
+		while (parents[element] != element)
+		{
+			parents[element] = parents[parents[element]];
+			element = parents[element];
+		}
+		return element;
+	}
+
+	inline void Union(int element1, int element2)
+	{
+		int root1 = Find(element1);
+		int root2 = Find(element2);
+		if (root1 == root2) return;
+
+		if (sizes[root1] < sizes[root2])
+			std::swap(root1, root2);
+
+		parents[root2] = root1;
+		sizes[root1] += sizes[root2];
+	}
+
+	inline int Size() const { return (int)parents.size(); }
+};
\ No newline at end of file